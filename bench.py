@@ -0,0 +1,41 @@
+#!/usr/bin/env python3
+"""
+Post-build script for the bench environment: runs the firmware under simavr
+and fails the build when a hot path exceeds its cycle budget (bench/cycle_budget.txt).
+Needs simavr with its headers and libsimavr (set SIMAVR_DIR if not installed system-wide).
+"""
+import os
+import subprocess
+
+Import("env")
+
+PROJECT_DIR = env.subst("$PROJECT_DIR")
+RUNNER_SOURCE = os.path.join(PROJECT_DIR, "bench", "simavr_bench.c")
+# Each deployment profile has its own hot paths, so its own budget file
+BUDGET = os.path.join(PROJECT_DIR, env.GetProjectOption("custom_cycle_budget", "bench/cycle_budget.txt"))
+
+def build_runner(build_dir):
+    runner = os.path.join(build_dir, "simavr_bench")
+    command = ["cc", "-O2", "-std=gnu99", RUNNER_SOURCE, "-o", runner]
+    simavr_dir = os.environ.get("SIMAVR_DIR")
+    if simavr_dir:
+        command += ["-I" + os.path.join(simavr_dir, "include"), "-L" + os.path.join(simavr_dir, "lib")]
+    command += ["-lsimavr", "-lelf"]
+    subprocess.check_call(command)
+    return runner
+
+def cycle_bench(source, target, env):
+    elf = str(target[0])
+    try:
+        runner = build_runner(os.path.dirname(elf))
+    except (OSError, subprocess.CalledProcessError) as e:
+        print("❌ Cannot build the simavr runner (%s) - install simavr or set SIMAVR_DIR" % e)
+        env.Exit(1)
+
+    print("\nRunning firmware under simavr (8 s simulated)...")
+    if subprocess.call([runner, elf, BUDGET]) != 0:
+        print("❌ Cycle budget exceeded (or a hot path was not exercised)")
+        env.Exit(1)
+    print("✅ All hot paths within the cycle budget\n")
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", cycle_bench)
@@ -0,0 +1,40 @@
+// Scripted USB input for the simavr cycle benchmark (CYCLE_BENCH builds only).
+// Between 0.5 s and 2.5 s: clock at 120 BPM on the clock cable, alternating
+// notes and mod wheel CCs every 5 ms, and a full 16-packet CC bank every 250 ms.
+#include "Bench.h"
+
+#define SCRIPT_START_MS   500
+#define SCRIPT_END_MS     2500
+#define SCRIPT_STEP_MS    5
+
+static unsigned long nextStep = SCRIPT_START_MS;
+static uint16_t step = 0;
+
+uint8_t benchReadPackets(midiEventPacket_t* packets, uint8_t maxPackets) {
+  unsigned long now = millis();
+  if (now < nextStep || now >= SCRIPT_END_MS) return 0;
+  nextStep += SCRIPT_STEP_MS;
+  step++;
+  
+  uint8_t count = 0;
+  
+  // ~20.8 ms per 24 PPQN clock at 120 BPM
+  if (step % 4 == 0 && count < maxPackets) {
+    packets[count++] = { USB_MIDI_HEADER(USB_CABLE_CLOCK, 0x0F), 0xF8, 0, 0 };
+  }
+  
+  if (step % 50 == 0) {
+    while (count < maxPackets) {
+      packets[count] = { USB_MIDI_HEADER(USB_CABLE_DIN, 0x0B), 0xB0, 74, (uint8_t)(count * 8) };
+      count++;
+    }
+  } else if (count < maxPackets) {
+    midiEventPacket_t& packet = packets[count++];
+    switch (step & 3) {
+      case 1: packet = { USB_MIDI_HEADER(USB_CABLE_DIN, 0x09), 0x90, 60, 100 }; break;
+      case 3: packet = { USB_MIDI_HEADER(USB_CABLE_DIN, 0x08), 0x80, 60, 0 }; break;
+      default: packet = { USB_MIDI_HEADER(USB_CABLE_DIN, 0x0B), 0xB0, 1, (uint8_t)(step & 0x7F) }; break;
+    }
+  }
+  return count;
+}
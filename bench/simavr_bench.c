@@ -0,0 +1,301 @@
+/**
+ * MIDI BytePulse - simavr Cycle Benchmark
+ *
+ * Runs the CYCLE_BENCH firmware image on simavr's ATmega32U4 core with
+ * scripted DIN UART and pin stimuli, timestamps the GPIOR1/GPIOR2 markers
+ * written by the hot paths (include/Bench.h) and compares the worst case of
+ * each against a cycle budget:
+ *
+ *   simavr_bench firmware.elf bench/cycle_budget.txt [--write-budget]
+ *
+ * Exit status 1 when a path exceeds its budget or never ran. Paths without a
+ * budget line that never ran are left out of the profile (see Profile.h).
+ * --write-budget rewrites the budget file as measured max + 25 %.
+ * A file with a "placeholder" line holds estimates, not measurements: they
+ * fail like measured ceilings, and the report asks for a baseline run.
+ *
+ * Timeline (USB input comes from bench/firmware/BenchUsbScript.cpp):
+ *   0.5 - 2.5 s  USB clock, notes and CC bursts
+ *   3.0 - 5.0 s  DIN clock at 120 BPM with notes, CCs and pitch bend in between
+ *   5.5 - 7.5 s  SYNC_IN at 1 PPQN, 120 BPM (rate switch position 1: 24 clocks per edge)
+ * Cycle counts cover the marked body only; add ~40 cycles of vector
+ * prologue/epilogue for the ISR entries.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_io.h>
+#include <simavr/avr_uart.h>
+#include <simavr/avr_ioport.h>
+
+#define F_CPU           16000000UL
+#define US(us)          ((avr_cycle_count_t)(us) * (F_CPU / 1000000UL))
+#define END_CYCLE       US(8000000)
+
+// Data-space addresses (I/O address + 0x20)
+#define GPIOR1_ADDR     0x4A
+#define GPIOR2_ADDR     0x4B
+#define PLLCSR_ADDR     0x49
+#define PLOCK           0
+
+#define MARKER_COUNT    8
+
+// Must match the BENCH_* ids in include/Bench.h
+static const char* const markerNames[MARKER_COUNT] = {
+  NULL, "handleClock", "syncInBurst", "forwardUSBtoDIN", "forwardDINtoUSB",
+  "dinRxIsr", "dinUdreIsr", "syncInIsr"
+};
+
+typedef struct {
+  avr_cycle_count_t start;
+  int open;
+  unsigned long calls;
+  unsigned long long total;
+  unsigned long min;
+  unsigned long max;
+  unsigned long budget;
+} Marker;
+
+static Marker markers[MARKER_COUNT];
+static int placeholderBudget = 0;
+
+static void markerEnter(avr_t* avr, avr_io_addr_t addr, uint8_t v, void* param) {
+  avr->data[addr] = v;
+  if (v && v < MARKER_COUNT) {
+    markers[v].start = avr->cycle;
+    markers[v].open = 1;
+  }
+}
+
+static void markerExit(avr_t* avr, avr_io_addr_t addr, uint8_t v, void* param) {
+  avr->data[addr] = v;
+  if (!v || v >= MARKER_COUNT || !markers[v].open) return;
+
+  Marker* m = &markers[v];
+  unsigned long cycles = (unsigned long)(avr->cycle - m->start);
+  m->open = 0;
+  m->calls++;
+  m->total += cycles;
+  if (m->calls == 1 || cycles < m->min) m->min = cycles;
+  if (cycles > m->max) m->max = cycles;
+}
+
+// No USB PLL model: report lock immediately so the core's USB init doesn't spin
+static uint8_t pllRead(avr_t* avr, avr_io_addr_t addr, void* param) {
+  return avr->data[addr] | (1 << PLOCK);
+}
+
+// ---------------------------------------------------------------------------
+// Stimuli
+
+typedef struct {
+  avr_cycle_count_t at;
+  char port;          // 0 = UART byte
+  uint8_t bit;
+  uint8_t value;
+} Stimulus;
+
+static Stimulus* stimuli;
+static size_t stimulusCount;
+static size_t stimulusCapacity;
+
+static void add(avr_cycle_count_t at, char port, uint8_t bit, uint8_t value) {
+  if (stimulusCount == stimulusCapacity) {
+    stimulusCapacity = stimulusCapacity ? stimulusCapacity * 2 : 1024;
+    stimuli = realloc(stimuli, stimulusCapacity * sizeof(Stimulus));
+  }
+  stimuli[stimulusCount].at = at;
+  stimuli[stimulusCount].port = port;
+  stimuli[stimulusCount].bit = bit;
+  stimuli[stimulusCount].value = value;
+  stimulusCount++;
+}
+
+// Queues bytes back to back on the wire, 320 us each; returns the end time
+static avr_cycle_count_t addDin(avr_cycle_count_t at, const uint8_t* bytes, int count) {
+  for (int i = 0; i < count; i++) {
+    add(at, 0, 0, bytes[i]);
+    at += US(320);
+  }
+  return at;
+}
+
+static int byTime(const void* a, const void* b) {
+  const Stimulus* x = a;
+  const Stimulus* y = b;
+  return x->at < y->at ? -1 : x->at > y->at;
+}
+
+static void buildStimuli(void) {
+  // Rate switch position 1 (D9 = PB5) closed, others open; SYNC_IN jack detect (D6 = PD7) high
+  add(0, 'B', 5, 0);
+  add(0, 'B', 6, 1);
+  add(0, 'B', 2, 1);
+  add(0, 'B', 3, 1);
+  add(0, 'B', 1, 1);
+  add(0, 'D', 7, 1);
+  add(0, 'E', 6, 0);
+
+  // DIN clock with channel traffic between the ticks
+  static const uint8_t start[] = { 0xFA };
+  static const uint8_t stop[] = { 0xFC };
+  avr_cycle_count_t t = addDin(US(3000000), start, 1);
+  for (int tick = 0; tick < 96; tick++) {
+    avr_cycle_count_t at = US(3000000) + US(1000) + (avr_cycle_count_t)tick * US(20833);
+    static const uint8_t clock[] = { 0xF8 };
+    addDin(at, clock, 1);
+
+    uint8_t msg[3];
+    switch (tick % 4) {
+      case 0: msg[0] = 0x90; msg[1] = 60; msg[2] = 100; break;
+      case 1: msg[0] = 0xB0; msg[1] = 1; msg[2] = tick & 0x7F; break;
+      case 2: msg[0] = 0xE0; msg[1] = 0; msg[2] = tick & 0x7F; break;
+      default: msg[0] = 0x80; msg[1] = 60; msg[2] = 0; break;
+    }
+    t = addDin(at + US(2000), msg, 3);
+  }
+  addDin(t + US(5000), stop, 1);
+
+  // SYNC_IN edges, 1 ms wide
+  for (avr_cycle_count_t at = US(5500000); at < US(7500000); at += US(500000)) {
+    add(at, 'E', 6, 1);
+    add(at + US(1000), 'E', 6, 0);
+  }
+
+  qsort(stimuli, stimulusCount, sizeof(Stimulus), byTime);
+}
+
+// ---------------------------------------------------------------------------
+// Budget file: "<name> <max cycles>" per line, '#' comments, "placeholder"
+// when the ceilings were never measured
+
+static int loadBudget(const char* path) {
+  FILE* f = fopen(path, "r");
+  if (!f) {
+    perror(path);
+    return -1;
+  }
+  char line[128];
+  while (fgets(line, sizeof(line), f)) {
+    char name[64];
+    unsigned long budget;
+    if (line[0] == '#') continue;
+    if (sscanf(line, "%63s", name) == 1 && !strcmp(name, "placeholder")) {
+      placeholderBudget = 1;
+      continue;
+    }
+    if (sscanf(line, "%63s %lu", name, &budget) != 2) continue;
+    for (int i = 1; i < MARKER_COUNT; i++) {
+      if (!strcmp(name, markerNames[i])) markers[i].budget = budget;
+    }
+  }
+  fclose(f);
+  return 0;
+}
+
+static int writeBudget(const char* path) {
+  FILE* f = fopen(path, "w");
+  if (!f) {
+    perror(path);
+    return -1;
+  }
+  fprintf(f, "# Worst-case cycles per hot path (simavr, CYCLE_BENCH build): measured max + 25 %%\n");
+  fprintf(f, "# Regenerate with: simavr_bench firmware.elf bench/cycle_budget.txt --write-budget\n");
+  for (int i = 1; i < MARKER_COUNT; i++) {
+    if (markers[i].calls == 0) continue;  // Not part of this profile's image
+    fprintf(f, "%-16s %lu\n", markerNames[i], markers[i].max + markers[i].max / 4);
+  }
+  fclose(f);
+  return 0;
+}
+
+// ---------------------------------------------------------------------------
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s firmware.elf cycle_budget.txt [--write-budget]\n", argv[0]);
+    return 2;
+  }
+  int rewrite = argc > 3 && !strcmp(argv[3], "--write-budget");
+
+  elf_firmware_t firmware;
+  memset(&firmware, 0, sizeof(firmware));
+  if (elf_read_firmware(argv[1], &firmware) != 0) {
+    fprintf(stderr, "%s: cannot load firmware\n", argv[1]);
+    return 2;
+  }
+
+  avr_t* avr = avr_make_mcu_by_name("atmega32u4");
+  if (!avr) {
+    fprintf(stderr, "this simavr build has no atmega32u4 core\n");
+    return 2;
+  }
+  avr_init(avr);
+  avr->frequency = F_CPU;
+  avr->log = LOG_WARNING;
+  avr_load_firmware(avr, &firmware);
+
+  if (!rewrite && loadBudget(argv[2]) != 0) return 2;
+
+  avr_register_io_write(avr, GPIOR1_ADDR, markerEnter, NULL);
+  avr_register_io_write(avr, GPIOR2_ADDR, markerExit, NULL);
+  avr_register_io_read(avr, PLLCSR_ADDR, pllRead, NULL);
+
+  // Keep DIN OUT off the console
+  uint32_t flags = 0;
+  avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS('1'), &flags);
+  flags &= ~AVR_UART_FLAG_STDIO;
+  avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS('1'), &flags);
+  avr_irq_t* uartIn = avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('1'), UART_IRQ_INPUT);
+
+  buildStimuli();
+  size_t next = 0;
+
+  int state = cpu_Running;
+  while (avr->cycle < END_CYCLE && state != cpu_Done && state != cpu_Crashed) {
+    while (next < stimulusCount && stimuli[next].at <= avr->cycle) {
+      const Stimulus* s = &stimuli[next++];
+      if (s->port) {
+        avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ(s->port), s->bit), s->value);
+      } else {
+        avr_raise_irq(uartIn, s->value);
+      }
+    }
+    state = avr_run(avr);
+  }
+  if (state == cpu_Crashed) {
+    fprintf(stderr, "firmware crashed at cycle %llu\n", (unsigned long long)avr->cycle);
+    return 1;
+  }
+
+  if (rewrite) return writeBudget(argv[2]) ? 2 : 0;
+
+  int failed = 0;
+  printf("%-16s %8s %8s %8s %8s %8s  %s\n", "hot path", "calls", "min", "mean", "max", "budget", "result");
+  for (int i = 1; i < MARKER_COUNT; i++) {
+    const Marker* m = &markers[i];
+    const char* result = "ok";
+    if (m->calls == 0 && !m->budget) {
+      result = "not in profile";
+    } else if (m->calls == 0) {
+      result = "NOT EXERCISED";
+      failed = 1;
+    } else if (m->budget && m->max > m->budget) {
+      result = "OVER BUDGET";
+      failed = 1;
+    } else if (!m->budget) {
+      result = "no budget";
+    } else if (placeholderBudget) {
+      result = "ok (placeholder)";
+    }
+    printf("%-16s %8lu %8lu %8llu %8lu %8lu  %s\n", markerNames[i], m->calls, m->min,
+           m->calls ? m->total / m->calls : 0, m->max, m->budget, result);
+  }
+  if (placeholderBudget) {
+    printf("\n%s: placeholder ceilings, not measured; record a baseline with --write-budget\n", argv[2]);
+  }
+  return failed;
+}
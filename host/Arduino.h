@@ -0,0 +1,56 @@
+/**
+ * MIDI BytePulse - Host Arduino shim
+ * Just enough of the Arduino core to run the firmware sources on a PC, against
+ * the simulated MCU in HostSim (virtual clock, pins, USART1, USB endpoints) or
+ * the Linux router's streams (host/router)
+ */
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH          1
+#define LOW           0
+#define INPUT         0
+#define OUTPUT        1
+#define INPUT_PULLUP  2
+#define CHANGE        1
+#define FALLING       2
+#define RISING        3
+
+#ifndef F_CPU
+#define F_CPU  16000000UL
+#endif
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+
+// USB CDC serial (SERIAL_DEBUG) - output is discarded
+class HostSerial {
+public:
+  void begin(unsigned long) {}
+  template <class T> size_t print(T) { return 0; }
+  template <class T> size_t println(T) { return 0; }
+  size_t println() { return 0; }
+  operator bool() const { return true; }
+};
+
+extern HostSerial Serial;
+
+#endif  // HOST_ARDUINO_H
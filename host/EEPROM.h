@@ -0,0 +1,24 @@
+#ifndef HOST_EEPROM_H
+#define HOST_EEPROM_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define HOST_EEPROM_SIZE  1024
+
+// Starts erased (0xFF) like a new chip
+class HostEEPROM {
+public:
+  HostEEPROM() { memset(cells, 0xFF, sizeof(cells)); }
+  uint8_t read(int address) { return cells[address % HOST_EEPROM_SIZE]; }
+  void write(int address, uint8_t value) { cells[address % HOST_EEPROM_SIZE] = value; }
+  void update(int address, uint8_t value) { write(address, value); }
+  uint16_t length() { return HOST_EEPROM_SIZE; }
+
+private:
+  uint8_t cells[HOST_EEPROM_SIZE];
+};
+
+extern HostEEPROM EEPROM;
+
+#endif  // HOST_EEPROM_H
@@ -0,0 +1,152 @@
+// Arduino core, register and USB entry points for the host build, all backed by HostSim
+#include <Arduino.h>
+#include <PluggableUSB.h>
+#include "HostSim.h"
+
+// ---------------------------------------------------------------------------
+// Registers
+
+HostSREG SREG;
+HostUDR1 UDR1;
+HostUCSR1A UCSR1A;
+HostTCNT1 TCNT1;
+HostTIFR1 TIFR1;
+HostPort PORTB = {0}, PORTC = {1}, PORTD = {2}, PORTE = {3}, PORTF = {4};
+
+HostSREG::operator uint8_t() {
+  // A read is the point where a spinning loop lets pending interrupts in
+  HostSim::advance(1);
+  return HostSim::interruptsEnabled() ? (1 << SREG_I) : 0;
+}
+
+HostSREG& HostSREG::operator=(uint8_t v) {
+  HostSim::setInterruptsEnabled(v & (1 << SREG_I));
+  return *this;
+}
+
+HostUDR1::operator uint8_t() {
+  return HostSim::readUdr();
+}
+
+HostUDR1& HostUDR1::operator=(uint8_t v) {
+  HostSim::writeUdr(v);
+  return *this;
+}
+
+HostUCSR1A::operator uint8_t() {
+  return HostSim::readUsartStatus();
+}
+
+HostUCSR1A& HostUCSR1A::operator=(uint8_t v) {
+  HostSim::writeUsartStatus(v);
+  return *this;
+}
+
+HostTCNT1::operator uint16_t() {
+  return HostSim::readTimer1();
+}
+
+HostTCNT1& HostTCNT1::operator=(uint16_t v) {
+  HostSim::writeTimer1(v);
+  return *this;
+}
+
+HostTIFR1::operator uint8_t() {
+  return HostSim::readTimer1Flags();
+}
+
+HostTIFR1& HostTIFR1::operator=(uint8_t v) {
+  HostSim::clearTimer1Flags(v);
+  return *this;
+}
+
+HostPort::operator uint8_t() {
+  return HostSim::readPort(port);
+}
+
+HostPort& HostPort::operator=(uint8_t v) {
+  HostSim::writePort(port, v);
+  return *this;
+}
+
+void cli() {
+  HostSim::setInterruptsEnabled(false);
+}
+
+void sei() {
+  HostSim::setInterruptsEnabled(true);
+}
+
+// ---------------------------------------------------------------------------
+// Arduino core
+
+unsigned long millis() {
+  return HostSim::micros() / 1000;
+}
+
+unsigned long micros() {
+  return HostSim::micros();
+}
+
+void delay(unsigned long ms) {
+  HostSim::advance(ms * 1000 * HOST_CYCLES_PER_US);
+}
+
+void delayMicroseconds(unsigned int us) {
+  HostSim::advance(us * HOST_CYCLES_PER_US);
+}
+
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  HostSim::pinWrite(pin, value);
+}
+
+int digitalRead(uint8_t pin) {
+  return HostSim::pinRead(pin);
+}
+
+int analogRead(uint8_t) {
+  return 0;
+}
+
+// ---------------------------------------------------------------------------
+// USB core (one MIDI function: OUT endpoint 1, IN endpoint 2)
+
+PluggableUSB_& PluggableUSB() {
+  static PluggableUSB_ instance;
+  return instance;
+}
+
+bool USBDevice_::configured() {
+  return HostSim::usbConfigured();
+}
+
+bool USBDevice_::isSuspended() {
+  return false;
+}
+
+int USB_SendControl(uint8_t, const void* data, int len) {
+  if (HostSim::onUsbControl) HostSim::onUsbControl((const uint8_t*)data, len);
+  return len;
+}
+
+uint8_t USB_Available(uint8_t) {
+  return HostSim::usbAvailable();
+}
+
+int USB_Recv(uint8_t, void* data, int len) {
+  return HostSim::usbRecv(data, len);
+}
+
+uint8_t USB_SendSpace(uint8_t) {
+  return HostSim::usbSendSpace();
+}
+
+int USB_Send(uint8_t, const void* data, int len) {
+  return HostSim::usbSend(data, len);
+}
+
+void USB_Flush(uint8_t) {
+  HostSim::usbFlush();
+}
@@ -0,0 +1,51 @@
+/**
+ * MIDI BytePulse - Host pin map
+ * Pro Micro pin numbers per port bit and the names used in output logs,
+ * shared by the simulated MCU and the Linux router backend
+ */
+
+#ifndef HOST_PINS_H
+#define HOST_PINS_H
+
+#include <stdio.h>
+#include "config.h"
+
+#define HOST_NO_PIN  0xFF
+
+// Pro Micro pin per port bit, HOST_NO_PIN where the bit isn't broken out
+static const uint8_t hostPortPins[5][8] = {
+  { 17, 15, 16, 14, 8, 9, 10, 11 },                         // PB0..PB7
+  { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 5, 13 },            // PC6, PC7
+  { 3, 2, 0, 1, 4, 0xFF, 12, 6 },                           // PD0..PD7 (PD5 = TX LED)
+  { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 7, 0xFF },          // PE6
+  { 23, 22, 0xFF, 0xFF, 21, 20, 19, 18 },                   // PF0, PF1, PF4..PF7
+};
+
+// Input registers (PINB..PINF) from the per-pin input levels, for code that reads ports directly
+inline void hostLatchInputs(const uint8_t* pinInputs) {
+  volatile uint8_t* const registers[5] = { &PINB, &PINC, &PIND, &PINE, &PINF };
+  for (uint8_t port = 0; port < 5; port++) {
+    uint8_t value = 0;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      uint8_t pin = hostPortPins[port][bit];
+      if (pin != HOST_NO_PIN && pinInputs[pin]) value |= 1 << bit;
+    }
+    *registers[port] = value;
+  }
+}
+
+inline const char* hostPinName(uint8_t pin) {
+  static char name[8];
+  switch (pin) {
+    case SYNC_OUT_PIN: return "SYNC_OUT";
+    case DISPLAY_CLK_PIN: return "DISPLAY_CLK";
+    case ANALOG_OUT_1_PIN: return "OUT_1";
+    case ANALOG_OUT_2_PIN: return "OUT_2";
+    case LED_PULSE_PIN: return "LED";
+    case SYNC_IN_PIN: return "SYNC_IN";
+  }
+  snprintf(name, sizeof(name), "D%u", pin);
+  return name;
+}
+
+#endif  // HOST_PINS_H
@@ -0,0 +1,24 @@
+// Plain registers and core objects, shared by every host backend (HostSim, router)
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <PluggableUSB.h>
+
+HostSerial Serial;
+HostEEPROM EEPROM;
+USBDevice_ USBDevice;
+
+volatile uint8_t UCSR1B, UCSR1C;
+volatile uint16_t UBRR1;
+volatile uint8_t TCCR1A, TCCR1B, TCCR1C, TIMSK1;
+volatile uint16_t OCR1A, OCR1B;
+volatile uint8_t TCCR0A, TCCR0B, TCNT0, OCR0A, OCR0B, TIMSK0, TIFR0;
+volatile uint8_t PINB, PINC, PIND, PINE, PINF;
+volatile uint8_t DDRB, DDRC, DDRD, DDRE, DDRF;
+volatile uint8_t EICRB, EIMSK, EIFR, PCICR, PCMSK0, PCIFR;
+volatile uint8_t ADMUX, ADCSRA, ADCSRB, ADCH, ADCL, DIDR0, DIDR2;
+volatile uint8_t MCUSR, WDTCSR;
+volatile uint8_t UDINT, UDIEN, UDADDR, USBSTA, UDCON;
+volatile uint16_t UDFNUM;
+volatile uint8_t GPIOR0;
+HostGPIOR GPIOR1, GPIOR2;
+volatile uint16_t SP = RAMEND;
@@ -0,0 +1,440 @@
+#include "HostSim.h"
+#include "HostPins.h"
+#include "config.h"
+#include <PluggableUSB.h>
+#include <stdarg.h>
+#include <inttypes.h>
+#include <string.h>
+#include <deque>
+
+// Firmware vectors (ISR() in avr/interrupt.h makes them plain C functions)
+extern "C" void INT6_vect(void);
+extern "C" void TIMER1_COMPA_vect(void);
+extern "C" void TIMER1_OVF_vect(void);
+// Weak like the chip's default vectors: profiles without DIN don't define them
+extern "C" void USART1_RX_vect(void) __attribute__((weak));
+extern "C" void USART1_UDRE_vect(void) __attribute__((weak));
+
+#define TIMER1_OVERFLOW_CYCLES  (65536ULL * 64)
+#define USB_PACKETS_PER_BANK    (USB_EP_SIZE / 4)
+#define NEVER                   UINT64_MAX
+
+struct TimedByte {
+  uint64_t cycle;
+  uint8_t value;
+};
+
+struct TimedPacket {
+  uint64_t cycle;
+  uint8_t bytes[4];
+};
+
+struct UsbBank {
+  uint8_t data[USB_EP_SIZE];
+  uint8_t length;
+  uint8_t pos;
+  uint32_t sequence;   // IN banks: commit order, 0 = still being filled
+};
+
+static std::deque<TimedByte> dinInput;
+static std::deque<uint64_t> syncInInput;
+static std::deque<TimedPacket> usbInput;
+static uint64_t lastDinArrival = 0;
+
+static UsbBank outBanks[2];
+static uint8_t outRead = 0;
+static uint8_t outWrite = 0;
+static UsbBank inBanks[2];
+static uint8_t inFill = 0;
+static uint32_t inSequence = 0;
+
+uint64_t HostSim::now = 0;
+bool HostSim::iFlag = false;
+bool HostSim::inIsr = false;
+FILE* HostSim::output = nullptr;
+uint64_t HostSim::timer1Origin = 0;
+uint64_t HostSim::timer1NextOverflow = TIMER1_OVERFLOW_CYCLES;
+uint8_t HostSim::timer1Flags = 0;
+bool HostSim::dinShiftBusy = false;
+uint8_t HostSim::dinShift = 0;
+uint64_t HostSim::dinShiftDoneAt = 0;
+bool HostSim::dinBufferFull = false;
+uint8_t HostSim::dinBuffer = 0;
+uint8_t HostSim::dinRxLatch = 0;
+uint8_t HostSim::usartStatus = (1 << UDRE1);
+uint8_t HostSim::usartControl = 0;
+bool HostSim::syncInPending = false;
+bool HostSim::usbHost = true;
+uint64_t HostSim::nextUsbFrame = HOST_USB_FRAME_CYCLES;
+uint64_t HostSim::usbFrames = 0;
+int32_t HostSim::usbFrameSkewPpm = 0;
+uint16_t HostSim::usbOutBacklogMax = 0;
+uint32_t HostSim::usbRecvTotal = 0;
+uint32_t HostSim::usbRecvCycleTotal = 0;
+void (*HostSim::onDinOut)(uint64_t, uint8_t) = nullptr;
+void (*HostSim::onUsbIn)(uint64_t, const uint8_t*) = nullptr;
+void (*HostSim::onPin)(uint64_t, uint8_t, uint8_t) = nullptr;
+void (*HostSim::onUsbControl)(const uint8_t*, int) = nullptr;
+uint8_t HostSim::pinLevels[32];
+uint8_t HostSim::pinInputs[32];
+
+void HostSim::reset() {
+  now = 0;
+  iFlag = false;
+  inIsr = false;
+  timer1Origin = 0;
+  timer1NextOverflow = TIMER1_OVERFLOW_CYCLES;
+  timer1Flags = 0;
+  dinShiftBusy = false;
+  dinBufferFull = false;
+  syncInPending = false;
+  usbHost = true;
+  nextUsbFrame = HOST_USB_FRAME_CYCLES;
+  usbFrames = 0;
+  usbFrameSkewPpm = 0;
+  UDFNUM = 0;
+  usbOutBacklogMax = 0;
+  usbRecvTotal = 0;
+  usbRecvCycleTotal = 0;
+  memset(pinLevels, LOW, sizeof(pinLevels));
+  memset(pinInputs, HIGH, sizeof(pinInputs));   // Pull-ups
+  hostLatchInputs(pinInputs);
+
+  dinInput.clear();
+  syncInInput.clear();
+  usbInput.clear();
+  lastDinArrival = 0;
+  memset(outBanks, 0, sizeof(outBanks));
+  memset(inBanks, 0, sizeof(inBanks));
+  outRead = outWrite = inFill = 0;
+  inSequence = 0;
+
+  usartStatus = (1 << UDRE1);
+  usartControl = 0;
+  UCSR1B = 0;
+}
+
+// ---------------------------------------------------------------------------
+// Stimuli
+
+void HostSim::addDinByte(uint64_t cycle, uint8_t value) {
+  // The wire can't deliver bytes closer than one frame apart
+  if (!dinInput.empty() || lastDinArrival) {
+    uint64_t earliest = lastDinArrival + HOST_DIN_BYTE_CYCLES;
+    if (cycle < earliest) cycle = earliest;
+  }
+  dinInput.push_back({ cycle, value });
+  lastDinArrival = cycle;
+}
+
+void HostSim::addUsbPacket(uint64_t cycle, const uint8_t packet[4]) {
+  TimedPacket p;
+  p.cycle = cycle;
+  memcpy(p.bytes, packet, 4);
+  usbInput.push_back(p);
+}
+
+void HostSim::addSyncInEdge(uint64_t cycle) {
+  syncInInput.push_back(cycle);
+}
+
+void HostSim::setInputPin(uint8_t pin, uint8_t level) {
+  if (pin < sizeof(pinInputs)) pinInputs[pin] = level;
+  hostLatchInputs(pinInputs);
+}
+
+void HostSim::setInterruptsEnabled(bool on) {
+  iFlag = on;
+  if (on) serviceInterrupts();
+}
+
+// ---------------------------------------------------------------------------
+// Time
+
+void HostSim::advance(uint32_t count) {
+  runUntil(now + count);
+}
+
+void HostSim::runUntil(uint64_t cycle) {
+  processEvents(cycle);
+  serviceInterrupts();
+}
+
+void HostSim::processEvents(uint64_t until) {
+  for (;;) {
+    uint64_t next = NEVER;
+    if (TCCR1B & 0x07) next = timer1NextOverflow;
+    uint64_t compareA = timer1NextCompareA();
+    if (compareA < next) next = compareA;
+    if (dinShiftBusy && dinShiftDoneAt < next) next = dinShiftDoneAt;
+    if (!dinInput.empty() && dinInput.front().cycle < next) next = dinInput.front().cycle;
+    if (!syncInInput.empty() && syncInInput.front() < next) next = syncInInput.front();
+    if (nextUsbFrame < next) next = nextUsbFrame;
+    // A packet waiting for a full bank is retried when the firmware frees it
+    if (!usbInput.empty() && outBanks[outWrite].length == 0 && usbInput.front().cycle < next) {
+      next = usbInput.front().cycle;
+    }
+    if (next > until) break;
+    if (next > now) now = next;
+
+    if ((TCCR1B & 0x07) && timer1NextOverflow <= now) {
+      timer1Flags |= (1 << TOV1);
+      timer1NextOverflow += TIMER1_OVERFLOW_CYCLES;
+    }
+
+    if (compareA <= now) timer1Flags |= (1 << OCF1A);
+
+    if (dinShiftBusy && dinShiftDoneAt <= now) {
+      logEvent("din %02X", dinShift);
+      if (onDinOut) onDinOut(micros(), dinShift);
+      dinShiftBusy = false;
+      if (dinBufferFull) {
+        dinBufferFull = false;
+        startDinShift(dinBuffer);
+        usartStatus |= (1 << UDRE1);
+      }
+    }
+
+    if (!dinInput.empty() && dinInput.front().cycle <= now) {
+      if (UCSR1B & (1 << RXEN1)) {
+        if (usartStatus & (1 << RXC1)) usartStatus |= (1 << DOR1);   // Previous byte not read in time
+        dinRxLatch = dinInput.front().value;
+        usartStatus |= (1 << RXC1);
+      }
+      dinInput.pop_front();
+    }
+
+    if (!syncInInput.empty() && syncInInput.front() <= now) {
+      syncInPending = true;
+      syncInInput.pop_front();
+    }
+
+    if (nextUsbFrame <= now) {
+      // Host collects committed IN banks, oldest first
+      for (;;) {
+        UsbBank* oldest = nullptr;
+        for (uint8_t b = 0; b < 2; b++) {
+          if (inBanks[b].sequence && (!oldest || inBanks[b].sequence < oldest->sequence)) oldest = &inBanks[b];
+        }
+        if (!oldest) break;
+        for (uint8_t i = 0; i + 3 < oldest->length; i += 4) {
+          logEvent("usb %02X %02X %02X %02X", oldest->data[i], oldest->data[i + 1],
+                   oldest->data[i + 2], oldest->data[i + 3]);
+          if (onUsbIn) onUsbIn(micros(), oldest->data + i);
+        }
+        oldest->length = 0;
+        oldest->sequence = 0;
+      }
+      usbFrames++;
+      UDFNUM = usbFrames & 0x7FF;
+      nextUsbFrame = (usbFrames + 1) * HOST_USB_FRAME_CYCLES * (1000000 + usbFrameSkewPpm) / 1000000;
+    }
+
+    deliverUsbBanks();
+
+    if (!inIsr && iFlag) serviceInterrupts();
+  }
+  if (until > now) now = until;
+}
+
+void HostSim::deliverUsbBanks() {
+  if (!usbHost) {
+    while (!usbInput.empty() && usbInput.front().cycle <= now) usbInput.pop_front();
+    return;
+  }
+
+  // One bulk transaction fills one bank with whatever the host has queued
+  while (!usbInput.empty() && usbInput.front().cycle <= now && outBanks[outWrite].length == 0) {
+    UsbBank& bank = outBanks[outWrite];
+    while (!usbInput.empty() && usbInput.front().cycle <= now && bank.length < USB_EP_SIZE) {
+      memcpy(bank.data + bank.length, usbInput.front().bytes, 4);
+      bank.length += 4;
+      usbInput.pop_front();
+    }
+    bank.pos = 0;
+    outWrite ^= 1;
+  }
+
+  uint16_t backlog = 0;
+  for (std::deque<TimedPacket>::const_iterator it = usbInput.begin(); it != usbInput.end() && it->cycle <= now; ++it) {
+    backlog++;
+  }
+  if (backlog > usbOutBacklogMax) usbOutBacklogMax = backlog;
+}
+
+void HostSim::serviceInterrupts() {
+  if (inIsr) return;
+
+  // Lowest vector number first, as on the chip
+  while (iFlag) {
+    void (*vector)() = nullptr;
+    if (syncInPending && (EIMSK & (1 << INT6))) {
+      syncInPending = false;
+      vector = INT6_vect;
+    } else if ((timer1Flags & (1 << OCF1A)) && (TIMSK1 & (1 << OCIE1A))) {
+      timer1Flags &= ~(1 << OCF1A);
+      vector = TIMER1_COMPA_vect;
+    } else if ((timer1Flags & (1 << TOV1)) && (TIMSK1 & (1 << TOIE1))) {
+      timer1Flags &= ~(1 << TOV1);
+      vector = TIMER1_OVF_vect;
+    } else if ((usartStatus & (1 << RXC1)) && (UCSR1B & (1 << RXCIE1))) {
+      vector = USART1_RX_vect;
+    } else if ((usartStatus & (1 << UDRE1)) && (UCSR1B & (1 << UDRIE1))) {
+      vector = USART1_UDRE_vect;
+    }
+    if (!vector) break;
+
+    inIsr = true;
+    iFlag = false;
+    vector();
+    processEvents(now + HOST_ISR_CYCLES);
+    iFlag = true;
+    inIsr = false;
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Timer1
+
+uint16_t HostSim::readTimer1() {
+  return (uint16_t)((now - timer1Origin) / 64);
+}
+
+void HostSim::writeTimer1(uint16_t value) {
+  timer1Origin = now - (uint64_t)value * 64;
+  timer1NextOverflow = timer1Origin + TIMER1_OVERFLOW_CYCLES;
+}
+
+// Next cycle TCNT1 reaches OCR1A (only while the compare interrupt is on);
+// a match on the current count is a full period away
+uint64_t HostSim::timer1NextCompareA() {
+  if (!(TCCR1B & 0x07) || !(TIMSK1 & (1 << OCIE1A))) return NEVER;
+  uint64_t ticks = (now - timer1Origin) / 64;
+  uint16_t ahead = OCR1A - (uint16_t)ticks;
+  return timer1Origin + (ticks + (ahead ? ahead : 65536)) * 64;
+}
+
+// ---------------------------------------------------------------------------
+// USART1
+
+void HostSim::startDinShift(uint8_t value) {
+  dinShiftBusy = true;
+  dinShift = value;
+  dinShiftDoneAt = now + HOST_DIN_BYTE_CYCLES;
+}
+
+void HostSim::writeUdr(uint8_t value) {
+  if (!(UCSR1B & (1 << TXEN1))) return;
+
+  if (!dinShiftBusy) {
+    startDinShift(value);
+  } else if (!dinBufferFull) {
+    dinBuffer = value;
+    dinBufferFull = true;
+    usartStatus &= ~(1 << UDRE1);
+  } else {
+    fprintf(stderr, "warning: UDR1 written while full at %" PRIu64 " us, byte lost\n", micros());
+  }
+}
+
+uint8_t HostSim::readUdr() {
+  usartStatus &= ~((1 << RXC1) | (1 << DOR1));
+  return dinRxLatch;
+}
+
+// ---------------------------------------------------------------------------
+// Pins
+
+void HostSim::pinWrite(uint8_t pin, uint8_t level) {
+  if (pin >= sizeof(pinLevels)) return;
+  level = level ? HIGH : LOW;
+  if (pinLevels[pin] == level) return;
+  pinLevels[pin] = level;
+  logEvent("pin %s %u", hostPinName(pin), level);
+  if (onPin) onPin(micros(), pin, level);
+}
+
+uint8_t HostSim::pinRead(uint8_t pin) {
+  return pin < sizeof(pinInputs) ? pinInputs[pin] : HIGH;
+}
+
+uint8_t HostSim::readPort(uint8_t port) {
+  uint8_t value = 0;
+  for (uint8_t bit = 0; bit < 8; bit++) {
+    uint8_t pin = hostPortPins[port][bit];
+    if (pin != HOST_NO_PIN && pinLevels[pin]) value |= 1 << bit;
+  }
+  return value;
+}
+
+void HostSim::writePort(uint8_t port, uint8_t value) {
+  for (uint8_t bit = 0; bit < 8; bit++) {
+    uint8_t pin = hostPortPins[port][bit];
+    if (pin != HOST_NO_PIN) pinWrite(pin, (value >> bit) & 1);
+  }
+}
+
+// ---------------------------------------------------------------------------
+// USB endpoints
+
+uint8_t HostSim::usbAvailable() {
+  usbRecvCycleTotal += HOST_USB_AVAILABLE_CYCLES;
+  advance(HOST_USB_AVAILABLE_CYCLES);
+  const UsbBank& bank = outBanks[outRead];
+  return bank.length - bank.pos;
+}
+
+int HostSim::usbRecv(void* data, int len) {
+  UsbBank& bank = outBanks[outRead];
+  int n = bank.length - bank.pos;
+  if (n > len) n = len;
+  memcpy(data, bank.data + bank.pos, n);
+  bank.pos += n;
+  usbRecvTotal += n;
+
+  // Bank released back to the host
+  if (bank.length && bank.pos == bank.length) {
+    bank.length = bank.pos = 0;
+    outRead ^= 1;
+  }
+  usbRecvCycleTotal += HOST_USB_RECV_CYCLES + n * HOST_USB_RECV_BYTE_CYCLES;
+  advance(HOST_USB_RECV_CYCLES + n * HOST_USB_RECV_BYTE_CYCLES);
+  return n;
+}
+
+uint8_t HostSim::usbSendSpace() {
+  const UsbBank& bank = inBanks[inFill];
+  return bank.sequence ? 0 : USB_EP_SIZE - bank.length;
+}
+
+int HostSim::usbSend(const void* data, int len) {
+  UsbBank& bank = inBanks[inFill];
+  if (bank.sequence) return 0;
+
+  int n = USB_EP_SIZE - bank.length;
+  if (n > len) n = len;
+  memcpy(bank.data + bank.length, data, n);
+  bank.length += n;
+
+  if (bank.length == USB_EP_SIZE) usbFlush();
+  return n;
+}
+
+void HostSim::usbFlush() {
+  UsbBank& bank = inBanks[inFill];
+  if (bank.sequence || bank.length == 0) return;
+  bank.sequence = ++inSequence;
+  inFill ^= 1;
+}
+
+// ---------------------------------------------------------------------------
+
+void HostSim::logEvent(const char* format, ...) {
+  if (!output) return;
+  fprintf(output, "%" PRIu64 " ", micros());
+  va_list args;
+  va_start(args, format);
+  vfprintf(output, format, args);
+  va_end(args);
+  fputc('\n', output);
+}
@@ -0,0 +1,140 @@
+/**
+ * MIDI BytePulse - Host MCU Simulation
+ *
+ * Runs the unmodified firmware sources on a PC with a virtual 16 MHz clock.
+ * Models only what the firmware timing depends on:
+ *   - Timer1 at clk/64 with its overflow interrupt
+ *   - USART1 at 31.25 kbaud: one shift register plus UDR, 320 us per byte
+ *   - USB bulk endpoints with two 64-byte banks, IN banks collected by the
+ *     host once per 1 ms frame, and the frame number in UDFNUM
+ *   - SYNC_IN edges on INT6 (taken when enabled in EIMSK) and the input pins
+ *     (detect jack, rate switch), also seen in PINB..PINF. Pin changes are
+ *     not interrupts here: the rate switch is set before setup()
+ * Interrupts run between "instructions": simulated time advances in loop()
+ * steps and on every SREG read, which is where a spinning loop would let
+ * them in on the real chip.
+ *
+ * Outputs (DIN bytes, USB packets, pin edges) are written as one event per
+ * line to the log file: "<us> din F8", "<us> usb 1F F8 00 00", "<us> pin SYNC_OUT 1",
+ * and passed to the optional observer hooks.
+ */
+
+#ifndef HOST_SIM_H
+#define HOST_SIM_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <avr/io.h>
+
+#define HOST_CYCLES_PER_US     16
+#define HOST_DIN_BYTE_CYCLES   (320 * HOST_CYCLES_PER_US)    // 10 bits at 31.25 kbaud
+#define HOST_USB_FRAME_CYCLES  (1000 * HOST_CYCLES_PER_US)
+#define HOST_ISR_CYCLES        40                            // Entry + exit overhead per vector
+// USB core endpoint calls, counted from USBCore.cpp: call, LockEP (SREG, cli, UENUM),
+// FifoByteCount, then Recv8 per byte and ReleaseRX once the bank is empty
+#define HOST_USB_AVAILABLE_CYCLES   30
+#define HOST_USB_RECV_CYCLES        45
+#define HOST_USB_RECV_BYTE_CYCLES   7
+
+class HostSim {
+public:
+  static void reset();
+  static void setLog(FILE* log) { output = log; }
+
+  // Output observers for in-process harnesses (host/stress), called as the events happen
+  static void (*onDinOut)(uint64_t us, uint8_t value);
+  static void (*onUsbIn)(uint64_t us, const uint8_t* packet);
+  static void (*onPin)(uint64_t us, uint8_t pin, uint8_t level);
+  static void (*onUsbControl)(const uint8_t* data, int len);  // Descriptor bytes on endpoint 0
+
+  // Virtual time
+  static uint64_t cycles() { return now; }
+  static uint64_t micros() { return now / HOST_CYCLES_PER_US; }
+  static void advance(uint32_t count);     // Runs due hardware events, then pending interrupts
+  static void runUntil(uint64_t cycle);
+
+  // Global interrupt flag (SREG I bit)
+  static bool interruptsEnabled() { return iFlag; }
+  static void setInterruptsEnabled(bool on);
+
+  // Stimuli, in cycles; must be added in time order per kind
+  static void addDinByte(uint64_t cycle, uint8_t value);
+  static void addUsbPacket(uint64_t cycle, const uint8_t packet[4]);
+  static void addSyncInEdge(uint64_t cycle);
+  static void setUsbHost(bool present) { usbHost = present; }
+  // The MCU oscillator runs this far fast against the host: a 1 ms frame lasts 1 ms + ppm local time
+  static void setUsbFrameSkewPpm(int32_t ppm) { usbFrameSkewPpm = ppm; }
+  static void setInputPin(uint8_t pin, uint8_t level);
+
+  // Register side effects (see avr/io.h)
+  static void writeUdr(uint8_t value);
+  static uint8_t readUdr();
+  static uint8_t readUsartStatus() { return usartStatus | usartControl; }
+  static void writeUsartStatus(uint8_t value) { usartControl = value & ((1 << U2X1) | 1); }
+  static uint16_t readTimer1();
+  static void writeTimer1(uint16_t value);
+  static uint8_t readTimer1Flags() { return timer1Flags; }
+  static void clearTimer1Flags(uint8_t mask) { timer1Flags &= ~mask; }
+
+  // Arduino core hooks
+  static void pinWrite(uint8_t pin, uint8_t level);
+  static uint8_t pinRead(uint8_t pin);
+
+  // PORTB..PORTF writes, bit by bit onto the Pro Micro pin numbers
+  static uint8_t readPort(uint8_t port);
+  static void writePort(uint8_t port, uint8_t value);
+
+  // USB core hooks
+  static bool usbConfigured() { return usbHost; }
+  static uint8_t usbAvailable();
+  static int usbRecv(void* data, int len);
+  static uint8_t usbSendSpace();
+  static int usbSend(const void* data, int len);
+  static void usbFlush();
+
+  // High-water marks, reported at the end of a replay
+  static uint16_t maxUsbOutBacklog() { return usbOutBacklogMax; }  // Packets waiting for a free OUT bank
+  static uint32_t usbRecvBytes() { return usbRecvTotal; }          // Read from the OUT endpoint so far
+  static uint32_t usbRecvCycles() { return usbRecvCycleTotal; }    // Spent in USB_Available / USB_Recv
+
+private:
+  static void processEvents(uint64_t until);
+  static void serviceInterrupts();
+  static void logEvent(const char* format, ...);
+  static void startDinShift(uint8_t value);
+  static void deliverUsbBanks();
+  static uint64_t timer1NextCompareA();
+
+  static uint64_t now;
+  static bool iFlag;
+  static bool inIsr;
+  static FILE* output;
+
+  static uint64_t timer1Origin;
+  static uint64_t timer1NextOverflow;
+  static uint8_t timer1Flags;
+
+  static bool dinShiftBusy;
+  static uint8_t dinShift;
+  static uint64_t dinShiftDoneAt;
+  static bool dinBufferFull;
+  static uint8_t dinBuffer;
+  static uint8_t dinRxLatch;
+  static uint8_t usartStatus;    // RXC1, UDRE1, DOR1
+  static uint8_t usartControl;   // U2X1, MPCM1
+
+  static bool syncInPending;     // INTF6
+
+  static bool usbHost;
+  static uint64_t nextUsbFrame;
+  static uint64_t usbFrames;
+  static int32_t usbFrameSkewPpm;
+  static uint16_t usbOutBacklogMax;
+  static uint32_t usbRecvTotal;
+  static uint32_t usbRecvCycleTotal;
+
+  static uint8_t pinLevels[32];
+  static uint8_t pinInputs[32];
+};
+
+#endif  // HOST_SIM_H
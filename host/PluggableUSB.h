@@ -0,0 +1,96 @@
+/**
+ * MIDI BytePulse - Host PluggableUSB shim
+ * Descriptor types and endpoint calls of the Arduino AVR USB core, backed by
+ * the two-bank endpoint model in HostSim or the router's USB streams
+ */
+
+#ifndef HOST_PLUGGABLE_USB_H
+#define HOST_PLUGGABLE_USB_H
+
+#include <stdint.h>
+
+typedef struct {
+  uint8_t bmRequestType;
+  uint8_t bRequest;
+  uint8_t wValueL;
+  uint8_t wValueH;
+  uint16_t wIndex;
+  uint16_t wLength;
+} USBSetup;
+
+typedef struct {
+  uint8_t len, dtype, number, alternate, numEndpoints;
+  uint8_t interfaceClass, interfaceSubClass, protocol, iInterface;
+} InterfaceDescriptor;
+
+// Packed as on the AVR, where nothing is padded
+typedef struct __attribute__((packed)) {
+  uint8_t len, dtype, addr, attr;
+  uint16_t packetSize;
+  uint8_t interval;
+} EndpointDescriptor;
+
+typedef struct {
+  uint8_t len, dtype, firstInterface, interfaceCount;
+  uint8_t functionClass, funtionSubClass, functionProtocol, iInterface;
+} IADDescriptor;
+
+#define D_IAD(_first, _count, _class, _subClass, _protocol) \
+  { 8, 11, _first, _count, _class, _subClass, _protocol, 0 }
+#define D_INTERFACE(_n, _numEndpoints, _class, _subClass, _protocol) \
+  { 9, 4, _n, 0, _numEndpoints, _class, _subClass, _protocol, 0 }
+#define D_ENDPOINT(_addr, _attr, _packetSize, _interval) \
+  { 7, 5, _addr, _attr, _packetSize, _interval }
+
+#define USB_ENDPOINT_OUT(addr)       ((uint8_t)((addr) | 0x00))
+#define USB_ENDPOINT_IN(addr)        ((uint8_t)((addr) | 0x80))
+#define USB_ENDPOINT_TYPE_BULK       0x02
+#define USB_STRING_DESCRIPTOR_TYPE   3
+#define EP_TYPE_BULK_IN              0x81
+#define EP_TYPE_BULK_OUT             0x80
+#define USB_EP_SIZE                  64
+
+class PluggableUSBModule {
+public:
+  PluggableUSBModule(uint8_t numEps, uint8_t numIfs, uint8_t* epType)
+    : numEndpoints(numEps), numInterfaces(numIfs), endpointType(epType) {}
+  virtual ~PluggableUSBModule() {}
+
+protected:
+  virtual bool setup(USBSetup& setup) = 0;
+  virtual int getInterface(uint8_t* interfaceCount) = 0;
+  virtual int getDescriptor(USBSetup& setup) = 0;
+
+  uint8_t pluggedInterface = 0;
+  uint8_t pluggedEndpoint = 0;
+  const uint8_t numEndpoints;
+  const uint8_t numInterfaces;
+  const uint8_t* endpointType;
+
+  friend class PluggableUSB_;
+};
+
+// A single function is plugged: its OUT endpoint is 1, IN endpoint 2
+class PluggableUSB_ {
+public:
+  bool plug(PluggableUSBModule* module) { module->pluggedEndpoint = 1; return true; }
+};
+
+PluggableUSB_& PluggableUSB();
+
+class USBDevice_ {
+public:
+  bool configured();
+  bool isSuspended();
+};
+
+extern USBDevice_ USBDevice;
+
+int USB_SendControl(uint8_t flags, const void* data, int len);
+uint8_t USB_Available(uint8_t ep);
+uint8_t USB_SendSpace(uint8_t ep);
+int USB_Send(uint8_t ep, const void* data, int len);
+int USB_Recv(uint8_t ep, void* data, int len);
+void USB_Flush(uint8_t ep);
+
+#endif  // HOST_PLUGGABLE_USB_H
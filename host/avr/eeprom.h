@@ -0,0 +1,7 @@
+#ifndef HOST_AVR_EEPROM_H
+#define HOST_AVR_EEPROM_H
+
+// EEPROM writes complete at once on the host (HostEEPROM)
+#define eeprom_is_ready()  1
+
+#endif  // HOST_AVR_EEPROM_H
@@ -0,0 +1,16 @@
+#ifndef HOST_AVR_INTERRUPT_H
+#define HOST_AVR_INTERRUPT_H
+
+#include <avr/io.h>
+
+// Vectors become plain functions; HostSim calls them when the interrupt is due
+#define ISR(vector, ...)  extern "C" void vector(void); extern "C" void vector(void)
+
+#define ISR_BLOCK
+#define ISR_NOBLOCK
+#define ISR_NAKED
+
+void cli();
+void sei();
+
+#endif  // HOST_AVR_INTERRUPT_H
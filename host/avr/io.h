@@ -0,0 +1,202 @@
+/**
+ * MIDI BytePulse - Host register shim (ATmega32U4 subset)
+ * Plain variables, except the few registers whose access has side effects
+ * on real hardware; those are small proxy objects backed by HostSim.
+ */
+
+#ifndef HOST_AVR_IO_H
+#define HOST_AVR_IO_H
+
+#include <stdint.h>
+
+// Reading SREG is where a spinning loop would let interrupts in, so it lets
+// simulated time move forward by one cycle and services due interrupts
+struct HostSREG {
+  operator uint8_t();
+  HostSREG& operator=(uint8_t v);
+  HostSREG& operator&=(uint8_t v) { return *this = (uint8_t)(*this & v); }
+  HostSREG& operator|=(uint8_t v) { return *this = (uint8_t)(*this | v); }
+};
+
+// USART1 data register: writes start a transmission, reads return the received byte
+struct HostUDR1 {
+  operator uint8_t();
+  HostUDR1& operator=(uint8_t v);
+};
+
+// USART1 status: the flag bits belong to the hardware, only U2X1/MPCM1 are writable
+struct HostUCSR1A {
+  operator uint8_t();
+  HostUCSR1A& operator=(uint8_t v);
+  HostUCSR1A& operator&=(uint8_t v) { return *this = (uint8_t)(*this & v); }
+  HostUCSR1A& operator|=(uint8_t v) { return *this = (uint8_t)(*this | v); }
+};
+
+// Timer1 counter follows the simulated clock (clk/64 once started)
+struct HostTCNT1 {
+  operator uint16_t();
+  HostTCNT1& operator=(uint16_t v);
+};
+
+// Interrupt flags are cleared by writing a one
+struct HostTIFR1 {
+  operator uint8_t();
+  HostTIFR1& operator=(uint8_t v);
+};
+
+// Output ports: each bit is a Pro Micro pin, writes show up as pin edges
+struct HostPort {
+  uint8_t port;   // 0 = B ... 4 = F
+  operator uint8_t();
+  HostPort& operator=(uint8_t v);
+  HostPort& operator&=(uint8_t v) { return *this = (uint8_t)(*this & v); }
+  HostPort& operator|=(uint8_t v) { return *this = (uint8_t)(*this | v); }
+  HostPort& operator^=(uint8_t v) { return *this = (uint8_t)(*this ^ v); }
+};
+
+// Cycle bench markers (include/Bench.h): the host bench (host/bench) times the writes
+struct HostGPIOR {
+  uint8_t value;
+  void (*onWrite)(uint8_t v);
+  operator uint8_t() const { return value; }
+  HostGPIOR& operator=(uint8_t v) {
+    value = v;
+    if (onWrite) onWrite(v);
+    return *this;
+  }
+};
+
+extern HostSREG SREG;
+extern HostUDR1 UDR1;
+extern HostUCSR1A UCSR1A;
+extern HostTCNT1 TCNT1;
+extern HostTIFR1 TIFR1;
+extern HostPort PORTB, PORTC, PORTD, PORTE, PORTF;
+
+extern volatile uint8_t UCSR1B, UCSR1C;
+extern volatile uint16_t UBRR1;
+extern volatile uint8_t TCCR1A, TCCR1B, TCCR1C, TIMSK1;
+extern volatile uint16_t OCR1A, OCR1B;
+extern volatile uint8_t TCCR0A, TCCR0B, TCNT0, OCR0A, OCR0B, TIMSK0, TIFR0;
+extern volatile uint8_t PINB, PINC, PIND, PINE, PINF;
+extern volatile uint8_t DDRB, DDRC, DDRD, DDRE, DDRF;
+extern volatile uint8_t EICRB, EIMSK, EIFR, PCICR, PCMSK0, PCIFR;
+extern volatile uint8_t ADMUX, ADCSRA, ADCSRB, ADCH, ADCL, DIDR0, DIDR2;
+extern volatile uint8_t MCUSR, WDTCSR;
+extern volatile uint8_t UDINT, UDIEN, UDADDR, USBSTA, UDCON;
+extern volatile uint16_t UDFNUM;
+extern volatile uint8_t GPIOR0;
+extern HostGPIOR GPIOR1, GPIOR2;
+extern volatile uint16_t SP;
+
+// SREG
+#define SREG_I    7
+
+// USART1
+#define RXC1      7
+#define TXC1      6
+#define UDRE1     5
+#define FE1       4
+#define DOR1      3
+#define UPE1      2
+#define U2X1      1
+#define RXCIE1    7
+#define TXCIE1    6
+#define UDRIE1    5
+#define RXEN1     4
+#define TXEN1     3
+#define UCSZ11    2
+#define UCSZ10    1
+
+// Timer1
+#define CS10      0
+#define CS11      1
+#define CS12      2
+#define TOIE1     0
+#define OCIE1A    1
+#define OCIE1B    2
+#define TOV1      0
+#define OCF1A     1
+#define OCF1B     2
+
+// Timer0
+#define OCIE0A    1
+#define OCIE0B    2
+#define OCF0A     1
+#define OCF0B     2
+
+// External / pin change interrupts
+#define ISC60     4
+#define ISC61     5
+#define INT6      6
+#define INTF6     6
+#define PCIE0     0
+#define PCIF0     0
+
+// ADC
+#define ADEN      7
+#define ADSC      6
+#define ADATE     5
+#define ADIF      4
+#define ADIE      3
+#define ADPS2     2
+#define ADPS1     1
+#define ADPS0     0
+#define REFS0     6
+#define ADLAR     5
+#define MUX5      5
+#define ADTS2     2
+#define ADTS1     1
+#define ADTS0     0
+#define ADC4D     4
+#define ADC5D     5
+#define ADC6D     6
+#define ADC7D     7
+
+// Watchdog
+#define WDRF      3
+#define WDIE      6
+#define WDE       3
+#define WDCE      4
+#define WDP0      0
+#define WDP1      1
+#define WDP2      2
+#define WDP3      5
+
+// USB device
+#define SUSPI     0
+#define SOFI      2
+#define EORSTI    3
+#define WAKEUPI   4
+
+// Port bits
+#define PB0 0
+#define PB1 1
+#define PB2 2
+#define PB3 3
+#define PB4 4
+#define PB5 5
+#define PB6 6
+#define PB7 7
+#define PC6 6
+#define PC7 7
+#define PD0 0
+#define PD1 1
+#define PD2 2
+#define PD3 3
+#define PD4 4
+#define PD7 7
+#define PE6 6
+#define PF4 4
+#define PF5 5
+#define PF6 6
+#define PF7 7
+
+#define RAMSTART  0x100
+#define RAMEND    0x0AFF
+
+#define _BV(b)               (1 << (b))
+#define bit_is_set(r, b)     ((r) & _BV(b))
+#define bit_is_clear(r, b)   (!((r) & _BV(b)))
+
+#endif  // HOST_AVR_IO_H
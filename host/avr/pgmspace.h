@@ -0,0 +1,14 @@
+#ifndef HOST_AVR_PGMSPACE_H
+#define HOST_AVR_PGMSPACE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s)             (s)
+#define pgm_read_byte(p)    (*(const uint8_t*)(p))
+#define pgm_read_word(p)    (*(const uint16_t*)(p))
+#define strlen_P            strlen
+#define memcpy_P            memcpy
+
+#endif  // HOST_AVR_PGMSPACE_H
@@ -0,0 +1,18 @@
+#ifndef HOST_AVR_WDT_H
+#define HOST_AVR_WDT_H
+
+// The simulated MCU has no watchdog; stalls show up as gaps in the output log
+#define WDTO_15MS   0
+#define WDTO_30MS   1
+#define WDTO_60MS   2
+#define WDTO_120MS  3
+#define WDTO_250MS  4
+#define WDTO_500MS  5
+#define WDTO_1S     6
+#define WDTO_2S     7
+
+static inline void wdt_reset() {}
+static inline void wdt_enable(uint8_t) {}
+static inline void wdt_disable() {}
+
+#endif  // HOST_AVR_WDT_H
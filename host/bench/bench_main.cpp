@@ -0,0 +1,237 @@
+/**
+ * MIDI BytePulse - Host Hot-Path Benchmark
+ *
+ * The CYCLE_BENCH firmware on the simulated MCU, fed the same timeline as
+ * bench/simavr_bench.c (USB script, DIN clock with channel traffic, SYNC_IN
+ * at 1 PPQN), with the GPIOR1/GPIOR2 markers timed on the host clock:
+ *
+ *   bench [bench/host_budget.txt] [--write-budget]
+ *
+ * Host time is not AVR cycles, and a single call is too short to time
+ * reliably, so each path is judged on its mean over the run, best of
+ * BENCH_RUNS runs. The budget file holds the recorded baseline and the
+ * ceiling (baseline + BENCH_TOLERANCE_PCT); exit status 1 when a path is
+ * over its ceiling or never ran. --write-budget records a new baseline.
+ * The best mean still moves by well over 50 % between invocations on a
+ * busy machine, hence the wide tolerance: this catches a path that got
+ * twice as slow, simavr_bench the cycles. Baselines belong to the machine and compiler
+ * that recorded them.
+ */
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "HostSim.h"
+#include "config.h"
+#include "Bench.h"
+
+#define BENCH_RUNS            10
+#define BENCH_TOLERANCE_PCT   100
+#define BENCH_LOOP_US         20
+#define BENCH_END_US          8000000UL
+#define MARKER_COUNT          8
+
+void setup();
+void loop();
+
+// Must match the BENCH_* ids in include/Bench.h
+static const char* const markerNames[MARKER_COUNT] = {
+  NULL, "handleClock", "syncInBurst", "forwardUSBtoDIN", "forwardDINtoUSB",
+  "dinRxIsr", "dinUdreIsr", "syncInIsr"
+};
+
+typedef std::chrono::steady_clock Clock;
+
+struct Marker {
+  Clock::time_point start;
+  bool open;
+  unsigned long calls;
+  double totalNs;
+  double bestMeanNs;     // Lowest mean of the runs
+  unsigned long baseline;
+  unsigned long budget;
+};
+
+static Marker markers[MARKER_COUNT];
+
+static void markerEnter(uint8_t id) {
+  if (!id || id >= MARKER_COUNT) return;
+  markers[id].start = Clock::now();
+  markers[id].open = true;
+}
+
+static void markerExit(uint8_t id) {
+  Clock::time_point end = Clock::now();
+  if (!id || id >= MARKER_COUNT || !markers[id].open) return;
+  Marker& m = markers[id];
+  m.open = false;
+  m.calls++;
+  m.totalNs += std::chrono::duration<double, std::nano>(end - m.start).count();
+}
+
+static uint64_t us(uint64_t value) {
+  return value * HOST_CYCLES_PER_US;
+}
+
+// Queues bytes back to back on the wire, 320 us each; returns the end time
+static uint64_t addDin(uint64_t at, const uint8_t* bytes, int count) {
+  for (int i = 0; i < count; i++) {
+    HostSim::addDinByte(at, bytes[i]);
+    at += us(320);
+  }
+  return at;
+}
+
+// Same stimuli as buildStimuli() in bench/simavr_bench.c
+static void buildStimuli() {
+  HostSim::setInputPin(SYNC_RATE_PIN_1, LOW);      // 1 PPQN
+  HostSim::setInputPin(SYNC_IN_DETECT_PIN, HIGH);
+
+  static const uint8_t start[] = { 0xFA };
+  static const uint8_t stop[] = { 0xFC };
+  uint64_t t = addDin(us(3000000), start, 1);
+  for (int tick = 0; tick < 96; tick++) {
+    uint64_t at = us(3000000) + us(1000) + (uint64_t)tick * us(20833);
+    static const uint8_t clock[] = { 0xF8 };
+    addDin(at, clock, 1);
+    uint8_t msg[3];
+    switch (tick % 4) {
+      case 0: msg[0] = 0x90; msg[1] = 60; msg[2] = 100; break;
+      case 1: msg[0] = 0xB0; msg[1] = 1; msg[2] = tick & 0x7F; break;
+      case 2: msg[0] = 0xE0; msg[1] = 0; msg[2] = tick & 0x7F; break;
+      default: msg[0] = 0x80; msg[1] = 60; msg[2] = 0; break;
+    }
+    t = addDin(at + us(2000), msg, 3);
+  }
+  addDin(t + us(5000), stop, 1);
+
+  for (uint64_t at = us(5500000); at < us(7500000); at += us(500000)) {
+    HostSim::addSyncInEdge(at);
+  }
+}
+
+// The firmware keeps its state in statics, so each run is its own process
+static int runOnce() {
+  HostSim::reset();
+  buildStimuli();
+  GPIOR1.onWrite = markerEnter;
+  GPIOR2.onWrite = markerExit;
+
+  HostSim::setInterruptsEnabled(true);   // The core's init() enables interrupts before setup()
+  setup();
+  while (HostSim::cycles() < us(BENCH_END_US)) {
+    loop();
+    HostSim::advance(BENCH_LOOP_US * HOST_CYCLES_PER_US);
+  }
+
+  // One line per path for the parent: "<id> <calls> <total ns>"
+  for (int i = 1; i < MARKER_COUNT; i++) {
+    printf("%d %lu %.0f\n", i, markers[i].calls, markers[i].totalNs);
+  }
+  return 0;
+}
+
+static bool collectRun(const char* self) {
+  char command[512];
+  snprintf(command, sizeof(command), "\"%s\" --run", self);
+  FILE* run = popen(command, "r");
+  if (!run) return false;
+
+  int id;
+  unsigned long calls;
+  double totalNs;
+  while (fscanf(run, "%d %lu %lf", &id, &calls, &totalNs) == 3) {
+    if (id <= 0 || id >= MARKER_COUNT || !calls) continue;
+    Marker& m = markers[id];
+    double mean = totalNs / calls;
+    m.calls = calls;
+    if (!m.bestMeanNs || mean < m.bestMeanNs) m.bestMeanNs = mean;
+  }
+  return pclose(run) == 0;
+}
+
+// ---------------------------------------------------------------------------
+// Budget file: "<name> <baseline ns> <ceiling ns>" per line, '#' comments
+
+static int loadBudget(const char* path) {
+  FILE* f = fopen(path, "r");
+  if (!f) {
+    perror(path);
+    return -1;
+  }
+  char line[128];
+  while (fgets(line, sizeof(line), f)) {
+    char name[64];
+    unsigned long baseline;
+    unsigned long budget;
+    if (line[0] == '#') continue;
+    if (sscanf(line, "%63s %lu %lu", name, &baseline, &budget) != 3) continue;
+    for (int i = 1; i < MARKER_COUNT; i++) {
+      if (!strcmp(name, markerNames[i])) {
+        markers[i].baseline = baseline;
+        markers[i].budget = budget;
+      }
+    }
+  }
+  fclose(f);
+  return 0;
+}
+
+static int writeBudget(const char* path) {
+  FILE* f = fopen(path, "w");
+  if (!f) {
+    perror(path);
+    return -1;
+  }
+  fprintf(f, "# Mean host ns per call, best of %d runs (host/bench, CYCLE_BENCH build)\n", BENCH_RUNS);
+  fprintf(f, "# <path> <baseline> <ceiling = baseline + %d %%>\n", BENCH_TOLERANCE_PCT);
+  fprintf(f, "# Regenerate with: bench bench/host_budget.txt --write-budget\n");
+  for (int i = 1; i < MARKER_COUNT; i++) {
+    if (!markers[i].calls) continue;
+    unsigned long baseline = (unsigned long)(markers[i].bestMeanNs + 0.5);
+    fprintf(f, "%-16s %6lu %6lu\n", markerNames[i], baseline,
+            baseline + baseline * BENCH_TOLERANCE_PCT / 100);
+  }
+  fclose(f);
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1 && !strcmp(argv[1], "--run")) return runOnce();
+
+  const char* budgetPath = argc > 1 ? argv[1] : "bench/host_budget.txt";
+  bool rewrite = argc > 2 && !strcmp(argv[2], "--write-budget");
+  if (!rewrite && loadBudget(budgetPath) != 0) return 2;
+
+  for (int run = 0; run < BENCH_RUNS; run++) {
+    if (!collectRun(argv[0])) {
+      fprintf(stderr, "bench run %d failed\n", run + 1);
+      return 2;
+    }
+  }
+
+  if (rewrite) return writeBudget(budgetPath) ? 2 : 0;
+
+  int failed = 0;
+  printf("%-16s %8s %8s %8s %8s  %s\n", "hot path", "calls", "mean ns", "baseline", "budget", "result");
+  for (int i = 1; i < MARKER_COUNT; i++) {
+    const Marker& m = markers[i];
+    const char* result = "ok";
+    if (!m.calls && !m.budget) {
+      result = "not in profile";
+    } else if (!m.calls) {
+      result = "NOT EXERCISED";
+      failed = 1;
+    } else if (!m.budget) {
+      result = "no budget";
+    } else if (m.bestMeanNs > m.budget) {
+      result = "OVER BUDGET";
+      failed = 1;
+    }
+    printf("%-16s %8lu %8.0f %8lu %8lu  %s\n", markerNames[i], m.calls, m.bestMeanNs,
+           m.baseline, m.budget, result);
+  }
+  return failed;
+}
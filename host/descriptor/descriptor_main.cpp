@@ -0,0 +1,85 @@
+/**
+ * MIDI BytePulse - USB Descriptor Check
+ *
+ * Collects the configuration descriptor block UsbMidi::getInterface() sends
+ * and walks it by bLength the way a host does. Fails when a descriptor is
+ * shorter than its own header, runs past the end, or when the lengths don't
+ * add up to what was sent; also checks the MIDI Streaming header's
+ * wTotalLength. Exit status 0 = well formed.
+ *   descriptor [-v]     (-v lists every descriptor)
+ */
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <string.h>
+#include "HostSim.h"
+#include "UsbMidi.h"
+
+#define CS_INTERFACE   0x24
+#define MS_HEADER      0x01
+#define AUDIO_STREAMING_SUBCLASS  0x03
+
+static uint8_t block[512];
+static int blockLength = 0;
+
+static void collect(const uint8_t* data, int len) {
+  if (blockLength + len > (int)sizeof(block)) len = sizeof(block) - blockLength;
+  memcpy(block + blockLength, data, len);
+  blockLength += len;
+}
+
+// getInterface() is the core's hook, protected in PluggableUSBModule
+class DescriptorProbe : public UsbMidi {
+public:
+  int send(uint8_t* interfaceCount) { return getInterface(interfaceCount); }
+};
+
+int main(int argc, char** argv) {
+  bool verbose = argc > 1 && !strcmp(argv[1], "-v");
+
+  HostSim::reset();
+  HostSim::onUsbControl = collect;
+  DescriptorProbe probe;
+  uint8_t interfaces = 0;
+  int sent = probe.send(&interfaces);
+
+  int errors = 0;
+  int offset = 0;
+  int streamingHeader = -1;
+  bool streaming = false;
+  while (offset < blockLength) {
+    uint8_t len = block[offset];
+    if (len < 2 || offset + len > blockLength) {
+      printf("FAIL descriptor at %d: bLength %u\n", offset, len);
+      errors++;
+      break;
+    }
+    uint8_t type = block[offset + 1];
+    if (verbose) printf("%4d  len %2u  type %02X  subtype %02X\n", offset, len, type, block[offset + 2]);
+    if (type == 4) streaming = block[offset + 6] == AUDIO_STREAMING_SUBCLASS;
+    if (streaming && type == CS_INTERFACE && block[offset + 2] == MS_HEADER) streamingHeader = offset;
+    offset += len;
+  }
+
+  if (sent != blockLength) {
+    printf("FAIL getInterface() returned %d, sent %d bytes\n", sent, blockLength);
+    errors++;
+  }
+  if (streamingHeader < 0) {
+    printf("FAIL no MIDI Streaming header\n");
+    errors++;
+  } else {
+    int total = block[streamingHeader + 5] | block[streamingHeader + 6] << 8;
+    if (total != blockLength - streamingHeader) {
+      printf("FAIL MS header wTotalLength %d, class-specific block is %d bytes\n", total, blockLength - streamingHeader);
+      errors++;
+    }
+  }
+  if (interfaces != 2) {
+    printf("FAIL %u interfaces reported\n", interfaces);
+    errors++;
+  }
+
+  printf("%s: %d bytes, %u interfaces\n", errors ? "FAIL" : "ok", blockLength, interfaces);
+  return errors ? 1 : 0;
+}
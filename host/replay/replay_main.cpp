@@ -0,0 +1,187 @@
+/**
+ * MIDI BytePulse - Capture Replay
+ *
+ * Feeds a capture (.bpc) through the real setup()/loop() on the simulated MCU
+ * and writes every output event with its time to the log:
+ *   replay [--loop-us N] [-o out.log] capture.bpc
+ *
+ * Capture format, one item per line ('#' starts a comment):
+ *   rate <1|2|4|6|24>          Rate switch position (default 2)
+ *   sync_in_connected <0|1>    SYNC_IN jack detect (default 1)
+ *   usb_host <0|1>             Host enumerated (default 1)
+ *   <us> din <hex> [<hex>...]  Bytes received on DIN IN (stop bit time; a run is 320 us per byte)
+ *   <us> usb <hh> <b1> <b2> <b3>  USB-MIDI packet reaching the OUT endpoint
+ *   <us> sync_in               SYNC_IN rising edge
+ *   <us> end                   End of capture (default: 1 s after the last input)
+ */
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "HostSim.h"
+#include "config.h"
+#include "UsbMidi.h"
+
+#define DEFAULT_LOOP_US  20   // Idle loop() pass on the 32U4, measured with the tracer
+
+void setup();
+void loop();
+
+static uint8_t ratePin(int rate) {
+  switch (rate) {
+    case 1: return SYNC_RATE_PIN_1;
+    case 2: return SYNC_RATE_PIN_2;
+    case 4: return SYNC_RATE_PIN_3;
+    case 6: return SYNC_RATE_PIN_4;
+    case 24: return SYNC_RATE_PIN_5;
+  }
+  return 0;
+}
+
+static const char* const SEPARATORS = " \t\r\n";
+
+static int intArgument(int fallback) {
+  const char* token = strtok(nullptr, SEPARATORS);
+  return token ? atoi(token) : fallback;
+}
+
+// Returns the end time in us, or 0 on a parse error
+static uint64_t loadCapture(FILE* in, const char* name) {
+  char line[512];
+  unsigned lineNo = 0;
+  uint64_t last = 0;
+  uint64_t end = 0;
+
+  HostSim::setInputPin(ratePin(2), LOW);
+  HostSim::setInputPin(SYNC_IN_DETECT_PIN, HIGH);
+
+  while (fgets(line, sizeof(line), in)) {
+    lineNo++;
+    char* hash = strchr(line, '#');
+    if (hash) *hash = '\0';
+
+    char* token = strtok(line, SEPARATORS);
+    if (!token) continue;
+
+    if (!strcmp(token, "rate")) {
+      int rate = intArgument(0);
+      if (!ratePin(rate)) {
+        fprintf(stderr, "%s:%u: unknown rate %d\n", name, lineNo, rate);
+        return 0;
+      }
+      HostSim::setInputPin(ratePin(2), HIGH);
+      HostSim::setInputPin(ratePin(rate), LOW);
+      continue;
+    }
+    if (!strcmp(token, "sync_in_connected")) {
+      HostSim::setInputPin(SYNC_IN_DETECT_PIN, intArgument(1) ? HIGH : LOW);
+      continue;
+    }
+    if (!strcmp(token, "usb_host")) {
+      HostSim::setUsbHost(intArgument(1) != 0);
+      continue;
+    }
+
+    char* endp;
+    uint64_t us = strtoull(token, &endp, 10);
+    const char* kind = strtok(nullptr, SEPARATORS);
+    if (*endp || !kind) {
+      fprintf(stderr, "%s:%u: expected '<us> <din|usb|sync_in|end> ...'\n", name, lineNo);
+      return 0;
+    }
+    uint64_t cycle = us * HOST_CYCLES_PER_US;
+    if (us > last) last = us;
+
+    if (!strcmp(kind, "din")) {
+      for (char* hex = strtok(nullptr, SEPARATORS); hex; hex = strtok(nullptr, SEPARATORS)) {
+        HostSim::addDinByte(cycle, (uint8_t)strtoul(hex, nullptr, 16));
+        cycle += HOST_DIN_BYTE_CYCLES;
+      }
+    } else if (!strcmp(kind, "usb")) {
+      uint8_t packet[4] = {0};
+      for (uint8_t i = 0; i < 4; i++) {
+        const char* hex = strtok(nullptr, SEPARATORS);
+        packet[i] = hex ? (uint8_t)strtoul(hex, nullptr, 16) : 0;
+      }
+      HostSim::addUsbPacket(cycle, packet);
+    } else if (!strcmp(kind, "sync_in")) {
+      HostSim::addSyncInEdge(cycle);
+    } else if (!strcmp(kind, "end")) {
+      end = us;
+    } else {
+      fprintf(stderr, "%s:%u: unknown event '%s'\n", name, lineNo, kind);
+      return 0;
+    }
+  }
+  return end ? end : last + 1000000UL;
+}
+
+int main(int argc, char** argv) {
+  const char* capturePath = nullptr;
+  const char* logPath = nullptr;
+  unsigned loopUs = DEFAULT_LOOP_US;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--loop-us") && i + 1 < argc) {
+      loopUs = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+      logPath = argv[++i];
+    } else if (argv[i][0] != '-' || !strcmp(argv[i], "-")) {
+      capturePath = argv[i];
+    } else {
+      capturePath = nullptr;
+      break;
+    }
+  }
+  if (!capturePath || loopUs == 0) {
+    fprintf(stderr, "usage: %s [--loop-us N] [-o out.log] capture.bpc\n", argv[0]);
+    return 2;
+  }
+
+  FILE* in = strcmp(capturePath, "-") ? fopen(capturePath, "r") : stdin;
+  if (!in) {
+    perror(capturePath);
+    return 2;
+  }
+  FILE* log = logPath ? fopen(logPath, "w") : stdout;
+  if (!log) {
+    perror(logPath);
+    return 2;
+  }
+
+  HostSim::reset();
+  uint64_t endUs = loadCapture(in, capturePath);
+  if (in != stdin) fclose(in);
+  if (!endUs) return 2;
+
+  HostSim::setLog(log);
+  HostSim::setInterruptsEnabled(true);   // The core's init() enables interrupts before setup()
+  setup();
+
+  uint64_t endCycle = endUs * HOST_CYCLES_PER_US;
+  uint32_t rxPasses = 0;
+  uint32_t rxCycles = 0;   // Endpoint cycles of the passes that received (idle polls left out)
+  while (HostSim::cycles() < endCycle) {
+    uint32_t rxBefore = HostSim::usbRecvBytes();
+    uint32_t cyclesBefore = HostSim::usbRecvCycles();
+    loop();
+    if (HostSim::usbRecvBytes() != rxBefore) {
+      rxPasses++;
+      rxCycles += HostSim::usbRecvCycles() - cyclesBefore;
+    }
+    HostSim::advance(loopUs * HOST_CYCLES_PER_US);
+  }
+
+  fprintf(stderr, "%s: %.3f s replayed, USB OUT backlog high-water %u packets\n",
+          capturePath, endUs / 1e6, HostSim::maxUsbOutBacklog());
+  // Endpoint cycles from the HostSim cost model, not a measurement
+  uint32_t rxPackets = HostSim::usbRecvBytes() / 4;
+  if (rxPackets) {
+    fprintf(stderr, "%s: USB RX %lu packets in %lu passes (%.2f per pass, largest %u), %.1f endpoint cycles/packet\n",
+            capturePath, (unsigned long)rxPackets, (unsigned long)rxPasses, (double)rxPackets / rxPasses,
+            usbMidi.getRxMaxBatch(), (double)rxCycles / rxPackets);
+  }
+  if (log != stdout) fclose(log);
+  return 0;
+}
@@ -0,0 +1,250 @@
+#include "Router.h"
+#include "HostPins.h"
+#include "config.h"
+#include "DinSerial.h"
+#include <Arduino.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Firmware vectors (ISR() in avr/interrupt.h makes them plain C functions)
+extern "C" void INT6_vect(void);
+extern "C" void TIMER1_OVF_vect(void);
+extern "C" void USART1_RX_vect(void) __attribute__((weak));  // Not in profiles without DIN
+
+#define TIMER1_US_PER_TICK  4
+
+int Router::fds[ROUTER_STREAM_COUNT] = { -1, -1, -1, -1, -1, -1 };
+Router::Buffer Router::buffers[ROUTER_STREAM_COUNT];
+uint64_t Router::counts[ROUTER_STREAM_COUNT];
+
+uint64_t Router::origin = 0;
+uint16_t Router::timer1Epoch = 0;
+bool Router::iFlag = true;   // The core's init() enables interrupts before setup()
+uint8_t Router::dinRxLatch = 0;
+uint8_t Router::pinLevels[32];
+uint8_t Router::pinInputs[32] = {
+  HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH,
+  HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH
+};
+
+static bool isInput(RouterStream stream) {
+  return stream < ROUTER_DIN_OUT;
+}
+
+bool Router::open(RouterStream stream, const char* path) {
+  int fd;
+  if (!strcmp(path, "-")) {
+    fd = isInput(stream) ? STDIN_FILENO : STDOUT_FILENO;
+  } else if (isInput(stream)) {
+    fd = ::open(path, O_RDONLY);
+  } else {
+    fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  }
+  if (fd < 0) return false;
+
+  // Inputs are polled; outputs stay blocking so a slow reader holds the router back
+  if (isInput(stream)) fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  fds[stream] = fd;
+  return true;
+}
+
+bool Router::isOpen(RouterStream stream) {
+  return fds[stream] >= 0;
+}
+
+uint64_t Router::micros() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  uint64_t us = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+  if (origin == 0) origin = us;
+  return us - origin;
+}
+
+// ---------------------------------------------------------------------------
+// Streams
+
+bool Router::hasInput() {
+  // A trailing partial USB packet can never be delivered
+  return buffers[ROUTER_DIN_IN].size() || buffers[ROUTER_USB_IN].size() >= 4 ||
+         buffers[ROUTER_SYNC_IN].size() || dinSerial.available() > 0;
+}
+
+bool Router::poll(int timeoutMs) {
+  struct pollfd waits[ROUTER_DIN_OUT];
+  RouterStream streams[ROUTER_DIN_OUT];
+  nfds_t count = 0;
+  bool open = false;
+
+  for (uint8_t s = ROUTER_DIN_IN; s < ROUTER_DIN_OUT; s++) {
+    if (fds[s] < 0) continue;
+    open = true;
+    if (buffers[s].end == ROUTER_BUFFER_SIZE) continue;
+    waits[count].fd = fds[s];
+    waits[count].events = POLLIN;
+    streams[count++] = (RouterStream)s;
+  }
+
+  // Inputs with a full buffer aren't read until loop() has consumed some of it
+  if (count && ::poll(waits, count, hasInput() ? 0 : timeoutMs) > 0) {
+    for (nfds_t i = 0; i < count; i++) {
+      if (!waits[i].revents) continue;
+      RouterStream s = streams[i];
+      Buffer& buffer = buffers[s];
+      ssize_t got = read(fds[s], buffer.data + buffer.end, ROUTER_BUFFER_SIZE - buffer.end);
+      if (got > 0) {
+        buffer.end += got;
+      } else if (got == 0 || (errno != EAGAIN && errno != EINTR)) {
+        if (fds[s] != STDIN_FILENO) close(fds[s]);
+        fds[s] = -1;
+      }
+    }
+  }
+
+  return open || hasInput();
+}
+
+void Router::consume(RouterStream stream, uint32_t length) {
+  Buffer& buffer = buffers[stream];
+  buffer.start += length;
+  counts[stream] += length;
+  if (buffer.start == buffer.end) {
+    buffer.start = buffer.end = 0;
+  } else if (buffer.start > ROUTER_BUFFER_SIZE / 2) {
+    memmove(buffer.data, buffer.data + buffer.start, buffer.size());
+    buffer.end -= buffer.start;
+    buffer.start = 0;
+  }
+}
+
+void Router::append(RouterStream stream, const void* data, uint32_t length) {
+  if (fds[stream] < 0) return;
+  Buffer& buffer = buffers[stream];
+  if (buffer.end + length > ROUTER_BUFFER_SIZE) flushOutputs();
+  memcpy(buffer.data + buffer.end, data, length);
+  buffer.end += length;
+}
+
+void Router::flushOutputs() {
+  for (uint8_t s = ROUTER_DIN_OUT; s < ROUTER_STREAM_COUNT; s++) {
+    Buffer& buffer = buffers[s];
+    while (buffer.size()) {
+      ssize_t done = write(fds[s], buffer.data + buffer.start, buffer.size());
+      if (done < 0 && errno == EINTR) continue;
+      if (done <= 0) {
+        // Reader went away: drop this output from now on
+        buffer.start = buffer.end;
+        fds[s] = -1;
+        break;
+      }
+      buffer.start += done;
+    }
+    buffer.start = buffer.end = 0;
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Interrupts
+
+void Router::dispatchInterrupts() {
+  uint16_t epoch = (micros() / TIMER1_US_PER_TICK) >> 16;
+  while (timer1Epoch != epoch) {
+    timer1Epoch++;
+    if (TIMSK1 & (1 << TOIE1)) TIMER1_OVF_vect();
+  }
+
+  Buffer& edges = buffers[ROUTER_SYNC_IN];
+  if (edges.size()) {
+    if (EIMSK & (1 << INT6)) {
+      // One handler run per edge; the firmware debounce decides what counts
+      for (uint32_t i = 0; i < edges.size(); i++) INT6_vect();
+    }
+    consume(ROUTER_SYNC_IN, edges.size());
+  }
+
+  Buffer& din = buffers[ROUTER_DIN_IN];
+  if (din.size() && (UCSR1B & (1 << RXCIE1))) {
+    uint32_t room = (DIN_RX_BUFFER_SIZE - 1) - dinSerial.available();
+    uint32_t length = din.size() < room ? din.size() : room;
+    for (uint32_t i = 0; i < length; i++) {
+      dinRxLatch = din.data[din.start + i];
+      USART1_RX_vect();
+    }
+    consume(ROUTER_DIN_IN, length);
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Register and core hooks
+
+void Router::writeUdr(uint8_t value) {
+  append(ROUTER_DIN_OUT, &value, 1);
+  counts[ROUTER_DIN_OUT]++;
+}
+
+uint16_t Router::readTimer1() {
+  return micros() / TIMER1_US_PER_TICK;
+}
+
+void Router::setInputPin(uint8_t pin, uint8_t level) {
+  if (pin < sizeof(pinInputs)) pinInputs[pin] = level;
+  hostLatchInputs(pinInputs);
+}
+
+void Router::pinWrite(uint8_t pin, uint8_t level) {
+  if (pin >= sizeof(pinLevels)) return;
+  level = level ? HIGH : LOW;
+  if (pinLevels[pin] == level) return;
+  pinLevels[pin] = level;
+
+  if (fds[ROUTER_PINS_OUT] < 0) return;
+  char line[48];
+  int length = snprintf(line, sizeof(line), "%llu %s %u\n",
+                        (unsigned long long)micros(), hostPinName(pin), level);
+  append(ROUTER_PINS_OUT, line, length);
+  counts[ROUTER_PINS_OUT]++;
+}
+
+uint8_t Router::pinRead(uint8_t pin) {
+  return pin < sizeof(pinInputs) ? pinInputs[pin] : HIGH;
+}
+
+uint8_t Router::readPort(uint8_t port) {
+  uint8_t value = 0;
+  for (uint8_t bit = 0; bit < 8; bit++) {
+    uint8_t pin = hostPortPins[port][bit];
+    if (pin != HOST_NO_PIN && pinLevels[pin]) value |= 1 << bit;
+  }
+  return value;
+}
+
+void Router::writePort(uint8_t port, uint8_t value) {
+  for (uint8_t bit = 0; bit < 8; bit++) {
+    uint8_t pin = hostPortPins[port][bit];
+    if (pin != HOST_NO_PIN) pinWrite(pin, (value >> bit) & 1);
+  }
+}
+
+uint8_t Router::usbAvailable() {
+  // Whole packets only, at most one 64-byte bank
+  uint32_t length = buffers[ROUTER_USB_IN].size() & ~3u;
+  return length < 64 ? length : 64;
+}
+
+int Router::usbRecv(void* data, int len) {
+  int available = usbAvailable();
+  if (len > available) len = available;
+  memcpy(data, buffers[ROUTER_USB_IN].data + buffers[ROUTER_USB_IN].start, len);
+  consume(ROUTER_USB_IN, len);
+  return len;
+}
+
+int Router::usbSend(const void* data, int len) {
+  append(ROUTER_USB_OUT, data, len);
+  counts[ROUTER_USB_OUT] += len;
+  return len;
+}
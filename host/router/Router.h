@@ -0,0 +1,99 @@
+/**
+ * MIDI BytePulse - Linux Router Backend
+ *
+ * Runs the unmodified routing and sync core as a Linux process. DIN, USB and
+ * SYNC_IN become byte streams (stdin/stdout, FIFOs or regular files) and time
+ * comes from CLOCK_MONOTONIC. Unlike HostSim nothing here models the MCU:
+ *   - DIN OUT is never busy, every byte goes straight to the output stream
+ *   - the USB IN endpoint always has room, OUT delivers up to one 64-byte bank
+ *     of whatever input is buffered per loop() pass
+ *   - "interrupts" (Timer1 overflow, DIN RX, SYNC_IN) are dispatched between
+ *     loop() passes; DIN RX only fills the free part of the firmware's ring, so
+ *     file input is never dropped however fast it is read
+ *
+ * Stream formats:
+ *   DIN in/out     raw MIDI bytes
+ *   USB in/out     4-byte USB-MIDI event packets (cable 0 = DIN port, 1 = clock)
+ *   SYNC_IN        every byte read is one rising edge
+ *   pins           text, one "<us> SYNC_OUT 1" line per edge
+ */
+
+#ifndef ROUTER_H
+#define ROUTER_H
+
+#include <stdint.h>
+
+#define ROUTER_BUFFER_SIZE  65536   // Per stream; inputs are read no further ahead than this
+
+enum RouterStream {
+  ROUTER_DIN_IN,
+  ROUTER_USB_IN,
+  ROUTER_SYNC_IN,
+  ROUTER_DIN_OUT,
+  ROUTER_USB_OUT,
+  ROUTER_PINS_OUT,
+  ROUTER_STREAM_COUNT
+};
+
+class Router {
+public:
+  // "-" is stdin/stdout; FIFOs open blocking, so start the other end too
+  static bool open(RouterStream stream, const char* path);
+  static bool isOpen(RouterStream stream);
+
+  // Microseconds since start (CLOCK_MONOTONIC)
+  static uint64_t micros();
+
+  // Reads whatever the inputs have ready, waiting up to timeoutMs when nothing is
+  // buffered. Returns false once every input stream is closed and drained.
+  static bool poll(int timeoutMs);
+  static bool hasInput();
+
+  // Runs the due "interrupt handlers": Timer1 overflow, SYNC_IN edges, DIN RX bytes
+  static void dispatchInterrupts();
+
+  static void flushOutputs();
+
+  static void setInputPin(uint8_t pin, uint8_t level);
+
+  // Register and core hooks (RouterCore.cpp)
+  static bool interruptsEnabled() { return iFlag; }
+  static void setInterruptsEnabled(bool on) { iFlag = on; }
+  static uint8_t readUdr() { return dinRxLatch; }
+  static void writeUdr(uint8_t value);
+  static uint16_t readTimer1();
+  static void pinWrite(uint8_t pin, uint8_t level);
+  static uint8_t pinRead(uint8_t pin);
+  static uint8_t readPort(uint8_t port);
+  static void writePort(uint8_t port, uint8_t value);
+  static uint8_t usbAvailable();
+  static int usbRecv(void* data, int len);
+  static int usbSend(const void* data, int len);
+
+  // Bytes (edges for SYNC_IN, lines for pins) through each stream, for the exit report
+  static uint64_t count(RouterStream stream) { return counts[stream]; }
+
+private:
+  struct Buffer {
+    uint8_t data[ROUTER_BUFFER_SIZE];
+    uint32_t start;   // Bytes [start, end) are buffered
+    uint32_t end;
+    uint32_t size() const { return end - start; }
+  };
+
+  static void append(RouterStream stream, const void* data, uint32_t length);
+  static void consume(RouterStream stream, uint32_t length);
+
+  static int fds[ROUTER_STREAM_COUNT];
+  static Buffer buffers[ROUTER_STREAM_COUNT];
+  static uint64_t counts[ROUTER_STREAM_COUNT];
+
+  static uint64_t origin;
+  static uint16_t timer1Epoch;
+  static bool iFlag;
+  static uint8_t dinRxLatch;
+  static uint8_t pinLevels[32];
+  static uint8_t pinInputs[32];
+};
+
+#endif  // ROUTER_H
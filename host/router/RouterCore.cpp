@@ -0,0 +1,147 @@
+// Arduino core, register and USB entry points for the Linux router, backed by Router
+#include <Arduino.h>
+#include <PluggableUSB.h>
+#include <time.h>
+#include "Router.h"
+
+// ---------------------------------------------------------------------------
+// Registers
+
+HostSREG SREG;
+HostUDR1 UDR1;
+HostUCSR1A UCSR1A;
+HostTCNT1 TCNT1;
+HostTIFR1 TIFR1;
+HostPort PORTB = {0}, PORTC = {1}, PORTD = {2}, PORTE = {3}, PORTF = {4};
+
+HostSREG::operator uint8_t() {
+  return Router::interruptsEnabled() ? (1 << SREG_I) : 0;
+}
+
+HostSREG& HostSREG::operator=(uint8_t v) {
+  Router::setInterruptsEnabled(v & (1 << SREG_I));
+  return *this;
+}
+
+HostUDR1::operator uint8_t() {
+  return Router::readUdr();
+}
+
+HostUDR1& HostUDR1::operator=(uint8_t v) {
+  Router::writeUdr(v);
+  return *this;
+}
+
+HostUCSR1A::operator uint8_t() {
+  // The transmitter is always ready: DIN OUT has no wire speed here
+  return (1 << UDRE1);
+}
+
+HostUCSR1A& HostUCSR1A::operator=(uint8_t) {
+  return *this;
+}
+
+HostTCNT1::operator uint16_t() {
+  return Router::readTimer1();
+}
+
+HostTCNT1& HostTCNT1::operator=(uint16_t) {
+  return *this;
+}
+
+HostTIFR1::operator uint8_t() {
+  return 0;
+}
+
+HostTIFR1& HostTIFR1::operator=(uint8_t) {
+  return *this;
+}
+
+HostPort::operator uint8_t() {
+  return Router::readPort(port);
+}
+
+HostPort& HostPort::operator=(uint8_t v) {
+  Router::writePort(port, v);
+  return *this;
+}
+
+void cli() {
+  Router::setInterruptsEnabled(false);
+}
+
+void sei() {
+  Router::setInterruptsEnabled(true);
+}
+
+// ---------------------------------------------------------------------------
+// Arduino core
+
+unsigned long millis() {
+  return Router::micros() / 1000;
+}
+
+unsigned long micros() {
+  return Router::micros();
+}
+
+void delay(unsigned long ms) {
+  delayMicroseconds(ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+  struct timespec ts = { (time_t)(us / 1000000), (long)(us % 1000000) * 1000 };
+  nanosleep(&ts, nullptr);
+}
+
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  Router::pinWrite(pin, value);
+}
+
+int digitalRead(uint8_t pin) {
+  return Router::pinRead(pin);
+}
+
+int analogRead(uint8_t) {
+  return 0;
+}
+
+// ---------------------------------------------------------------------------
+// USB core: always configured, the IN endpoint always has room
+
+PluggableUSB_& PluggableUSB() {
+  static PluggableUSB_ instance;
+  return instance;
+}
+
+bool USBDevice_::configured() {
+  return true;
+}
+
+bool USBDevice_::isSuspended() {
+  return false;
+}
+
+int USB_SendControl(uint8_t, const void*, int len) {
+  return len;
+}
+
+uint8_t USB_Available(uint8_t) {
+  return Router::usbAvailable();
+}
+
+int USB_Recv(uint8_t, void* data, int len) {
+  return Router::usbRecv(data, len);
+}
+
+uint8_t USB_SendSpace(uint8_t) {
+  return USB_EP_SIZE;
+}
+
+int USB_Send(uint8_t, const void* data, int len) {
+  return Router::usbSend(data, len);
+}
+
+void USB_Flush(uint8_t) {}
@@ -0,0 +1,138 @@
+/**
+ * MIDI BytePulse - Linux Software Router
+ *
+ * Runs the real setup()/loop() against byte streams instead of the Pro Micro's
+ * DIN, USB and SYNC_IN (formats in Router.h; "-" is stdin/stdout):
+ *   router [--din-in P] [--usb-in P] [--sync-in P] [--din-out P] [--usb-out P]
+ *          [--pins P] [--rate <1|2|4|6|24>] [--linger-ms N]
+ *
+ * Runs until every input has ended (then --linger-ms longer, so pulse widths and
+ * source timeouts can expire) or until SIGINT/SIGTERM, and prints the totals and
+ * throughput to stderr. With no input streams it runs until interrupted.
+ *
+ *   mkfifo /tmp/din && router --din-in /tmp/din --usb-out - | xxd
+ *   router --din-in dump.mid --usb-out /dev/null     # benchmark the DIN -> USB path
+ */
+
+#include <Arduino.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Router.h"
+#include "config.h"
+
+#define IDLE_WAIT_MS  1   // poll() timeout with nothing buffered: keeps timers at 1 ms resolution
+
+void setup();
+void loop();
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void requestStop(int) {
+  stopRequested = 1;
+}
+
+static uint8_t ratePin(int rate) {
+  switch (rate) {
+    case 1: return SYNC_RATE_PIN_1;
+    case 2: return SYNC_RATE_PIN_2;
+    case 4: return SYNC_RATE_PIN_3;
+    case 6: return SYNC_RATE_PIN_4;
+    case 24: return SYNC_RATE_PIN_5;
+  }
+  return 0;
+}
+
+static const struct {
+  const char* option;
+  RouterStream stream;
+} streamOptions[] = {
+  { "--din-in", ROUTER_DIN_IN },
+  { "--usb-in", ROUTER_USB_IN },
+  { "--sync-in", ROUTER_SYNC_IN },
+  { "--din-out", ROUTER_DIN_OUT },
+  { "--usb-out", ROUTER_USB_OUT },
+  { "--pins", ROUTER_PINS_OUT },
+};
+
+static void usage(const char* name) {
+  fprintf(stderr, "usage: %s [--din-in P] [--usb-in P] [--sync-in P] [--din-out P] [--usb-out P]\n"
+                  "       [--pins P] [--rate <1|2|4|6|24>] [--linger-ms N]\n", name);
+}
+
+int main(int argc, char** argv) {
+  int rate = 2;
+  unsigned long lingerMs = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 >= argc) {
+      usage(argv[0]);
+      return 2;
+    }
+    const char* value = argv[++i];
+    bool known = false;
+    for (size_t s = 0; s < sizeof(streamOptions) / sizeof(streamOptions[0]); s++) {
+      if (strcmp(argv[i - 1], streamOptions[s].option)) continue;
+      if (!Router::open(streamOptions[s].stream, value)) {
+        perror(value);
+        return 2;
+      }
+      known = true;
+    }
+    if (!strcmp(argv[i - 1], "--rate")) {
+      rate = atoi(value);
+      known = ratePin(rate) != 0;
+    } else if (!strcmp(argv[i - 1], "--linger-ms")) {
+      lingerMs = strtoul(value, nullptr, 10);
+      known = true;
+    }
+    if (!known) {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  bool anyInput = Router::isOpen(ROUTER_DIN_IN) || Router::isOpen(ROUTER_USB_IN) ||
+                  Router::isOpen(ROUTER_SYNC_IN);
+  Router::setInputPin(ratePin(rate), LOW);
+  Router::setInputPin(SYNC_IN_DETECT_PIN, Router::isOpen(ROUTER_SYNC_IN) ? HIGH : LOW);
+
+  signal(SIGINT, requestStop);
+  signal(SIGTERM, requestStop);
+  signal(SIGPIPE, SIG_IGN);   // A closed output is dropped, see Router::flushOutputs()
+
+  setup();
+
+  uint64_t passes = 0;
+  uint64_t inputEndUs = 0;
+  while (!stopRequested) {
+    bool inputs = Router::poll(IDLE_WAIT_MS) || !anyInput;
+    if (!inputs) {
+      if (!inputEndUs) inputEndUs = Router::micros();
+      if (Router::micros() - inputEndUs >= lingerMs * 1000) break;
+    }
+    Router::dispatchInterrupts();
+    loop();
+    passes++;
+
+    // Batch output while input is backed up, write it out as soon as the router catches up
+    if (!Router::hasInput()) Router::flushOutputs();
+  }
+  Router::flushOutputs();
+
+  double seconds = Router::micros() / 1e6;
+  uint64_t events = Router::count(ROUTER_DIN_IN) + Router::count(ROUTER_USB_IN) / 4 +
+                    Router::count(ROUTER_SYNC_IN);
+  fprintf(stderr, "in: %llu DIN bytes, %llu USB packets, %llu SYNC_IN edges\n",
+          (unsigned long long)Router::count(ROUTER_DIN_IN),
+          (unsigned long long)Router::count(ROUTER_USB_IN) / 4,
+          (unsigned long long)Router::count(ROUTER_SYNC_IN));
+  fprintf(stderr, "out: %llu DIN bytes, %llu USB packets, %llu pin edges\n",
+          (unsigned long long)Router::count(ROUTER_DIN_OUT),
+          (unsigned long long)Router::count(ROUTER_USB_OUT) / 4,
+          (unsigned long long)Router::count(ROUTER_PINS_OUT));
+  fprintf(stderr, "%.3f s, %llu loop passes (%.0f/s), %.0f input events/s\n", seconds,
+          (unsigned long long)passes, passes / seconds, events / seconds);
+  return 0;
+}
@@ -0,0 +1,276 @@
+/**
+ * MIDI BytePulse - Traffic Stress Run
+ *
+ * One load point on the simulated MCU: the real setup()/loop() routing a
+ * message mix at a fixed rate while a USB host clocks at 300 BPM.
+ *   stress --mix <notes|cc|sysex> --dir <usb2din|din2usb|both> --rate <msgs/s> [--seconds N]
+ *
+ * Prints one line of key=value results (tools/stress.py sweeps and tabulates):
+ *   offered / delivered       traffic messages put in / seen at the far side
+ *   din_rx_overflow, usb_drop_full, coalesced, parked   firmware counters
+ *   *_hw                      high-water marks sampled after every loop() pass
+ *   clock_*                   USB clock in to DIN clock out: count, latency and its
+ *                             std. dev. (the jitter the router adds; the input sits on
+ *                             1 ms frame boundaries, so interval jitter would mostly be
+ *                             the host's)
+ */
+
+#include <Arduino.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+#include "HostSim.h"
+#include "config.h"
+#include "DinSerial.h"
+#include "UsbMidi.h"
+#include "MIDIHandler.h"
+#include "Diagnostics.h"
+#include "RouteTable.h"
+
+#define LOOP_US          20
+#define WARMUP_US        200000UL
+#define CLOCK_BPM        300
+#define CLOCK_TICK_US    (60000000UL / CLOCK_BPM / 24)   // 8333 us
+#define SYSEX_LENGTH     64
+
+void setup();
+void loop();
+
+enum Mix { MIX_NOTES, MIX_CC, MIX_SYSEX };
+
+// Traffic from USB is sent on channel 1 (SysEx tag 1), from DIN on channel 2 (tag 2),
+// so with --dir both the DIN THRU copies are not counted as USB deliveries
+#define USB_CHANNEL  0
+#define DIN_CHANNEL  1
+
+struct Counters {
+  unsigned long delivered = 0;
+  unsigned clocksOut = 0;
+  std::deque<uint64_t> clockInputs;   // USB clock arrival times not yet seen on DIN OUT
+  double latencySum = 0;
+  double latencySquares = 0;
+  unsigned long maxLatencyUs = 0;
+  uint8_t dinStatus = 0;              // DIN OUT parser, keeps running status
+  uint8_t dinNeeded = 0;
+  uint8_t dinCount = 0;
+  bool dinSysexOurs = false;
+  bool usbSysexOurs = false;
+  bool countUsbToDin = false;
+  bool countDinToUsb = false;
+};
+
+static Counters counters;
+
+static uint8_t dataBytes(uint8_t status) {
+  uint8_t type = status & 0xF0;
+  return (type == 0xC0 || type == 0xD0) ? 1 : 2;
+}
+
+static void dinOut(uint64_t us, uint8_t value) {
+  if (value == 0xF8) {
+    counters.clocksOut++;
+    if (!counters.clockInputs.empty()) {
+      unsigned long latency = us - counters.clockInputs.front();
+      counters.clockInputs.pop_front();
+      counters.latencySum += latency;
+      counters.latencySquares += (double)latency * latency;
+      if (latency > counters.maxLatencyUs) counters.maxLatencyUs = latency;
+    }
+    return;
+  }
+  if (value >= 0xF8 || !counters.countUsbToDin) return;
+
+  if (value == 0xF0) {
+    counters.dinStatus = value;
+    counters.dinCount = 0;
+  } else if (value == 0xF7) {
+    if (counters.dinStatus == 0xF0 && counters.dinSysexOurs) counters.delivered++;
+    counters.dinStatus = 0;
+  } else if (value >= 0x80) {
+    counters.dinStatus = value < 0xF0 ? value : 0;
+    counters.dinNeeded = dataBytes(value);
+    counters.dinCount = 0;
+  } else if (counters.dinStatus == 0xF0) {
+    if (counters.dinCount++ == 1) counters.dinSysexOurs = value == USB_CHANNEL + 1;
+  } else if (counters.dinStatus && ++counters.dinCount == counters.dinNeeded) {
+    if ((counters.dinStatus & 0x0F) == USB_CHANNEL) counters.delivered++;
+    counters.dinCount = 0;
+  }
+}
+
+static void usbIn(uint64_t, const uint8_t* packet) {
+  if (!counters.countDinToUsb || USB_MIDI_CABLE(packet[0]) != USB_CABLE_DIN) return;
+
+  uint8_t cin = USB_MIDI_CIN(packet[0]);
+  if (cin == 0x04 && packet[1] == 0xF0) {
+    counters.usbSysexOurs = packet[3] == DIN_CHANNEL + 1;
+  } else if (cin >= 0x08 && cin <= 0x0E) {
+    if ((packet[1] & 0x0F) == DIN_CHANNEL) counters.delivered++;
+  } else if (cin == 0x05 || cin == 0x06 || cin == 0x07) {
+    if (counters.usbSysexOurs) counters.delivered++;
+    counters.usbSysexOurs = false;
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Traffic
+
+static uint8_t message(Mix mix, uint8_t channel, unsigned long i, uint8_t* bytes) {
+  switch (mix) {
+    case MIX_NOTES:
+      bytes[0] = ((i & 1) ? 0x80 : 0x90) | channel;
+      bytes[1] = 36 + (i / 2) % 48;
+      bytes[2] = (i & 1) ? 0 : 100;
+      return 3;
+    case MIX_CC:
+      bytes[0] = 0xB0 | channel;
+      bytes[1] = 1 + (i % 4);          // Four controllers swept at once
+      bytes[2] = i & 0x7F;
+      return 3;
+    case MIX_SYSEX:
+      bytes[0] = 0xF0;
+      bytes[1] = 0x7E;                 // Non-realtime universal: not for this unit
+      bytes[2] = channel + 1;
+      for (uint8_t n = 3; n < SYSEX_LENGTH - 1; n++) bytes[n] = (i + n) & 0x7F;
+      bytes[SYSEX_LENGTH - 1] = 0xF7;
+      return SYSEX_LENGTH;
+  }
+  return 0;
+}
+
+static void addUsbMessage(uint64_t cycle, const uint8_t* bytes, uint8_t length) {
+  uint8_t packet[4];
+  if (bytes[0] != 0xF0) {
+    packet[0] = USB_MIDI_HEADER(USB_CABLE_DIN, bytes[0] >> 4);
+    memcpy(packet + 1, bytes, 3);
+    HostSim::addUsbPacket(cycle, packet);
+    return;
+  }
+  for (uint8_t i = 0; i < length; i += 3) {
+    uint8_t left = length - i;
+    packet[0] = USB_MIDI_HEADER(USB_CABLE_DIN, left > 3 ? 0x04 : 0x04 + left);
+    for (uint8_t n = 0; n < 3; n++) packet[n + 1] = n < left ? bytes[i + n] : 0;
+    HostSim::addUsbPacket(cycle, packet);
+  }
+}
+
+int main(int argc, char** argv) {
+  Mix mix = MIX_NOTES;
+  bool toDin = true;
+  bool toUsb = false;
+  double rate = 100;
+  double seconds = 2;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const char* value = argv[i + 1];
+    if (!strcmp(argv[i], "--mix")) {
+      mix = !strcmp(value, "cc") ? MIX_CC : !strcmp(value, "sysex") ? MIX_SYSEX : MIX_NOTES;
+    } else if (!strcmp(argv[i], "--dir")) {
+      toDin = strcmp(value, "din2usb") != 0;
+      toUsb = strcmp(value, "usb2din") != 0;
+    } else if (!strcmp(argv[i], "--rate")) {
+      rate = atof(value);
+    } else if (!strcmp(argv[i], "--seconds")) {
+      seconds = atof(value);
+    }
+  }
+  if (rate <= 0 || seconds <= 0) {
+    fprintf(stderr, "usage: %s --mix <notes|cc|sysex> --dir <usb2din|din2usb|both> --rate <msgs/s> [--seconds N]\n", argv[0]);
+    return 2;
+  }
+
+  HostSim::reset();
+  HostSim::setInputPin(SYNC_RATE_PIN_5, LOW);        // 24 PPQN
+  HostSim::setInputPin(SYNC_IN_DETECT_PIN, LOW);     // Nothing on SYNC_IN
+  HostSim::onDinOut = dinOut;
+  HostSim::onUsbIn = usbIn;
+  counters.countUsbToDin = toDin;
+  counters.countDinToUsb = toUsb;
+
+  uint64_t start = WARMUP_US;
+  uint64_t end = start + (uint64_t)(seconds * 1e6);
+
+  // USB host clock on frame boundaries, Start first
+  const uint8_t startPacket[4] = { USB_MIDI_HEADER(USB_CABLE_CLOCK, 0x0F), 0xFA, 0, 0 };
+  const uint8_t clockPacket[4] = { USB_MIDI_HEADER(USB_CABLE_CLOCK, 0x0F), 0xF8, 0, 0 };
+  unsigned clocksIn = 0;
+  HostSim::addUsbPacket((start - 1000) * HOST_CYCLES_PER_US, startPacket);
+
+  // Traffic: USB messages are grouped per 1 ms frame, DIN bytes go through the wire model
+  unsigned long offered = 0;
+  uint8_t bytes[SYSEX_LENGTH];
+  uint64_t nextClock = start;
+  unsigned long frame = 0;
+  unsigned long usbSent = 0;
+
+  for (uint64_t t = start; t < end; t += 1000, frame++) {
+    // Clock ticks falling in this frame are sent at its start
+    while (nextClock < t + 1000) {
+      HostSim::addUsbPacket(t * HOST_CYCLES_PER_US, clockPacket);
+      counters.clockInputs.push_back(t);
+      clocksIn++;
+      nextClock += CLOCK_TICK_US;
+    }
+    if (toDin) {
+      unsigned long due = (unsigned long)((frame + 1) * rate / 1000.0 + 1e-9);
+      while (usbSent < due) {
+        uint8_t length = message(mix, USB_CHANNEL, usbSent, bytes);
+        addUsbMessage(t * HOST_CYCLES_PER_US, bytes, length);
+        usbSent++;
+      }
+    }
+  }
+  offered += usbSent;
+
+  if (toUsb) {
+    unsigned long count = (unsigned long)(rate * seconds);
+    for (unsigned long i = 0; i < count; i++) {
+      uint64_t t = start + (uint64_t)(i * 1e6 / rate);
+      uint8_t length = message(mix, DIN_CHANNEL, i, bytes);
+      for (uint8_t n = 0; n < length; n++) {
+        HostSim::addDinByte(t * HOST_CYCLES_PER_US, bytes[n]);
+      }
+    }
+    offered += count;
+  }
+
+  HostSim::setInterruptsEnabled(true);
+  setup();
+
+  // SysEx is not routed USB -> DIN by default
+  uint16_t system = routeTable.getMask(ROUTE_SRC_USB, ROUTE_DST_DIN, ROUTE_ROW_SYSTEM);
+  routeTable.setMask(ROUTE_SRC_USB, ROUTE_DST_DIN, ROUTE_ROW_SYSTEM, system | ROUTE_SYS_SYSEX);
+
+  uint8_t dinTxHighWater = 0;
+  uint8_t dinRxHighWater = 0;
+  uint8_t usbTxHighWater = 0;
+  uint64_t stopCycle = (end + 200000) * HOST_CYCLES_PER_US;   // Let queues drain
+
+  while (HostSim::cycles() < stopCycle) {
+    loop();
+    HostSim::advance(LOOP_US * HOST_CYCLES_PER_US);
+
+    uint8_t dinTx = (DIN_TX_BUFFER_SIZE - 1) - dinSerial.availableForWrite();
+    uint8_t dinRx = dinSerial.available();
+    uint8_t usbTx = usbMidi.getQueued();
+    if (dinTx > dinTxHighWater) dinTxHighWater = dinTx;
+    if (dinRx > dinRxHighWater) dinRxHighWater = dinRx;
+    if (usbTx > usbTxHighWater) usbTxHighWater = usbTx;
+  }
+
+  unsigned matched = clocksIn - counters.clockInputs.size();
+  double latencyMean = matched ? counters.latencySum / matched : 0;
+  double latencyVariance = matched ? counters.latencySquares / matched - latencyMean * latencyMean : 0;
+
+  printf("offered=%lu delivered=%lu din_rx_overflow=%u usb_drop_full=%u coalesced=%u parked=%u "
+         "din_tx_hw=%u din_rx_hw=%u usb_tx_hw=%u usb_out_backlog_hw=%u max_loop_us=%lu "
+         "clock_in=%u clock_out=%u clock_latency_mean_us=%.0f clock_latency_max_us=%lu clock_jitter_us=%.1f\n",
+         offered, counters.delivered, dinSerial.getRxOverflows(), usbMidi.getDroppedFull(),
+         MIDIHandler::getCoalescedCount(), MIDIHandler::getParkedCount(),
+         dinTxHighWater, dinRxHighWater, usbTxHighWater, HostSim::maxUsbOutBacklog(),
+         (unsigned long)Diagnostics::getMaxLoopUs(), clocksIn, counters.clocksOut,
+         latencyMean, counters.maxLatencyUs, latencyVariance > 0 ? sqrt(latencyVariance) : 0.0);
+  return 0;
+}
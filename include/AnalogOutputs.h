@@ -0,0 +1,87 @@
+/**
+ * MIDI BytePulse - Analog Output Bank
+ *
+ * The clock outputs that share one port (DISPLAY_CLK and pins 2 / 3 on PORTD)
+ * run from a single phase engine: each output has a mode, a ratio to the
+ * 24 PPQN clock, a pulse width and a polarity, and all edges of a clock tick
+ * go out in one port write, so outputs at different rates stay in phase with
+ * no divider chain between them.
+ *
+ * Pure functions over the output table (bit i of a mask = output i); Sync owns
+ * the phases, the pulse timing and the port.
+ */
+
+#ifndef ANALOG_OUTPUTS_H
+#define ANALOG_OUTPUTS_H
+
+#include <stdint.h>
+
+#define ANALOG_MODE_CLOCK   0   // Pulse every `divisor` clocks: 24 = 1 PPQN, 6 = 4 PPQN, 1 = 24 PPQN
+#define ANALOG_MODE_RESET   1   // Pulse on Start (and when SYNC_IN starts a run), not on Continue
+#define ANALOG_MODE_RUN     2   // Gate, active while a clock source is running
+
+#define ANALOG_MAX_DIVISOR  96  // One pulse per bar; divisors must divide 96 to stay on the song grid
+
+struct AnalogOutputConfig {
+  uint8_t bit;          // Port bit
+  uint8_t mode;         // ANALOG_MODE_*
+  uint8_t divisor;      // Clocks per pulse (CLOCK mode)
+  uint16_t widthUs;     // Pulse width (RUN mode: unused, the gate follows the transport)
+  bool inverted;        // Active low
+};
+
+// Outputs of one mode
+inline uint8_t analogModeMask(const AnalogOutputConfig* outputs, uint8_t count, uint8_t mode) {
+  uint8_t mask = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    if (outputs[i].mode == mode) mask |= 1 << i;
+  }
+  return mask;
+}
+
+// Phases for a position given in 24 PPQN clocks since the song start (SPP x 6)
+inline void analogRebase(const AnalogOutputConfig* outputs, uint8_t count, uint8_t* phase, uint32_t clocks) {
+  for (uint8_t i = 0; i < count; i++) {
+    phase[i] = outputs[i].mode == ANALOG_MODE_CLOCK ? clocks % outputs[i].divisor : 0;
+  }
+}
+
+// Outputs due to pulse on the next clock
+inline uint8_t analogDue(const AnalogOutputConfig* outputs, uint8_t count, const uint8_t* phase) {
+  uint8_t due = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    if (outputs[i].mode == ANALOG_MODE_CLOCK && phase[i] == 0) due |= 1 << i;
+  }
+  return due;
+}
+
+// One clock: returns the outputs that pulse on it and moves every phase on
+inline uint8_t analogTick(const AnalogOutputConfig* outputs, uint8_t count, uint8_t* phase) {
+  uint8_t rising = analogDue(outputs, count, phase);
+  for (uint8_t i = 0; i < count; i++) {
+    if (outputs[i].mode != ANALOG_MODE_CLOCK) continue;
+    if (++phase[i] >= outputs[i].divisor) phase[i] = 0;
+  }
+  return rising;
+}
+
+// Port bits of a set of outputs (default: the whole bank)
+inline uint8_t analogPortMask(const AnalogOutputConfig* outputs, uint8_t count, uint8_t select = 0xFF) {
+  uint8_t mask = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    if ((select >> i) & 1) mask |= 1 << outputs[i].bit;
+  }
+  return mask;
+}
+
+// Port levels for a set of active outputs, polarity applied (bank bits only)
+inline uint8_t analogPortLevels(const AnalogOutputConfig* outputs, uint8_t count, uint8_t active) {
+  uint8_t levels = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    bool on = (active >> i) & 1;
+    if (on != outputs[i].inverted) levels |= 1 << outputs[i].bit;
+  }
+  return levels;
+}
+
+#endif  // ANALOG_OUTPUTS_H
@@ -0,0 +1,43 @@
+/**
+ * MIDI BytePulse - Cycle Benchmark Markers
+ *
+ * In CYCLE_BENCH builds (pio run -e bench) each hot path writes its id to
+ * GPIOR1 on entry and GPIOR2 on exit, one OUT instruction each. The firmware
+ * then runs under simavr (bench/simavr_bench.c), which timestamps those writes
+ * and checks the cycles in between against bench/cycle_budget.txt.
+ * Compiled out of normal builds.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Ids must match bench/simavr_bench.c
+#define BENCH_HANDLE_CLOCK     1   // Sync::handleClock()
+#define BENCH_SYNC_IN_BURST    2   // SYNC_IN multiplier loop in Sync::handleSyncInEvent()
+#define BENCH_USB_TO_DIN       3   // MIDIHandler::forwardUSBtoDIN()
+#define BENCH_DIN_TO_USB       4   // MIDIHandler::forwardDINtoUSB()
+#define BENCH_DIN_RX_ISR       5   // USART1 receive vector body
+#define BENCH_DIN_UDRE_ISR     6   // USART1 data register empty vector body
+#define BENCH_SYNC_IN_ISR      7   // INT6 handler (SYNC_IN edge)
+
+#if CYCLE_BENCH
+struct BenchScope {
+  explicit BenchScope(uint8_t id) : id(id) { GPIOR1 = id; }
+  ~BenchScope() { GPIOR2 = id; }
+  const uint8_t id;
+};
+
+#define BENCH_SCOPE(id)  BenchScope benchScope(id)
+
+// simavr has no USB host, so bench builds take USB input from a fixed script
+// (bench/firmware/BenchUsbScript.cpp) instead of the OUT endpoint
+#include "UsbMidi.h"
+uint8_t benchReadPackets(midiEventPacket_t* packets, uint8_t maxPackets);
+#else
+#define BENCH_SCOPE(id)
+#endif
+
+#endif  // BENCH_H
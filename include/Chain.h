@@ -0,0 +1,55 @@
+/**
+ * MIDI BytePulse - Chain Calibration
+ * SysEx ping around a ring of daisy-chained units (last DIN OUT looped back to
+ * the first DIN IN), then each unit delays its analog outputs by its position
+ * so the whole chain fires together (math in ChainLatency.h)
+ */
+
+#ifndef CHAIN_H
+#define CHAIN_H
+
+#include <Arduino.h>
+#include "ChainLatency.h"
+
+class Sync;
+
+#define CHAIN_STATE_IDLE       0   // Never calibrated, outputs not delayed
+#define CHAIN_STATE_MEASURING  1   // Head: ping sent, waiting for it to come around
+#define CHAIN_STATE_DONE       2   // Position known, output delay applied
+#define CHAIN_STATE_NO_RING    3   // Head: ping never came back
+
+#define CHAIN_PING_TIMEOUT_MS  1000
+
+class Chain {
+public:
+  static void begin(Sync* s);
+
+  // Make this unit the head and send a ping around the ring
+  static void calibrate();
+
+  // Ring traffic from DIN IN
+  static void handlePing(uint8_t seq, uint8_t hops);
+  static void handleResult(uint8_t hops, uint8_t units, uint16_t hopUs);
+
+  static uint8_t getState();
+  static uint8_t getPosition() { return position; }
+  static uint8_t getUnits() { return units; }
+  static uint16_t getHopUs() { return hopUs; }
+  static unsigned long getOutputDelayUs();
+  static unsigned long getRoundTripUs() { return roundTripUs; }
+
+private:
+  static void apply();
+
+  static Sync* sync;
+  static uint8_t state;
+  static uint8_t seq;
+  static uint8_t position;
+  static uint8_t units;
+  static uint16_t hopUs;
+  static unsigned long pingEndUs;       // When the ping's F7 leaves DIN OUT
+  static unsigned long pingMillis;
+  static unsigned long roundTripUs;
+};
+
+#endif  // CHAIN_H
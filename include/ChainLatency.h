@@ -0,0 +1,43 @@
+/**
+ * MIDI BytePulse - Chained-Unit Latency Math
+ *
+ * Units daisy-chained over DIN (OUT -> IN) see each clock one hop later than
+ * the unit before them. For calibration the last unit's DIN OUT is looped back
+ * to the first unit's IN; a ping sent around the ring gives the round trip,
+ * and from it the latency a single MIDI clock picks up per hop. Each unit then
+ * holds its SYNC_OUT / DISPLAY_CLK edges back by the hops still ahead of it, so
+ * every unit in the chain fires at the time the last one does.
+ *
+ * The ping is store-and-forward (a whole SysEx is received before it is sent
+ * on), a clock byte is not: the extra serialization time is taken out.
+ */
+
+#ifndef CHAIN_LATENCY_H
+#define CHAIN_LATENCY_H
+
+#include <stdint.h>
+
+#define CHAIN_MAX_UNITS     16
+#define CHAIN_PING_BYTES    8     // F0 7D 42 50 19 seq hops F7
+#define CHAIN_DIN_BYTE_US   320   // 10 bits at 31.25 kbaud
+
+// Clock latency of one hop from the ring round trip (F7 sent to F7 back).
+// forwards = units that passed the ping on (ring size - 1); 0 when unknown.
+inline uint16_t chainHopLatencyUs(unsigned long roundTripUs, uint8_t forwards) {
+  if (forwards == 0) return 0;
+
+  unsigned long perForward = roundTripUs / forwards;
+  unsigned long storeAndForward = (CHAIN_PING_BYTES - 1) * (unsigned long)CHAIN_DIN_BYTE_US;
+  if (perForward <= storeAndForward) return 0;
+
+  unsigned long hop = perForward - storeAndForward;
+  return hop > 0xFFFF ? 0xFFFF : (uint16_t)hop;
+}
+
+// Delay for a unit's analog outputs: the hops between it and the last unit
+inline unsigned long chainOutputDelayUs(uint8_t units, uint8_t position, uint16_t hopUs) {
+  if (units == 0 || position >= units) return 0;
+  return (unsigned long)(units - 1 - position) * hopUs;
+}
+
+#endif  // CHAIN_LATENCY_H
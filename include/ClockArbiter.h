@@ -0,0 +1,136 @@
+/**
+ * MIDI BytePulse - Clock Source Arbitration
+ *
+ * Which source drives the outputs, as one transition table:
+ *   (active source, event) -> (next active source, actions)
+ * Priority is SYNC_IN > USB > DIN. A higher source takes over on its first
+ * clock; a lower one is ignored entirely (clocks, Start and Stop) until the
+ * active source stops or goes quiet. Only the active source can stop the clock.
+ * Every event is one table read, whatever the state.
+ */
+
+#ifndef CLOCK_ARBITER_H
+#define CLOCK_ARBITER_H
+
+#include <stdint.h>
+
+#if defined(ARDUINO)
+#include <avr/pgmspace.h>
+#elif !defined(PROGMEM)
+#define PROGMEM
+#endif
+#ifndef pgm_read_byte
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#endif
+
+// Clock-lost timeout: the active source is dropped after missing this many of
+// its own ticks, clamped to [MIN, MAX] ms (MAX until its interval is known)
+#ifndef CLOCK_LOST_TICKS
+#define CLOCK_LOST_TICKS    4      // Missed ticks of the active source before it is lost
+#endif
+#ifndef CLOCK_LOST_MIN_MS
+#define CLOCK_LOST_MIN_MS   150    // Floor: DAW and USB scheduling hiccups
+#endif
+#ifndef CLOCK_LOST_MAX_MS
+#define CLOCK_LOST_MAX_MS   3000   // Ceiling, and the timeout while the tick interval is unknown
+#endif
+
+enum ClockSource {
+  CLOCK_SOURCE_NONE,
+  CLOCK_SOURCE_SYNC_IN,
+  CLOCK_SOURCE_DIN,
+  CLOCK_SOURCE_USB
+};
+
+#define CLOCK_SOURCE_COUNT  4
+
+enum ClockEvent {
+  CLOCK_EVENT_CLOCK,     // F8, or a SYNC_IN pulse
+  CLOCK_EVENT_START,     // FA / FB
+  CLOCK_EVENT_STOP,      // FC
+  CLOCK_EVENT_LOST,      // Timeout, or the SYNC_IN jack pulled
+  CLOCK_EVENT_COUNT
+};
+
+// Actions, bits 2-7 of a table entry (bits 0-1: next ClockSource)
+#define CLOCK_ACT_ACCEPT   0x04  // The clock drives the outputs
+#define CLOCK_ACT_RESET    0x08  // PPQN counter back onto the song position, period tracking restarted
+#define CLOCK_ACT_STARTED  0x10  // onClockStart
+#define CLOCK_ACT_STOPPED  0x20  // onClockStop, outputs dropped low
+#define CLOCK_ACT_FORWARD  0x40  // Pass the Start / Stop on to DIN OUT (USB is master)
+
+#define CLOCK_NEXT_MASK    0x03
+
+// Shorthands for the table only
+#define ARB_N   CLOCK_SOURCE_NONE
+#define ARB_S   CLOCK_SOURCE_SYNC_IN
+#define ARB_D   CLOCK_SOURCE_DIN
+#define ARB_U   CLOCK_SOURCE_USB
+#define ARB_TAKE     (CLOCK_ACT_ACCEPT | CLOCK_ACT_RESET)
+#define ARB_START    (CLOCK_ACT_RESET | CLOCK_ACT_STARTED)
+#define ARB_STOP     (CLOCK_ACT_RESET | CLOCK_ACT_STOPPED)
+
+// [active source][event source * CLOCK_EVENT_COUNT + event], event sources SYNC_IN, DIN, USB
+static const uint8_t clockArbiterTable[CLOCK_SOURCE_COUNT][(CLOCK_SOURCE_COUNT - 1) * CLOCK_EVENT_COUNT] PROGMEM = {
+  // Idle: any clock takes over; SYNC_IN has no transport, its first pulse counts as Start
+  {
+    ARB_S | ARB_TAKE | CLOCK_ACT_STARTED, ARB_N, ARB_N, ARB_N,
+    ARB_D | ARB_TAKE, ARB_D | ARB_START, ARB_N, ARB_N,
+    ARB_U | ARB_TAKE, ARB_U | ARB_START | CLOCK_ACT_FORWARD, ARB_N | CLOCK_ACT_FORWARD, ARB_N
+  },
+  // SYNC_IN: nothing else gets through
+  {
+    ARB_S | CLOCK_ACT_ACCEPT, ARB_S, ARB_S, ARB_N | ARB_STOP,
+    ARB_S, ARB_S, ARB_S, ARB_S,
+    ARB_S, ARB_S, ARB_S, ARB_S
+  },
+  // DIN: SYNC_IN and USB take over, USB Stop is not ours to act on
+  {
+    ARB_S | ARB_TAKE | CLOCK_ACT_STARTED, ARB_D, ARB_D, ARB_D,
+    ARB_D | CLOCK_ACT_ACCEPT, ARB_D | ARB_START, ARB_N | ARB_STOP, ARB_N | ARB_STOP,
+    ARB_U | ARB_TAKE, ARB_U | ARB_START | CLOCK_ACT_FORWARD, ARB_D, ARB_D
+  },
+  // USB: SYNC_IN takes over, DIN is ignored
+  {
+    ARB_S | ARB_TAKE | CLOCK_ACT_STARTED, ARB_U, ARB_U, ARB_U,
+    ARB_U, ARB_U, ARB_U, ARB_U,
+    ARB_U | CLOCK_ACT_ACCEPT, ARB_U | ARB_START | CLOCK_ACT_FORWARD,
+    ARB_N | ARB_STOP | CLOCK_ACT_FORWARD, ARB_N | ARB_STOP
+  }
+};
+
+#undef ARB_N
+#undef ARB_S
+#undef ARB_D
+#undef ARB_U
+#undef ARB_TAKE
+#undef ARB_START
+#undef ARB_STOP
+
+// Table entry for an event from source (not NONE) while active is driving the outputs
+inline uint8_t clockArbiterStep(uint8_t active, uint8_t source, uint8_t event) {
+  return pgm_read_byte(&clockArbiterTable[active][(source - 1) * CLOCK_EVENT_COUNT + event]);
+}
+
+inline ClockSource clockArbiterNext(uint8_t step) {
+  return (ClockSource)(step & CLOCK_NEXT_MASK);
+}
+
+// Would a clock from source be used right now (also gates DIN THRU of clock and transport)
+inline bool clockArbiterAccepts(uint8_t active, uint8_t source) {
+  return clockArbiterStep(active, source, CLOCK_EVENT_CLOCK) & CLOCK_ACT_ACCEPT;
+}
+
+// How long the active source may stay quiet before CLOCK_EVENT_LOST: a few of
+// its own ticks (MIDI clock or SYNC_IN pulse), so a normal-tempo source fails
+// over in tens of milliseconds and a slow pulse source is still given time.
+// Before two ticks have been measured (0) the ceiling applies.
+inline uint16_t clockLostTimeoutMs(uint32_t tickUs) {
+  if (tickUs == 0) return CLOCK_LOST_MAX_MS;
+  uint32_t timeoutMs = tickUs * CLOCK_LOST_TICKS / 1000;
+  if (timeoutMs < CLOCK_LOST_MIN_MS) return CLOCK_LOST_MIN_MS;
+  if (timeoutMs > CLOCK_LOST_MAX_MS) return CLOCK_LOST_MAX_MS;
+  return timeoutMs;
+}
+
+#endif  // CLOCK_ARBITER_H
@@ -0,0 +1,134 @@
+/**
+ * MIDI BytePulse - Latest-Value-Wins Message Slots
+ *
+ * Holds continuous-controller messages (CC, pitch bend, aftertouch) while
+ * DIN OUT is congested. A newer value for the same channel/controller
+ * replaces the pending one in place instead of queueing behind it.
+ * Notes, switch/bank/RPN controllers and realtime never enter the slots;
+ * before one of those goes out, the caller flushes its channel's slots
+ * (popChannel) so it can't overtake a bend or controller sent before it.
+ * SysEx to DIN OUT doesn't pass through here either, and isn't held back
+ * for the slots: it can go out ahead of controllers parked before it.
+ */
+
+#ifndef COALESCE_QUEUE_H
+#define COALESCE_QUEUE_H
+
+#include <stdint.h>
+
+#ifndef COALESCE_SLOTS
+#define COALESCE_SLOTS  16
+#endif
+
+class CoalesceQueue {
+public:
+  static bool isCoalescable(uint8_t status, uint8_t data1) {
+    switch (status & 0xF0) {
+      case 0xA0:  // Poly aftertouch
+      case 0xD0:  // Channel aftertouch
+      case 0xE0:  // Pitch bend
+        return true;
+      case 0xB0:
+        // Order-sensitive controllers keep every value:
+        // bank select, data entry, pedals/switches, (N)RPN, channel mode
+        if (data1 == 0 || data1 == 32 || data1 == 6 || data1 == 38) return false;
+        if (data1 >= 64 && data1 <= 69) return false;
+        if (data1 >= 96) return false;
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  // Returns true if the message was absorbed (replaced or parked);
+  // false means the caller must send it now
+  bool offer(uint8_t status, uint8_t data1, uint8_t data2, bool congested) {
+    if (!isCoalescable(status, data1)) return false;
+
+    // Nothing held and the link has room: not parked
+    if (count == 0 && !congested) return false;
+
+    int8_t slot = count ? find(status, data1) : -1;
+    if (slot >= 0) {
+      // A stale value is still waiting: overwrite it so only the latest goes
+      // out. Also when the link has room again: sending this one now would
+      // overtake the messages parked before its slot
+      data2s[slot] = data2;
+      data1s[slot] = data1;
+      coalescedCount++;
+      return true;
+    }
+
+    if (!congested || count >= COALESCE_SLOTS) return false;
+
+    statuses[count] = status;
+    data1s[count] = data1;
+    data2s[count] = data2;
+    count++;
+    parkedCount++;
+    return true;
+  }
+
+  // Oldest parked message first
+  bool pop(uint8_t& status, uint8_t& data1, uint8_t& data2) {
+    if (count == 0) return false;
+    take(0, status, data1, data2);
+    return true;
+  }
+
+  // Oldest parked message on channel (0-15)
+  bool popChannel(uint8_t channel, uint8_t& status, uint8_t& data1, uint8_t& data2) {
+    for (uint8_t i = 0; i < count; i++) {
+      if ((statuses[i] & 0x0F) == channel) {
+        take(i, status, data1, data2);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool isEmpty() const { return count == 0; }
+  uint8_t size() const { return count; }
+  uint16_t getCoalescedCount() const { return coalescedCount; }
+  uint16_t getParkedCount() const { return parkedCount; }
+
+  void clear() {
+    count = 0;
+    coalescedCount = 0;
+    parkedCount = 0;
+  }
+
+private:
+  void take(uint8_t slot, uint8_t& status, uint8_t& data1, uint8_t& data2) {
+    status = statuses[slot];
+    data1 = data1s[slot];
+    data2 = data2s[slot];
+
+    count--;
+    for (uint8_t i = slot; i < count; i++) {
+      statuses[i] = statuses[i + 1];
+      data1s[i] = data1s[i + 1];
+      data2s[i] = data2s[i + 1];
+    }
+  }
+
+  int8_t find(uint8_t status, uint8_t data1) const {
+    // Pitch bend and channel aftertouch are keyed by channel only
+    bool keyedByData1 = (status & 0xF0) == 0xA0 || (status & 0xF0) == 0xB0;
+    for (uint8_t i = 0; i < count; i++) {
+      if (statuses[i] == status && (!keyedByData1 || data1s[i] == data1)) {
+        return i;
+      }
+    }
+    return -1;
+  }
+
+  uint8_t statuses[COALESCE_SLOTS];
+  uint8_t data1s[COALESCE_SLOTS];
+  uint8_t data2s[COALESCE_SLOTS];
+  uint8_t count = 0;
+  uint16_t coalescedCount = 0;
+  uint16_t parkedCount = 0;
+};
+
+#endif  // COALESCE_QUEUE_H
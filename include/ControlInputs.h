@@ -0,0 +1,73 @@
+/**
+ * MIDI BytePulse - Control Inputs
+ *
+ * Front panel decoding, shared by the interrupt handlers in Controls.cpp:
+ * the 1P5T rate switch and the pots on A0-A3 (8-bit readings). Pure functions,
+ * no hardware access.
+ */
+
+#ifndef CONTROL_INPUTS_H
+#define CONTROL_INPUTS_H
+
+#include <stdint.h>
+
+// Rate switch: bit i of a contact mask = position i + 1 closed
+#define CONTROL_SWITCH_POSITIONS  5
+#define CONTROL_DEBOUNCE_TICKS    3     // Timer0 compare ticks (1.024 ms) without an edge before a read
+
+// Pots, in ADC scan order
+#define CONTROL_POT_TEMPO         0     // A0
+#define CONTROL_POT_SWING         1     // A1
+#define CONTROL_POT_WIDTH         2     // A2: SYNC_OUT pulse width
+#define CONTROL_POT_AUX           3     // A3: scanned, not assigned
+#define CONTROL_POT_COUNT         4     // Power of two (scan index wraps with a mask)
+#define CONTROL_POT_HYSTERESIS    2     // Counts a reading must move before it replaces the held one
+
+#define CONTROL_TEMPO_MIN_BPM     40
+#define CONTROL_TEMPO_MAX_BPM     240
+#define CONTROL_WIDTH_MIN_US      1000
+#define CONTROL_WIDTH_MAX_US      20000
+#define CONTROL_SWING_GAP_US      1000  // Least low time left before the next on-beat pulse
+
+// Rate (PPQN) from the closed contacts; nothing closed (between positions) keeps the current one
+inline uint8_t controlSwitchRate(uint8_t closed, uint8_t current) {
+  closed &= (1 << CONTROL_SWITCH_POSITIONS) - 1;
+  if (closed == 0) return current;
+
+  // Positions 1 and 2 both closed (hardware issue) read as position 1
+  if (closed == 0x03) return 1;
+
+  // Otherwise the highest position wins
+  if (closed & 0x10) return 24;
+  if (closed & 0x08) return 6;
+  if (closed & 0x04) return 4;
+  if (closed & 0x02) return 2;
+  return 1;
+}
+
+// Whether a new reading replaces the held one; the ends of the travel always get through
+inline bool controlPotMoved(uint8_t held, uint8_t reading) {
+  if (reading == held) return false;
+  if (reading == 0 || reading == 0xFF) return true;
+  uint8_t distance = reading > held ? reading - held : held - reading;
+  return distance > CONTROL_POT_HYSTERESIS;
+}
+
+inline uint16_t controlTempoBpm(uint8_t pot) {
+  return CONTROL_TEMPO_MIN_BPM + (uint16_t)((uint32_t)pot * (CONTROL_TEMPO_MAX_BPM - CONTROL_TEMPO_MIN_BPM) / 0xFF);
+}
+
+inline uint16_t controlPulseWidthUs(uint8_t pot) {
+  return CONTROL_WIDTH_MIN_US + (uint16_t)((uint32_t)pot * (CONTROL_WIDTH_MAX_US - CONTROL_WIDTH_MIN_US) / 0xFF);
+}
+
+// Delay of an off-beat pulse: swing 0 = straight, 255 = half a pulse interval late
+// (75 / 25 over the pair), held back so the pulse still ends before the next on-beat
+inline uint32_t controlSwingUs(uint32_t intervalUs, uint8_t swing, uint32_t widthUs) {
+  uint32_t delayUs = (intervalUs * swing) >> 9;
+  if (intervalUs <= widthUs + CONTROL_SWING_GAP_US) return 0;
+  uint32_t limitUs = intervalUs - widthUs - CONTROL_SWING_GAP_US;
+  return delayUs < limitUs ? delayUs : limitUs;
+}
+
+#endif  // CONTROL_INPUTS_H
@@ -0,0 +1,56 @@
+/**
+ * MIDI BytePulse - Front Panel Controls
+ *
+ * Read by interrupts rather than polled from loop():
+ *   - Rate switch: any contact edge (PCINT0) restarts a short count on Timer0
+ *     compare B; once the contacts have been still for CONTROL_DEBOUNCE_TICKS
+ *     the position is read and latched (a change is applied ~3 ms after the
+ *     last bounce)
+ *   - Pots (CONTROL_POTS): the ADC converts one of A0-A3 on every Timer0
+ *     overflow and its handler keeps an 8-bit snapshot per pot, with
+ *     hysteresis. Single bytes, so the loop reads them without locking
+ * The handlers flag what changed; update() costs one flag test when nothing
+ * moved and hands changes to Sync (decoding in ControlInputs.h).
+ */
+
+#ifndef CONTROLS_H
+#define CONTROLS_H
+
+#include <Arduino.h>
+#include "ControlInputs.h"
+
+class Sync;
+
+#define CONTROL_CHANGED_SWITCH  0x01
+#define CONTROL_CHANGED_POTS    0x02
+
+class Controls {
+public:
+  // Reads the switch once, applies it, then arms the pin-change and ADC interrupts
+  static void begin(Sync* s);
+
+  // Once per loop() pass: applies what the handlers latched
+  static void update();
+
+  static uint8_t getSwitchRate() { return switchRate; }
+  static uint8_t getPot(uint8_t pot) { return pots[pot]; }
+  static uint16_t getTempoBpm() { return controlTempoBpm(pots[CONTROL_POT_TEMPO]); }
+
+  // Called from the PCINT0, TIMER0_COMPB and ADC vectors only
+  static void switchEdge();
+  static void debounceTick();
+  static void potConverted();
+
+private:
+  static uint8_t readSwitch();
+  static void selectPot(uint8_t pot);
+
+  static Sync* sync;
+  static volatile uint8_t changed;        // CONTROL_CHANGED_*
+  static volatile uint8_t switchRate;     // PPQN
+  static volatile uint8_t debounceTicks;
+  static volatile uint8_t pots[CONTROL_POT_COUNT];
+  static uint8_t potChannel;              // Pot being converted (handler only)
+};
+
+#endif  // CONTROLS_H
@@ -0,0 +1,79 @@
+/**
+ * MIDI BytePulse - Runtime Diagnostics
+ * RAM usage probes and a loop-stall watchdog that stay compiled in
+ * (readable over SysEx, no SERIAL_DEBUG needed)
+ */
+
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <Arduino.h>
+#include "config.h"
+
+class Sync;
+
+#define STACK_CANARY  0xC5   // Painted over free RAM before main(), see Diagnostics.cpp
+
+// loop() stage markers, kept in GPIOR0 (single-cycle write)
+#define DIAG_STAGE_SETUP        1
+#define DIAG_STAGE_DIN_READ     2
+#define DIAG_STAGE_USB_RX       3
+#define DIAG_STAGE_SYNC_UPDATE  4
+#define DIAG_STAGE_USB_FLUSH    5
+#define DIAG_STAGE_TEST_MODES   6
+#define DIAG_STAGE_TRACE        7
+#define DIAG_STAGE_OSC_CAL      8
+#define DIAG_STAGE_BUS          9
+#define DIAG_STAGE_EEPROM       10
+
+// Post-mortem written by the watchdog interrupt just before the reset
+struct StallRecord {
+  uint16_t magic;
+  uint8_t stage;                  // DIAG_STAGE_* that never finished
+  uint8_t clockSource;            // ClockSource active at the time
+  uint32_t maxLoopUs;             // Longest completed loop() pass before the stall
+  unsigned long stallMillis;      // Uptime at the stall
+  unsigned long lastDINClock;     // millis() of the last clock from each source
+  unsigned long lastUSBClock;
+  unsigned long lastSyncIn;
+};
+
+class Diagnostics {
+public:
+  // Reads any record left by a watchdog reset, then arms the watchdog
+  static void begin(const Sync* sync);
+
+  static inline void setStage(uint8_t stage) { GPIOR0 = stage; }
+
+  // Once per loop() pass: feeds the watchdog and tracks the longest pass
+  static void loopTick();
+
+  // Record from the previous run (valid after begin())
+  static bool hasStallRecord() { return stallValid; }
+  static const StallRecord& getStallRecord() { return lastStall; }
+  static uint32_t getMaxLoopUs();
+
+  // Called from the WDT vector only
+  static void watchdogIrq();
+
+  // Gap between the heap (or .bss) and the current stack pointer
+  static uint16_t freeRam();
+
+  // Deepest stack use since reset, found by scanning for unpainted bytes
+  static uint16_t stackHighWater();
+
+  // .data + .bss, fixed at link time
+  static uint16_t staticRam();
+
+private:
+  static void armWatchdog();
+
+  static const Sync* watched;
+  static StallRecord lastStall;
+  static bool stallValid;
+  static uint16_t lastLoopStamp;
+  static unsigned long lastLoopMillis;
+  static uint32_t maxLoopUs;
+};
+
+#endif  // DIAGNOSTICS_H
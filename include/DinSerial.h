@@ -0,0 +1,53 @@
+/**
+ * MIDI BytePulse - DIN MIDI UART (USART1)
+ * Replaces Serial1 so every received byte carries its hardware arrival time
+ */
+
+#ifndef DIN_SERIAL_H
+#define DIN_SERIAL_H
+
+#include <Arduino.h>
+#include "config.h"
+
+class DinSerial {
+public:
+  void begin(unsigned long baud);
+  int available();
+  int read();
+  size_t write(uint8_t b);             // Realtime bytes (0xF8-0xFF) jump the queue
+  size_t writeInOrder(uint8_t b);      // Queued behind everything, realtime or not
+  uint8_t availableForWrite() const;
+
+  // Arrival time of the byte most recently returned by read()
+  uint16_t lastReadStamp() const { return lastStamp; }
+  unsigned long lastReadMicros() const;
+
+  uint16_t getRxOverflows() const { return rxOverflows; }
+
+  // Called from the USART1 interrupt vectors only
+  void rxCompleteIrq();
+  void txUdrEmptyIrq();
+
+private:
+  uint8_t rxBytes[DIN_RX_BUFFER_SIZE];
+  uint16_t rxStamps[DIN_RX_BUFFER_SIZE];
+  volatile uint8_t rxHead = 0;
+  volatile uint8_t rxTail = 0;
+  volatile uint16_t rxOverflows = 0;
+  uint16_t lastStamp = 0;
+
+  uint8_t txBuffer[DIN_TX_BUFFER_SIZE];
+  volatile uint8_t txHead = 0;
+  volatile uint8_t txTail = 0;
+
+  // Realtime lane, served before txBuffer (MIDI allows realtime between any two bytes)
+  uint8_t rtBuffer[DIN_RT_BUFFER_SIZE];
+  volatile uint8_t rtHead = 0;
+  volatile uint8_t rtTail = 0;
+
+  size_t enqueue(uint8_t* buffer, volatile uint8_t& head, volatile uint8_t& tail, uint8_t mask, uint8_t b);
+};
+
+extern DinSerial dinSerial;
+
+#endif  // DIN_SERIAL_H
@@ -0,0 +1,42 @@
+/**
+ * MIDI BytePulse - DISPLAY_CLK Tempo Burst
+ *
+ * Sends a DisplayCode.h frame on the DISPLAY_CLK bit after a beat pulse.
+ * Every edge is timed by Timer1 compare A (Timebase keeps Timer1 free-running,
+ * the compare channel is otherwise unused), so loop() load never stretches a
+ * mark. While a burst runs the pin belongs to it: Sync leaves portBits() out
+ * of its bank writes.
+ */
+
+#ifndef DISPLAY_BURST_H
+#define DISPLAY_BURST_H
+
+#include <Arduino.h>
+#include "DisplayCode.h"
+
+class DisplayBurst {
+public:
+  // Port bit and polarity of the DISPLAY_CLK bank output
+  static void begin(uint8_t bit, bool inverted);
+
+  // Starts a burst DISPLAY_CODE_LEAD_US from now; ignored while one is running
+  static void send(uint16_t frame);
+
+  // Port bits owned by a running burst, 0 when idle
+  static uint8_t portBits() { return sending ? portBit : 0; }
+
+  // Called from the TIMER1_COMPA vector only
+  static void compareMatch();
+
+private:
+  static void drive(bool active);
+
+  static uint8_t portBit;
+  static bool inverted;
+  static volatile bool sending;
+  static uint16_t frame;
+  static uint8_t bitsLeft;
+  static bool inMark;
+};
+
+#endif  // DISPLAY_BURST_H
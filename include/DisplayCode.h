@@ -0,0 +1,66 @@
+/**
+ * MIDI BytePulse - DISPLAY_CLK Tempo Code
+ *
+ * Optional (DISPLAY_CODE): after each DISPLAY_CLK beat pulse ends, a short
+ * burst carries the tempo and the beat in the bar, so the TinyPulse display
+ * shows the BPM on the first beat instead of timing one or two of them.
+ *
+ *   beat pulse (5 ms) | lead (1 ms low) | 16 bits, MSB first
+ *   bit = mark of 250 us (0) or 750 us (1), then 250 us low
+ *
+ * The beat pulse is still the first rising edge and far wider than any mark,
+ * so a decoder tells them apart by width; one without a decoder must not see
+ * the burst (the marks would count as beats).
+ *
+ * Frame: tempo in 0.1 BPM (12 bits, 0 = unknown) | beat in bar (2 bits, 4/4)
+ *        | check (2 bits: sum of the seven 2-bit groups above, mod 4)
+ */
+
+#ifndef DISPLAY_CODE_H
+#define DISPLAY_CODE_H
+
+#include <stdint.h>
+
+#define DISPLAY_CODE_BITS      16
+#define DISPLAY_CODE_LEAD_US   1000
+#define DISPLAY_CODE_ZERO_US   250
+#define DISPLAY_CODE_ONE_US    750
+#define DISPLAY_CODE_SPACE_US  250
+#define DISPLAY_CODE_MAX_TEMPO 4095   // 409.5 BPM
+// Longest burst, all ones: lead + 16 x (mark + space) = 17 ms
+#define DISPLAY_CODE_BURST_US  (DISPLAY_CODE_LEAD_US + DISPLAY_CODE_BITS * (DISPLAY_CODE_ONE_US + DISPLAY_CODE_SPACE_US))
+
+// Tempo in 0.1 BPM from the 24 PPQN clock interval (0 = unknown)
+inline uint16_t displayCodeTempo(uint32_t clockPeriodUs) {
+  if (clockPeriodUs == 0) return 0;
+  // 60 s x 10 / (24 clocks x period)
+  uint32_t tempo = (25000000UL + clockPeriodUs / 2) / clockPeriodUs;
+  return tempo > DISPLAY_CODE_MAX_TEMPO ? DISPLAY_CODE_MAX_TEMPO : tempo;
+}
+
+inline uint8_t displayCodeCheck(uint16_t data) {
+  uint8_t sum = 0;
+  for (uint8_t i = 0; i < 7; i++) sum += (data >> (2 * i)) & 0x03;
+  return sum & 0x03;
+}
+
+inline uint16_t displayCodeFrame(uint16_t tempo, uint8_t beat) {
+  uint16_t data = ((tempo & 0x0FFF) << 2) | (beat & 0x03);
+  return (data << 2) | displayCodeCheck(data);
+}
+
+// Decoder side: false if the check doesn't match
+inline bool displayCodeDecode(uint16_t frame, uint16_t& tempo, uint8_t& beat) {
+  uint16_t data = frame >> 2;
+  if (displayCodeCheck(data) != (frame & 0x03)) return false;
+  tempo = data >> 2;
+  beat = data & 0x03;
+  return true;
+}
+
+// Beat pulse, lead and the longest burst must all end before the next beat
+inline bool displayCodeFits(uint32_t beatIntervalUs, uint32_t pulseWidthUs) {
+  return beatIntervalUs > pulseWidthUs + DISPLAY_CODE_BURST_US + DISPLAY_CODE_LEAD_US;
+}
+
+#endif  // DISPLAY_CODE_H
@@ -0,0 +1,133 @@
+/**
+ * MIDI BytePulse - Event Bus
+ *
+ * Every input reaches the outputs through one statically allocated ring of
+ * fixed-size events:
+ *   header  port (high nibble, BUS_PORT_*) | code index (low nibble, as USB-MIDI)
+ *   byte1-3 the MIDI bytes as on the wire, unused ones 0
+ *   stamp   Timebase ticks when the producer saw it
+ * The first four bytes are a USB-MIDI packet with the cable replaced by the
+ * input port, so USB packets enter and leave the bus without re-encoding and
+ * DIN OUT writes the bytes as they are.
+ *
+ * Producers: DIN parser callbacks, USB receive, the SYNC_IN handler.
+ * One consumer (MIDIHandler::dispatch) routes to DIN TX, USB TX and Sync and
+ * measures each event's time on the bus, per input port.
+ *
+ * push() must not be interrupted by another push: interrupt handlers call it
+ * directly, loop() code goes through post(). pop() is loop-only and never
+ * blocks the handlers (head and tail each have one writer).
+ */
+
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+#include <stdint.h>
+
+#ifndef EVENT_BUS_SIZE
+#define EVENT_BUS_SIZE  32    // Events (power of two): a full USB bank plus DIN and SYNC_IN
+#endif
+
+#define BUS_PORT_DIN    0
+#define BUS_PORT_USB    1
+#define BUS_PORT_SYNC   2     // SYNC_IN edge: byte1 = F8, byte2 = 1 if the handler sent its first clock
+#define BUS_PORT_COUNT  3
+
+#define BUS_HEADER(port, cin)  ((uint8_t)(((port) << 4) | (cin)))
+#define BUS_PORT(header)       ((header) >> 4)
+#define BUS_CIN(header)        ((header) & 0x0F)
+
+struct BusEvent {
+  uint8_t header;
+  uint8_t byte1;
+  uint8_t byte2;
+  uint8_t byte3;
+  uint16_t stamp;
+};
+
+// Code index of a complete non-SysEx message (USB-MIDI 1.0 table 4-1)
+inline uint8_t busCodeIndex(uint8_t status) {
+  if (status < 0xF0) return status >> 4;
+  switch (status) {
+    case 0xF1:
+    case 0xF3: return 0x02;   // Two-byte system common
+    case 0xF2: return 0x03;   // Three-byte system common
+    case 0xF6: return 0x05;   // Single-byte system common
+    default: return 0x0F;     // Realtime
+  }
+}
+
+// MIDI bytes carried by an event with this code index
+inline uint8_t busEventLength(uint8_t cin) {
+  switch (cin) {
+    case 0x05:
+    case 0x0F: return 1;
+    case 0x02:
+    case 0x06:
+    case 0x0C:
+    case 0x0D: return 2;
+    default: return 3;
+  }
+}
+
+// SysEx start / continue / end packet (code index 5 is also a single-byte common message)
+inline bool busIsSysEx(uint8_t cin, uint8_t byte1) {
+  return cin == 0x04 || cin == 0x06 || cin == 0x07 || (cin == 0x05 && byte1 == 0xF7);
+}
+
+// A USB-MIDI packet that carries a message: code index 0 and 1 are reserved
+// (hosts pad short transfers with zeros) and outside SysEx byte1 is a status
+inline bool busIsMessage(uint8_t cin, uint8_t byte1) {
+  if (cin < 0x02) return false;
+  return busIsSysEx(cin, byte1) || byte1 >= 0x80;
+}
+
+class EventBus {
+public:
+  // Returns false (and counts it) when the ring is full; the event is lost
+  bool push(const BusEvent& event) {
+    uint8_t next = (head + 1) & (EVENT_BUS_SIZE - 1);
+    if (next == tail) {
+      if (overflows < 0xFFFF) overflows++;
+      return false;
+    }
+    events[head] = event;
+    head = next;
+
+    uint8_t depth = (head - tail) & (EVENT_BUS_SIZE - 1);
+    if (depth > highWater) highWater = depth;
+    return true;
+  }
+
+  bool post(const BusEvent& event);   // push() with interrupts held off (EventBus.cpp)
+
+  bool pop(BusEvent& event) {
+    if (tail == head) return false;
+    event = events[tail];
+    tail = (tail + 1) & (EVENT_BUS_SIZE - 1);
+    return true;
+  }
+
+  bool isEmpty() const { return tail == head; }
+  uint8_t count() const { return (head - tail) & (EVENT_BUS_SIZE - 1); }
+
+  // Time on the bus, recorded by the consumer per input port
+  void recordLatency(uint8_t port, uint16_t ticks) {
+    if (port < BUS_PORT_COUNT && ticks > maxLatency[port]) maxLatency[port] = ticks;
+  }
+  uint16_t getMaxLatency(uint8_t port) const { return port < BUS_PORT_COUNT ? maxLatency[port] : 0; }
+  uint8_t getHighWater() const { return highWater; }
+  uint16_t getOverflows() const { return overflows; }
+
+private:
+  BusEvent events[EVENT_BUS_SIZE];
+  volatile uint8_t head = 0;
+  volatile uint8_t tail = 0;
+  uint8_t highWater = 0;
+  uint16_t overflows = 0;
+  uint16_t maxLatency[BUS_PORT_COUNT] = {0};
+};
+
+extern EventBus eventBus;
+
+#endif  // EVENT_BUS_H
@@ -0,0 +1,109 @@
+/**
+ * MIDI BytePulse - Feedback Loop Guard
+ *
+ * A DAW with MIDI echo, or a synth with local thru cabled back, returns what
+ * this unit sent. With THRU and both forwarding routes on, every pass through
+ * the loop multiplies the traffic until DIN saturates and clocks come back in
+ * on the other port.
+ *
+ * Each output port (DIN, USB) keeps the last LOOP_GUARD_ENTRIES messages sent
+ * to it with their Timer1 stamp and millis(). A message arriving on that same
+ * port with the same bytes within LOOP_GUARD_WINDOW_TICKS is an echo; an entry
+ * older than LOOP_GUARD_STALE_MS never is, since its 16-bit stamp may have
+ * wrapped (every 262 ms) onto the new one. Each sent message
+ * absorbs at most one. A single match can be coincidence (the same note played
+ * twice), so a port is only flagged once LOOP_GUARD_CONFIRM echoes came back,
+ * and only then are echoes dropped. The flag clears after LOOP_GUARD_HOLD_MS
+ * without one.
+ *
+ * The window is shorter than a MIDI clock period at 300 BPM, so a clock
+ * passed THRU never matches the next real one. Anything that doesn't match
+ * goes on untouched; the check is a scan of one small table.
+ */
+
+#ifndef LOOP_GUARD_H
+#define LOOP_GUARD_H
+
+#include <stdint.h>
+
+#ifndef LOOP_GUARD_WINDOW_TICKS
+#define LOOP_GUARD_WINDOW_TICKS  1500  // Timer1 ticks (6 ms) from sending to the echo
+#endif
+
+#define LOOP_GUARD_ENTRIES   8     // Sent messages remembered per port (power of two)
+#define LOOP_GUARD_PORTS     2     // BUS_PORT_DIN, BUS_PORT_USB
+#define LOOP_GUARD_CONFIRM   2     // Echoes before a port is flagged
+#define LOOP_GUARD_HOLD_MS   1000  // Flag clears this long after the last echo
+#define LOOP_GUARD_STALE_MS  250   // Entries this old are forgotten: under one Timer1 wrap
+
+class LoopGuard {
+public:
+  // A message just went out on port (stamp = Timebase::now(), nowMs = millis())
+  void sent(uint8_t port, uint8_t byte1, uint8_t byte2, uint8_t byte3, uint16_t stamp, uint32_t nowMs) {
+    if (port >= LOOP_GUARD_PORTS) return;
+    Entry& entry = entries[port][next[port]];
+    next[port] = (next[port] + 1) & (LOOP_GUARD_ENTRIES - 1);
+    entry.byte1 = byte1;
+    entry.byte2 = byte2;
+    entry.byte3 = byte3;
+    entry.stamp = stamp;
+    entry.sentMs = nowMs;
+  }
+
+  // A message arrived on port at stamp; true when it is an echo to drop
+  bool isEcho(uint8_t port, uint8_t byte1, uint8_t byte2, uint8_t byte3, uint16_t stamp, uint32_t nowMs) {
+    if (port >= LOOP_GUARD_PORTS) return false;
+    expire(port, nowMs);
+
+    for (uint8_t i = 0; i < LOOP_GUARD_ENTRIES; i++) {
+      Entry& entry = entries[port][i];
+      if (entry.byte1 != byte1 || entry.byte2 != byte2 || entry.byte3 != byte3) continue;
+      if (nowMs - entry.sentMs >= LOOP_GUARD_STALE_MS) continue;
+      if ((uint16_t)(stamp - entry.stamp) > LOOP_GUARD_WINDOW_TICKS) continue;
+
+      entry.byte1 = 0;   // Used up: one echo per message sent
+      lastEchoMs[port] = nowMs;
+      if (hits[port] < LOOP_GUARD_CONFIRM) hits[port]++;
+      if (hits[port] < LOOP_GUARD_CONFIRM) return false;
+
+      if (echoes < 0xFFFF) echoes++;
+      return true;
+    }
+    return false;
+  }
+
+  // Bit per port (1 << BUS_PORT_*) where echoes are being dropped
+  uint8_t getFlags(uint16_t nowMs) {
+    uint8_t flags = 0;
+    for (uint8_t port = 0; port < LOOP_GUARD_PORTS; port++) {
+      expire(port, nowMs);
+      if (hits[port] >= LOOP_GUARD_CONFIRM) flags |= 1 << port;
+    }
+    return flags;
+  }
+
+  uint16_t getEchoes() const { return echoes; }
+
+private:
+  struct Entry {
+    uint8_t byte1;   // 0 = empty (a status byte never is)
+    uint8_t byte2;
+    uint8_t byte3;
+    uint16_t stamp;
+    uint32_t sentMs;
+  };
+
+  void expire(uint8_t port, uint16_t nowMs) {
+    if (hits[port] && (uint16_t)(nowMs - lastEchoMs[port]) > LOOP_GUARD_HOLD_MS) hits[port] = 0;
+  }
+
+  Entry entries[LOOP_GUARD_PORTS][LOOP_GUARD_ENTRIES] = {};
+  uint8_t next[LOOP_GUARD_PORTS] = {0};
+  uint8_t hits[LOOP_GUARD_PORTS] = {0};
+  uint16_t lastEchoMs[LOOP_GUARD_PORTS] = {0};
+  uint16_t echoes = 0;
+};
+
+extern LoopGuard loopGuard;
+
+#endif  // LOOP_GUARD_H
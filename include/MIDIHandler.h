@@ -0,0 +1,71 @@
+/**
+ * MIDI BytePulse - MIDI Handler
+ * Parses DIN IN onto the event bus and routes everything on the bus
+ * (DIN, USB, SYNC_IN) to DIN OUT, USB and the sync engine
+ */
+
+#ifndef MIDI_HANDLER_H
+#define MIDI_HANDLER_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "UsbMidi.h"
+#include "CoalesceQueue.h"
+#include "EventBus.h"
+
+class Sync;
+
+class MIDIHandler {
+public:
+  void begin();
+  void update();                   // Parses DIN IN onto the bus
+  void setSync(Sync* s);
+  static void dispatch();          // Routes every event on the bus, oldest first
+  static void flushBuffer();
+  static void sendSysExToUSB(const byte* data, unsigned size);
+  
+  // DIN OUT congestion statistics (USB -> DIN)
+  static uint16_t getCoalescedCount() { return dinPending.getCoalescedCount(); }
+  static uint16_t getParkedCount() { return dinPending.getParkedCount(); }
+
+private:
+  static Sync* sync;
+  static CoalesceQueue dinPending;
+  static uint8_t loopFlags;        // LoopGuard flags last traced
+  
+  static void sendMessage(const midiEventPacket_t& event);
+  static void postFromDIN(byte status, byte data1, byte data2);
+  static void routeFromDIN(const BusEvent& event);
+  static void routeFromUSB(const BusEvent& event);
+  static void forwardDINtoUSB(const BusEvent& event, uint8_t cable);
+  static void forwardUSBtoDIN(const BusEvent& event);
+  static void forwardUSBSysEx(const BusEvent& event);
+  static void sendEventToDIN(const BusEvent& event);
+  static bool isEcho(uint8_t port, const BusEvent& event);
+  static void guardSent(uint8_t port, const BusEvent& event);
+  static void sendChannelToDIN(byte status, byte data1, byte data2);
+  static void drainPendingToDIN();
+  static void flushPendingChannel(uint8_t channel);
+  static void sendParkedToDIN(byte status, byte data1, byte data2);
+  
+  static void handleNoteOn(byte channel, byte note, byte velocity);
+  static void handleNoteOff(byte channel, byte note, byte velocity);
+  static void handleAfterTouchPoly(byte channel, byte note, byte pressure);
+  static void handleControlChange(byte channel, byte controller, byte value);
+  static void handleProgramChange(byte channel, byte program);
+  static void handleAfterTouchChannel(byte channel, byte pressure);
+  static void handlePitchBend(byte channel, int bend);
+  static void handleSystemExclusive(byte* data, unsigned size);
+  static void handleTimeCodeQuarterFrame(byte data);
+  static void handleSongPosition(unsigned beats);
+  static void handleSongSelect(byte song);
+  static void handleTuneRequest();
+  static void handleClock();
+  static void handleStart();
+  static void handleContinue();
+  static void handleStop();
+  static void handleActiveSensing();
+  static void handleSystemReset();
+};
+
+#endif  // MIDI_HANDLER_H
@@ -0,0 +1,60 @@
+/**
+ * MIDI BytePulse - Oscillator Calibration
+ * Measures the local timer against USB start-of-frame in the background while a
+ * host is attached, hands the ppm correction to Sync and keeps the last one in
+ * EEPROM for standalone use (math in OscillatorDrift.h)
+ */
+
+#ifndef OSCILLATOR_H
+#define OSCILLATOR_H
+
+#include <Arduino.h>
+#include "OscillatorDrift.h"
+
+class Sync;
+
+#define OSC_STATE_NONE      0   // Never calibrated: no correction
+#define OSC_STATE_STORED    1   // Correction from EEPROM (no host, or no window finished yet)
+#define OSC_STATE_LIVE      2   // Measured against this host's SOF
+
+// EEPROM copy is rewritten only when the estimate moved this far, and never while a clock runs
+#define OSC_SAVE_STEP_PPM   4
+#define OSC_SAVE_WINDOWS    3   // Windows measured before the first save
+
+class Oscillator {
+public:
+  // Loads the stored correction and applies it
+  static void begin(Sync* s);
+
+  // Once per loop() pass while USB is in the profile: samples the frame counter
+  static void update();
+
+  static uint8_t getState() { return state; }
+  static int16_t getPpm() { return ppm; }
+  static int16_t getLastWindowPpm() { return lastWindowPpm; }
+  static uint16_t getWindows() { return windows; }
+  static uint16_t getRejected() { return rejected; }
+
+private:
+  static void closeWindow(unsigned long edgeUs);
+  static void load();
+  static void save();
+
+  static Sync* sync;
+  static uint8_t state;
+  static int16_t ppm;
+  static int16_t storedPpm;
+  static int16_t lastWindowPpm;
+  static uint16_t windows;              // Accepted this session
+  static uint16_t rejected;             // Implausible (frames lost to a bus reset or suspend)
+  static bool savePending;
+
+  static bool sampled;
+  static bool windowOpen;
+  static uint16_t lastFrame;            // UDFNUM, 11 bits
+  static unsigned long lastSampleUs;
+  static uint16_t windowFrames;
+  static unsigned long windowStartUs;
+};
+
+#endif  // OSCILLATOR_H
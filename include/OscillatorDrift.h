@@ -0,0 +1,50 @@
+/**
+ * MIDI BytePulse - Oscillator Drift Math
+ *
+ * The 16 MHz resonator is off by up to +-0.5 % and moves with temperature, and
+ * every interval the firmware generates (SYNC_OUT pulse width, anything timed
+ * off micros()) carries that error. A USB host sends a start-of-frame every
+ * 1 ms from its own, far better clock; counting local microseconds across a
+ * few thousand frames gives the error in ppm. Positive ppm = the local timer
+ * runs fast (more than 1000 local us per frame).
+ *
+ * Pure functions: the sampling and EEPROM copy are in Oscillator.h.
+ */
+
+#ifndef OSCILLATOR_DRIFT_H
+#define OSCILLATOR_DRIFT_H
+
+#include <stdint.h>
+
+#define DRIFT_WINDOW_FRAMES   8192   // SOFs per measurement (~8 s)
+#define DRIFT_EDGE_MAX_US     200    // Widest sample pair that still pins down a frame start
+#define DRIFT_MAX_PPM         6000   // Beyond a resonator's tolerance: a bad window, not drift
+#define DRIFT_FILTER_SHIFT    2      // Each window moves the estimate 1/4 of the way
+
+// Error of the local timer over a window of whole frames, in ppm
+inline int32_t driftPpm(uint16_t frames, unsigned long localUs) {
+  if (frames == 0) return 0;
+  int32_t expectedUs = (int32_t)frames * 1000;
+  return ((int32_t)localUs - expectedUs) * 1000 / frames;
+}
+
+inline bool driftPlausible(int32_t ppm) {
+  return ppm >= -DRIFT_MAX_PPM && ppm <= DRIFT_MAX_PPM;
+}
+
+// Smoothed estimate: the first window is taken as is, later ones are blended in
+inline int16_t driftFilter(int16_t current, int16_t measured, bool first) {
+  if (first) return measured;
+  return current + (measured - current) / (1 << DRIFT_FILTER_SHIFT);
+}
+
+// Local timer microseconds that span us real microseconds (ppm within DRIFT_MAX_PPM)
+inline unsigned long driftLocalUs(unsigned long us, int16_t ppm) {
+  if (us <= 0x7FFFFFFFUL / DRIFT_MAX_PPM) {
+    return us + (int32_t)us * ppm / 1000000L;
+  }
+  // Long spans: us / 64 keeps the product in 32 bits, off by under 1 us up to ~20 s
+  return us + (int32_t)(us >> 6) * ppm / 15625;
+}
+
+#endif  // OSCILLATOR_DRIFT_H
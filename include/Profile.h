@@ -0,0 +1,72 @@
+/**
+ * MIDI BytePulse - Deployment Profiles
+ *
+ * What a build of the firmware has to handle, as compile-time constants.
+ * Code tests them with a plain if (Profile::din) ...; the condition folds away
+ * and the paths a profile doesn't use (and the MIDI parser, USB transfers etc.
+ * they pull in) drop out of the image. Interrupt vectors and global objects
+ * are linked whether or not anything calls them, so the DIN UART vectors and
+ * MIDI_DIN instance, and the USB-MIDI interface plug, test PROFILE_HAS_* with
+ * the preprocessor or the constructor instead.
+ * Pick one with -DBYTEPULSE_PROFILE=... (see the analog_only / usb_host
+ * environments in platformio.ini).
+ *
+ * Profiles only choose inputs. Pins, pulse widths, the test modes and
+ * FORWARD_MIDI_IN_TO_MIDI_OUT stay plain config.h settings: they are the
+ * same in every profile so far.
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+
+#define PROFILE_FULL_ROUTER   0   // DIN, USB and SYNC_IN: the standard BytePulse
+#define PROFILE_ANALOG_ONLY   1   // SYNC_IN -> SYNC_OUT / DISPLAY_CLK rate converter
+#define PROFILE_USB_HOST      2   // USB clock from a computer -> analog outputs
+
+#ifndef BYTEPULSE_PROFILE
+#define BYTEPULSE_PROFILE     PROFILE_FULL_ROUTER
+#endif
+
+struct ProfileFullRouter {
+  static constexpr uint8_t id = PROFILE_FULL_ROUTER;
+  static constexpr bool din = true;       // DIN IN/OUT: UART, MIDI parser, THRU, DIN clock source
+  static constexpr bool usb = true;       // USB MIDI in/out and the USB clock source
+  static constexpr bool syncIn = true;    // SYNC_IN jack (INT6) as a clock source
+};
+
+struct ProfileAnalogOnly {
+  static constexpr uint8_t id = PROFILE_ANALOG_ONLY;
+  static constexpr bool din = false;
+  static constexpr bool usb = false;
+  static constexpr bool syncIn = true;
+};
+
+struct ProfileUsbHost {
+  static constexpr uint8_t id = PROFILE_USB_HOST;
+  static constexpr bool din = false;
+  static constexpr bool usb = true;
+  static constexpr bool syncIn = false;
+};
+
+#if BYTEPULSE_PROFILE == PROFILE_ANALOG_ONLY
+typedef ProfileAnalogOnly Profile;
+#elif BYTEPULSE_PROFILE == PROFILE_USB_HOST
+typedef ProfileUsbHost Profile;
+#elif BYTEPULSE_PROFILE == PROFILE_FULL_ROUTER
+typedef ProfileFullRouter Profile;
+#else
+#error "Unknown BYTEPULSE_PROFILE"
+#endif
+
+static_assert(Profile::din || Profile::usb || Profile::syncIn, "A profile needs at least one clock source");
+
+// The same switches for #if
+#define PROFILE_HAS_DIN  (BYTEPULSE_PROFILE == PROFILE_FULL_ROUTER)
+#define PROFILE_HAS_USB  (BYTEPULSE_PROFILE != PROFILE_ANALOG_ONLY)
+
+static_assert(Profile::din == PROFILE_HAS_DIN, "PROFILE_HAS_DIN out of step with the profile structs");
+static_assert(Profile::usb == PROFILE_HAS_USB, "PROFILE_HAS_USB out of step with the profile structs");
+
+#endif  // PROFILE_H
@@ -0,0 +1,89 @@
+/**
+ * MIDI BytePulse - Routing / Filter Matrix
+ *
+ * One 16-bit mask per (source, destination, message row):
+ *   rows 0-6: channel messages 0x80-0xE0, one bit per MIDI channel
+ *   row 7:    system messages, one bit per ROUTE_SYS_* class
+ * A lookup is a single table read plus an AND, whatever the message.
+ */
+
+#ifndef ROUTE_TABLE_H
+#define ROUTE_TABLE_H
+
+#include <stdint.h>
+
+#if defined(ARDUINO)
+#include <avr/pgmspace.h>
+#elif !defined(PROGMEM)
+#define PROGMEM
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+#endif
+
+enum RouteSource {
+  ROUTE_SRC_DIN,
+  ROUTE_SRC_USB,
+  ROUTE_SRC_SYNC,      // Clocks generated from SYNC_IN
+  ROUTE_SOURCE_COUNT
+};
+
+enum RouteDest {
+  ROUTE_DST_DIN,       // DIN MIDI OUT (THRU when the source is DIN)
+  ROUTE_DST_USB,
+  ROUTE_DEST_COUNT
+};
+
+#define ROUTE_ROWS            8
+#define ROUTE_ROW_SYSTEM      7
+
+// System message classes (row 7 bits)
+#define ROUTE_SYS_SYSEX           0x0001  // F0, F7
+#define ROUTE_SYS_COMMON          0x0002  // F1, F2, F3, F6
+#define ROUTE_SYS_CLOCK           0x0004  // F8
+#define ROUTE_SYS_TRANSPORT       0x0008  // FA, FB, FC
+#define ROUTE_SYS_ACTIVE_SENSING  0x0010  // FE
+#define ROUTE_SYS_RESET           0x0020  // FF
+
+#define ROUTE_ALL_CHANNELS    0xFFFF
+
+#define ROUTE_SAVE_IDLE       0xFF
+
+class RouteTable {
+public:
+  void load();            // From EEPROM, falls back to defaults
+  void save();            // Starts writing the table to EEPROM, one cell per update()
+  void update();          // Main loop: next cell of a pending save, once the last write is done
+  bool isSaving() const { return saveStep != ROUTE_SAVE_IDLE; }
+  void setDefaults();
+
+  inline bool allows(uint8_t source, uint8_t dest, uint8_t status) const {
+    // Bit tested per status byte: 0x80-0xEF -> channel bit, 0xF0-0xFF -> system class
+    static const uint16_t routeBits[32] PROGMEM = {
+      0x0001, 0x0002, 0x0004, 0x0008, 0x0010, 0x0020, 0x0040, 0x0080,
+      0x0100, 0x0200, 0x0400, 0x0800, 0x1000, 0x2000, 0x4000, 0x8000,
+      ROUTE_SYS_SYSEX, ROUTE_SYS_COMMON, ROUTE_SYS_COMMON, ROUTE_SYS_COMMON,
+      0, 0, ROUTE_SYS_COMMON, ROUTE_SYS_SYSEX,
+      ROUTE_SYS_CLOCK, 0, ROUTE_SYS_TRANSPORT, ROUTE_SYS_TRANSPORT,
+      ROUTE_SYS_TRANSPORT, 0, ROUTE_SYS_ACTIVE_SENSING, ROUTE_SYS_RESET
+    };
+    
+    uint8_t row = (status >> 4) & 0x07;  // 0x80 -> 0 ... 0xE0 -> 6, 0xF0 -> 7
+    uint8_t bit = (row == ROUTE_ROW_SYSTEM ? 16 : 0) | (status & 0x0F);
+    return masks[source][dest][row] & pgm_read_word(&routeBits[bit]);
+  }
+
+  uint16_t getMask(uint8_t source, uint8_t dest, uint8_t row) const {
+    return masks[source][dest][row];
+  }
+  void setMask(uint8_t source, uint8_t dest, uint8_t row, uint16_t mask) {
+    masks[source][dest][row] = mask;
+  }
+
+private:
+  uint16_t masks[ROUTE_SOURCE_COUNT][ROUTE_DEST_COUNT][ROUTE_ROWS];
+  uint8_t saveStep = ROUTE_SAVE_IDLE;   // Next cell of a save: data bytes, then checksum, version, magic
+  uint8_t saveChecksum = 0;
+};
+
+extern RouteTable routeTable;
+
+#endif  // ROUTE_TABLE_H
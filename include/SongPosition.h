@@ -0,0 +1,39 @@
+/**
+ * MIDI BytePulse - Song Position
+ *
+ * Where the outputs stand in the song: MIDI beats (16ths, as in a Song
+ * Position Pointer) and the clocks into the current beat. SYNC_OUT divides a
+ * counter that runs over the quarter note, the analog bank counts clocks since
+ * the song start; both are worked out from the position after an SPP or a
+ * Continue so the first edge lands back on the song's grid.
+ *
+ * Pure functions; Sync owns the position.
+ */
+
+#ifndef SONG_POSITION_H
+#define SONG_POSITION_H
+
+#include <stdint.h>
+
+#define SONG_CLOCKS_PER_BEAT    6        // MIDI beat = 16th note
+#define SONG_POSITION_MASK      0x3FFF   // SPP is 14 bits
+
+// 24 PPQN clocks since the song start (SPP x 6)
+inline uint32_t songClocks(uint16_t position, uint8_t tick) {
+  return (uint32_t)position * SONG_CLOCKS_PER_BEAT + tick;
+}
+
+// Where in the quarter note the position falls (4 MIDI beats of 6 clocks)
+inline uint8_t songQuarterCounter(uint16_t position, uint8_t tick) {
+  return (position & 3) * SONG_CLOCKS_PER_BEAT + tick;
+}
+
+// One clock on; the position wraps with the 14-bit SPP
+inline void songAdvance(uint16_t& position, uint8_t& tick) {
+  if (++tick >= SONG_CLOCKS_PER_BEAT) {
+    tick = 0;
+    position = (position + 1) & SONG_POSITION_MASK;
+  }
+}
+
+#endif  // SONG_POSITION_H
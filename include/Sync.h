@@ -2,13 +2,10 @@
 #define SYNC_H
 
 #include <Arduino.h>
-
-enum ClockSource {
-  CLOCK_SOURCE_NONE,
-  CLOCK_SOURCE_SYNC_IN,
-  CLOCK_SOURCE_DIN,
-  CLOCK_SOURCE_USB
-};
+#include "config.h"
+#include "ClockArbiter.h"
+#include "AnalogOutputs.h"
+#include "SongPosition.h"
 
 enum SyncInRate {
   SYNC_IN_1_PPQN = 1,
@@ -18,53 +15,115 @@ enum SyncInRate {
   SYNC_IN_24_PPQN = 24
 };
 
+#define DELAY_EDGE_SYNC_OUT     0x01
+#define DELAY_EDGE_ANALOG       0x02   // Pulses of the analog bank (DISPLAY_CLK, pins 2 / 3)
+
 class Sync {
 public:
   void begin();
   void handleClock(ClockSource source);
+  void handleClock(ClockSource source, unsigned long timestampUs);
   void handleStart(ClockSource source);
+  void handleContinue(ClockSource source);  // Resumes on the song position's subdivision
   void handleStop(ClockSource source);
-  void handleSyncInPulse();
+  void handleSongPosition(ClockSource source, uint16_t beats);
+  void handleSyncInPulse();        // INT6: first clock edge goes out here, the edge goes on the event bus
+  void handleSyncInEvent(uint16_t stamp, bool firstSent);  // The rest of the burst, from the bus consumer
   void update();
   bool isBeatActive() const { return ledState; }
-  bool isClockRunning() const { return isPlaying; }
+  uint8_t getAnalogActive() const { return analogActive; }        // Bank outputs in their pulse / gate
+  bool isClockRunning() const { return activeSource != CLOCK_SOURCE_NONE; }
   ClockSource getActiveSource() const { return activeSource; }
-  bool isUSBPlaying() const { return usbIsPlaying; }
-  bool isSyncInPlaying() const { return syncInIsPlaying; }
+  uint16_t getSongPosition() const { return songPosition; }       // MIDI beats (16ths)
+  bool accepts(ClockSource source) const { return clockArbiterAccepts(activeSource, source); }
+  unsigned long getClockPeriodUs() const { return clockPeriodUs; }  // Smoothed 24 PPQN interval, 0 = unknown
+  unsigned long getLastClockMillis(ClockSource source) const;
+  
+  // Chain compensation: SYNC_OUT and analog bank clock edges go out this much later (DIN clock never does)
+  void setOutputDelayUs(unsigned long us);
   
-  SyncInRate readSyncInRate();     // Read rotary switch position
-  uint8_t getSyncInMultiplier();   // Get PPQN multiplier for SYNC_IN → MIDI
-  uint8_t getSyncOutDivisor();     // Get PPQN divisor for MIDI → SYNC_OUT
+  // Oscillator correction (Oscillator.h): generated intervals are stretched by ppm
+  void setDriftPpm(int16_t ppm);
+  
+  // Front panel (Controls.h)
+  void setSyncRate(SyncInRate rate);             // Rate switch position, both directions
+  void setPulseWidthUs(unsigned long us);        // SYNC_OUT pulse width
+  void setSwing(uint8_t swing);                  // Off-beat SYNC_OUT delay, 0 = straight
+  
+  // Both 24 / switch PPQN, worked out when the switch changes rather than on every clock
+  uint8_t getSyncInMultiplier() const { return syncRateFactor; }  // SYNC_IN → MIDI
+  uint8_t getSyncOutDivisor() const { return syncRateFactor; }    // MIDI → SYNC_OUT
   
   void (*onClockStop)() = nullptr;
   void (*onClockStart)() = nullptr;
 
 private:
-  void checkUSBTimeout();
+  uint8_t arbitrate(ClockSource source, ClockEvent event, uint8_t status);  // Returns CLOCK_ACT_* taken
+  void startTransport(ClockSource source, uint8_t status);
+  void advancePosition();
+  void clearOutputs();
+  void checkClockTimeout();
   bool isSyncInConnected();
-  void sendMIDIClock();
+  void sendMIDIClock(bool toDin = true);
+  void trackClockPeriod(unsigned long timestampUs, uint8_t clocks = 1);
+  void raiseSyncOut();
+  bool swingEdge();
+  void raiseAnalog(uint8_t outputs, unsigned long riseUs);
+  void writeAnalog(uint8_t active);
+  void tickAnalog(unsigned long riseUs);
+  void rebaseAnalog();
+  void updateAnalogDue();
+  void sendDisplayCode();
+  bool delayEdge(uint8_t output, uint8_t analog = 0);
+  void fireDelayedEdges();
   
   unsigned long lastPulseTime = 0;
   unsigned long ledPulseTime = 0;
   unsigned long lastUSBClockTime = 0;
   unsigned long lastDINClockTime = 0;
   unsigned long lastSyncInTime = 0;
-  volatile unsigned long syncInPulseTime = 0;
+  volatile uint8_t syncInQueued = 0;      // SYNC_IN edges on the event bus, not yet handled
+  volatile bool syncInConnected = false;   // Detect jack, refreshed by update() for the handler
   unsigned long syncOutPulseTime = 0;
-  unsigned long displayClkPulseTime = 0;
+  unsigned long lastClockStampUs = 0;    // Arrival time of the previous accepted clock
+  unsigned long clockPeriodUs = 0;
+  unsigned long tickPeriodUs = 0;        // Smoothed interval between the active source's ticks (clocks or SYNC_IN pulses)
+  volatile unsigned long outputDelayUs = 0;
+  unsigned long pulseWidthUs = 0;        // SYNC_OUT width in local timer us (setDriftPpm)
+  unsigned long syncOutWidthUs = CLOCK_PULSE_WIDTH_US;  // Nominal width, before the correction
+  int16_t driftPpm = 0;
+  uint8_t swing = 0;
+  bool swingPending = false;             // Off-beat SYNC_OUT edge waiting for swingDueUs
+  unsigned long swingDueUs = 0;
+  unsigned long delayedDueUs = 0;
+  uint8_t delayedEdges = 0;              // DELAY_EDGE_* waiting for delayedDueUs
+  uint8_t delayedAnalog = 0;             // Bank outputs behind DELAY_EDGE_ANALOG
   bool clockState = false;
-  bool displayClkState = false;
   bool ledState = false;
   byte ppqnCounter = 0;
-  bool isPlaying = false;
-  bool usbIsPlaying = false;
-  bool syncInIsPlaying = false;
-  ClockSource activeSource = CLOCK_SOURCE_NONE;
+  uint16_t songPosition = 0;             // MIDI beats (16ths) since the song start, as in SPP
+  uint8_t songTick = 0;                  // Clocks into the current MIDI beat
+  
+  // Analog output bank (AnalogOutputs.h), bit i = output i
+  uint8_t analogPhase[ANALOG_OUT_COUNT];
+  unsigned long analogRiseUs[ANALOG_OUT_COUNT];
+  unsigned long analogWidthUs[ANALOG_OUT_COUNT];  // Local timer us, 0 = gate
+  uint8_t analogActive = 0;
+  uint8_t analogRunMask = 0;
+  uint8_t analogResetMask = 0;
+  // Port bits the INT6 handler sets / clears: outputs due on the next clock, or a new run
+  volatile uint8_t analogDueOutputs = 0;
+  volatile uint8_t analogDueSet = 0;
+  volatile uint8_t analogDueClear = 0;
+  volatile uint8_t analogIsrRaised = 0;  // Outputs the handler raised, taken over by update()
+  uint8_t analogStartSet = 0;
+  uint8_t analogStartClear = 0;
+  ClockSource activeSource = CLOCK_SOURCE_NONE;  // Arbitration state (ClockArbiter.h)
   
   SyncInRate syncRate = SYNC_IN_2_PPQN;  // Switch setting (controls both IN and OUT)
+  uint8_t syncRateFactor = 24 / SYNC_IN_2_PPQN;
   uint8_t syncInPulseCounter = 0;        // Counter for SYNC_IN PPQN multiplication
   uint8_t syncOutPulseCounter = 0;       // Counter for SYNC_OUT PPQN division
-  unsigned long lastSwitchReadTime = 0;  // For non-blocking switch debouncing
 };
 
 #endif
@@ -0,0 +1,124 @@
+/**
+ * MIDI BytePulse - Device SysEx Protocol
+ *
+ * Messages: F0 7D 42 50 <command> [payload] F7
+ *   7D = non-commercial manufacturer ID, 42 50 = "BP"
+ *   All payload bytes are 7-bit; 16-bit masks are sent as 3 bytes (bits 0-6, 7-13, 14-15)
+ *
+ * Commands (replies are sent back to the port the request came from):
+ *   01 src dst row m0 m1 m2   Set one route mask
+ *   02 src dst                Request route masks -> 03 src dst (8 x m0 m1 m2)
+ *   04                        Save route table to EEPROM
+ *   05                        Restore default routes (not saved until 04)
+ *   10                        Request statistics -> 11 (n x c0 c1 c2), 16-bit counters:
+ *                               0 DIN RX overflows, 1 DIN OUT values coalesced,
+ *                               2 DIN OUT messages parked while congested,
+ *                               3 USB packets dropped (no host), 4 USB packets dropped (port not read),
+ *                               5 USB RX largest batch, 6 USB RX CPU cycles per packet
+ *   12                        Request RAM usage -> 13 (c0 c1 c2 x 3): free RAM now,
+ *                               stack high-water since reset, static .data+.bss (bytes)
+ *   14                        Request last watchdog stall -> 15 (c0 c1 c2 x 9): valid, stage,
+ *                               clock source, max loop us (saturates at 65535), uptime s,
+ *                               ms since last DIN clock, USB clock, SYNC_IN pulse, max loop ms
+ *                               (also sent unsolicited after a stall reset)
+ *   16 on                     Stream trace events to this port in idle time
+ *                               (on = 0 off, 1 on, 2 on + raw DIN/USB input for replay captures)
+ *                             -> 17 (id a0 a1 s0 s1 x n): a0 = arg bits 0-6,
+ *                               a1 = arg bit 7 | stamp bits 14-15 << 1, s0 s1 = stamp bits 0-13
+ *   18                        Calibrate the DIN chain with this unit as head (see Chain.h)
+ *   19 seq hops               Chain ping, DIN only: forwarded with hops + 1, consumed by its head
+ *   1A hops units h0 h1 h2    Chain result, DIN only: hop latency (us) from the head, forwarded
+ *                               until the last unit
+ *   1B                        Request chain calibration -> 1C (c0 c1 c2 x 6): state, position,
+ *                               units, hop latency us, output delay us, round trip us (head only)
+ *   1D                        Request oscillator calibration -> 1E (c0 c1 c2 x 5): state, ppm,
+ *                               last window ppm (both two's complement), windows, rejected windows
+ *   1F                        Request front panel -> 20 (c0 c1 c2 x 6): rate switch PPQN,
+ *                               pots A0-A3 (0-255, 0 when not fitted), tempo pot BPM
+ */
+
+#ifndef SYSEX_CONTROL_H
+#define SYSEX_CONTROL_H
+
+#include <Arduino.h>
+#include "UsbMidi.h"
+
+#define SYSEX_MANUFACTURER_ID   0x7D
+#define SYSEX_DEVICE_ID_1       0x42
+#define SYSEX_DEVICE_ID_2       0x50
+#define SYSEX_HEADER_SIZE       5     // F0 7D 42 50 cmd
+#define SYSEX_MAX_MESSAGE_SIZE  36    // Longest reply: STALL_DATA, 9 values
+
+#define SYSEX_CMD_ROUTE_SET       0x01
+#define SYSEX_CMD_ROUTE_GET       0x02
+#define SYSEX_CMD_ROUTE_DATA      0x03
+#define SYSEX_CMD_ROUTE_SAVE      0x04
+#define SYSEX_CMD_ROUTE_DEFAULTS  0x05
+#define SYSEX_CMD_STATS_GET       0x10
+#define SYSEX_CMD_STATS_DATA      0x11
+#define SYSEX_CMD_MEMORY_GET      0x12
+#define SYSEX_CMD_MEMORY_DATA     0x13
+#define SYSEX_CMD_STALL_GET       0x14
+#define SYSEX_CMD_STALL_DATA      0x15
+#define SYSEX_CMD_TRACE_STREAM    0x16
+#define SYSEX_CMD_TRACE_DATA      0x17
+#define SYSEX_CMD_CHAIN_CALIBRATE 0x18
+#define SYSEX_CMD_CHAIN_PING      0x19
+#define SYSEX_CMD_CHAIN_RESULT    0x1A
+#define SYSEX_CMD_CHAIN_GET       0x1B
+#define SYSEX_CMD_CHAIN_DATA      0x1C
+#define SYSEX_CMD_OSC_GET         0x1D
+#define SYSEX_CMD_OSC_DATA        0x1E
+#define SYSEX_CMD_CONTROLS_GET    0x1F
+#define SYSEX_CMD_CONTROLS_DATA   0x20
+#define SYSEX_CMD_BUS_GET         0x21
+#define SYSEX_CMD_BUS_DATA        0x22
+
+#define SYSEX_TRACE_EVENTS        8     // Events per trace message (5 bytes each)
+
+#define SYSEX_STAT_DIN_RX_OVERFLOWS  0
+#define SYSEX_STAT_DIN_COALESCED     1
+#define SYSEX_STAT_DIN_PARKED        2
+#define SYSEX_STAT_USB_DROP_NO_HOST  3
+#define SYSEX_STAT_USB_DROP_FULL     4
+#define SYSEX_STAT_USB_RX_BATCH      5
+#define SYSEX_STAT_USB_RX_CYCLES     6
+#define SYSEX_STAT_LOOP_ECHOES       7
+#define SYSEX_STAT_COUNT             8
+
+class SysExControl {
+public:
+  // Complete message from DIN (F0 ... F7), returns true if it was addressed to us
+  static bool handleMessage(const byte* data, unsigned size, uint8_t port);
+
+  // USB SysEx arrives in 3-byte packets; collect our own messages only
+  static void feedUSBPacket(const midiEventPacket_t& event);
+
+  // Watchdog post-mortem from the previous run (all zero when there is none)
+  static void sendStallRecord(uint8_t port);
+
+  // One message of buffered trace events, if streaming is on
+  static void sendTrace();
+
+  // Chain calibration traffic, always on DIN OUT
+  static void sendChainPing(uint8_t seq, uint8_t hops);
+  static void sendChainResult(uint8_t hops, uint8_t units, uint16_t hopUs);
+
+private:
+  static void dispatch(const byte* data, unsigned size, uint8_t port);
+  static void sendRouteData(uint8_t source, uint8_t dest, uint8_t port);
+  static void sendStats(uint8_t port);
+  static void sendMemory(uint8_t port);
+  static void sendChainData(uint8_t port);
+  static void sendOscillatorData(uint8_t port);
+  static void sendControlsData(uint8_t port);
+  static void sendBusData(uint8_t port);
+  static void sendCounters(uint8_t command, const uint16_t* values, uint8_t count, uint8_t port);
+  static void reply(const byte* data, unsigned size, uint8_t port);
+
+  static byte usbBuffer[SYSEX_MAX_MESSAGE_SIZE];
+  static uint8_t usbLength;
+  static bool usbDiscard;
+};
+
+#endif  // SYSEX_CONTROL_H
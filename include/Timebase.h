@@ -0,0 +1,34 @@
+/**
+ * MIDI BytePulse - Hardware Timebase
+ * Timer1 free-running at 250 kHz (4 us per tick) for event timestamps
+ */
+
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include <Arduino.h>
+
+#define TIMEBASE_US_PER_TICK  4   // 16 MHz / 64 prescaler
+// A 16-bit stamp wraps every 65536 * 4 us = 262 ms
+
+class Timebase {
+public:
+  static void begin();
+
+  // Safe to call from interrupt context - a single 16-bit register read
+  static inline uint16_t now() { return TCNT1; }
+
+  // Convert a recent stamp (less than 262 ms old) to the micros() domain
+  static unsigned long toMicros(uint16_t stamp);
+
+  // Timer1 overflow count (wraps every ~67 s), extends stamps for the tracer
+  static inline uint8_t epoch() { return overflows; }
+
+  // Called from the Timer1 overflow vector only
+  static inline void overflowIrq() { overflows++; }
+
+private:
+  static volatile uint8_t overflows;
+};
+
+#endif  // TIMEBASE_H
@@ -0,0 +1,124 @@
+/**
+ * MIDI BytePulse - Binary Event Tracer
+ *
+ * Records 4-byte events (id, argument, Timer1 stamp) into a RAM ring buffer
+ * without touching the serial port. The buffer is drained as SysEx (17) in
+ * idle loop passes; tools/trace_decode.py turns the capture into a timeline.
+ * Recording costs a few dozen cycles and is safe from interrupts.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "Timebase.h"
+
+// Event ids (arguments in brackets)
+#define TRACE_EV_EPOCH        0x01  // Timer1 overflow count changed [epoch]
+#define TRACE_EV_LOST         0x02  // Events dropped while the buffer was full [count]
+#define TRACE_EV_CLOCK_IN     0x10  // Clock received [ClockSource]
+#define TRACE_EV_CLOCK_OUT    0x11  // Clock sent to DIN / USB [ClockSource it came from]
+#define TRACE_EV_START        0x12  // Start / Continue [ClockSource]
+#define TRACE_EV_STOP         0x13  // Stop [ClockSource]
+#define TRACE_EV_SOURCE       0x14  // Active clock source changed [ClockSource]
+#define TRACE_EV_SYNC_RATE    0x15  // Rate switch changed [PPQN]
+#define TRACE_EV_LOOP         0x16  // Feedback loop flags changed [1 << BUS_PORT_* echoing]
+#define TRACE_EV_SYNC_IN      0x20  // SYNC_IN rising edge
+#define TRACE_EV_SYNC_OUT     0x21  // SYNC_OUT edge [level]
+#define TRACE_EV_ANALOG_OUT   0x22  // Analog bank changed [active outputs, bit 0 = DISPLAY_CLK]
+#define TRACE_EV_OVERFLOW     0x30  // Buffer overflow / drop [TRACE_BUF_*]
+#define TRACE_EV_DIN_RX       0x40  // Capture mode: DIN byte received [byte]
+#define TRACE_EV_USB_RX       0x41  // Capture mode: USB receive pass [packets that follow]
+#define TRACE_EV_USB_PACKET   0x60  // Capture mode: | cable << 4 | code index [byte1], see recordPacket()
+
+#define TRACE_BUF_DIN_RX       0   // DIN receive ring full, byte lost
+#define TRACE_BUF_USB_FULL     1   // USB packet dropped, host not reading
+
+struct TraceEvent {
+  uint8_t id;
+  uint8_t arg;
+  uint16_t stamp;   // Timebase ticks
+};
+
+class Trace {
+public:
+  static inline void record(uint8_t id, uint8_t arg = 0) {
+#if TRACE_ENABLED
+    uint8_t oldSREG = SREG;
+    cli();
+    uint16_t stamp = Timebase::now();
+    uint8_t epoch = Timebase::epoch();
+    // Overflow pending but not yet serviced (we may be inside another ISR)
+    if ((TIFR1 & (1 << TOV1)) && stamp < 0x8000) epoch++;
+
+    if (epoch != lastEpoch) {
+      lastEpoch = epoch;
+      push(TRACE_EV_EPOCH, epoch, stamp);
+    }
+    if (lost) {
+      if (push(TRACE_EV_LOST, lost, stamp)) lost = 0;
+    }
+    push(id, arg, stamp);
+    SREG = oldSREG;
+#else
+    (void)id;
+    (void)arg;
+#endif
+  }
+
+  // Capture mode: one USB packet per event, right after its TRACE_EV_USB_RX
+  // (whose time it shares); the stamp field carries byte2 and byte3. Cables 0-1.
+  static inline void recordPacket(uint8_t header, uint8_t byte1, uint8_t byte2, uint8_t byte3) {
+#if TRACE_ENABLED
+    uint8_t oldSREG = SREG;
+    cli();
+    push(TRACE_EV_USB_PACKET | ((header >> 4) & 0x01) << 4 | (header & 0x0F), byte1, byte2 | (byte3 << 8));
+    SREG = oldSREG;
+#else
+    (void)header;
+    (void)byte1;
+    (void)byte2;
+    (void)byte3;
+#endif
+  }
+
+  // Main loop only
+  static bool pop(TraceEvent& event);
+  static uint8_t pending();
+
+  // Stream events as SysEx to the given port (ROUTE_SRC_*) while idle
+  static void setStreaming(bool on, uint8_t port) { streaming = on; streamPort = port; }
+  static bool isStreaming() { return streaming; }
+  static uint8_t getStreamPort() { return streamPort; }
+
+  // Capture mode adds the raw DIN / USB input to the stream so a session can be
+  // replayed on the host (tools/trace_decode.py --capture, tools/replay.py)
+  static void setCapturing(bool on) { capturing = on; }
+  static bool isCapturing() { return capturing; }
+
+private:
+  static inline bool push(uint8_t id, uint8_t arg, uint16_t stamp) {
+    uint8_t next = (head + 1) & (TRACE_BUFFER_SIZE - 1);
+    if (next == tail) {
+      if (lost < 0xFF) lost++;
+      return false;
+    }
+    buffer[head].id = id;
+    buffer[head].arg = arg;
+    buffer[head].stamp = stamp;
+    head = next;
+    return true;
+  }
+
+  static TraceEvent buffer[TRACE_BUFFER_SIZE];
+  static volatile uint8_t head;
+  static volatile uint8_t tail;
+  static uint8_t lastEpoch;
+  static uint8_t lost;
+  static bool streaming;
+  static bool capturing;
+  static uint8_t streamPort;
+};
+
+#endif  // TRACE_H
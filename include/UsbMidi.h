@@ -0,0 +1,76 @@
+/**
+ * MIDI BytePulse - USB MIDI Device
+ * Class-compliant USB MIDI function exposing several virtual cables
+ */
+
+#ifndef USB_MIDI_H
+#define USB_MIDI_H
+
+#include <Arduino.h>
+#include <PluggableUSB.h>
+#include "config.h"
+
+// USB-MIDI event packet: header = cable number (high nibble) | code index (low nibble)
+typedef struct {
+  uint8_t header;
+  uint8_t byte1;
+  uint8_t byte2;
+  uint8_t byte3;
+} midiEventPacket_t;
+
+#define USB_MIDI_CABLE(header)  ((header) >> 4)
+#define USB_MIDI_CIN(header)    ((header) & 0x0F)
+#define USB_MIDI_HEADER(cable, cin)  ((uint8_t)(((cable) << 4) | (cin)))
+
+class UsbMidi : public PluggableUSBModule {
+public:
+  UsbMidi();
+
+  // Pulls up to maxPackets from the OUT endpoint in one transfer, returns the count
+  uint8_t readPackets(midiEventPacket_t* packets, uint8_t maxPackets);
+  void sendMIDI(const midiEventPacket_t& event);  // Queues or drops, never waits for the host
+  void flush();
+  bool hasRoomFor(uint8_t packets);  // Would be sent or queued without a drop
+
+  // Enumerated and not suspended
+  bool isHostReady() const { return hostReady; }
+
+  uint16_t getDroppedNoHost() const { return droppedNoHost; }
+  uint16_t getDroppedFull() const { return droppedFull; }
+  uint8_t getQueued() const { return queued(); }  // Packets waiting for room in the IN endpoint
+
+  // Receive profiling: largest batch seen and average CPU cycles spent per packet
+  void recordRxPass(uint8_t packets, uint16_t ticks);
+  uint8_t getRxMaxBatch() const { return rxMaxBatch; }
+  uint16_t getRxCyclesPerPacket() const { return rxCyclesPerPacket; }
+
+protected:
+  bool setup(USBSetup& setup);
+  int getInterface(uint8_t* interfaceCount);
+  int getDescriptor(USBSetup& setup);
+
+private:
+  uint8_t rxEndpoint() const { return pluggedEndpoint; }
+  uint8_t txEndpoint() const { return pluggedEndpoint + 1; }
+
+  bool pollHost();
+  void drainQueue();
+  uint8_t queued() const { return (uint8_t)(txHead - txTail) & (USB_TX_QUEUE_SIZE - 1); }
+
+  uint8_t epType[2];
+
+  midiEventPacket_t txQueue[USB_TX_QUEUE_SIZE];
+  uint8_t txHead = 0;
+  uint8_t txTail = 0;
+  unsigned long lastTxProgress = 0;
+  bool hostReady = false;
+  uint16_t droppedNoHost = 0;
+  uint16_t droppedFull = 0;
+
+  uint8_t rxMaxBatch = 0;
+  uint16_t rxCyclesPerPacket = 0;
+};
+
+extern UsbMidi usbMidi;
+
+#endif  // USB_MIDI_H
@@ -17,9 +17,36 @@
 #define DISPLAY_CLK_PIN       4   // Fixed 1 PPQN clock for TinyPulse Display (clock only, no MIDI)
 
 // Clock Sync Input (assumes 1 PPQN from external source)
-#define SYNC_IN_PIN           7
+#define SYNC_IN_PIN           7   // INT6, handled by ISR(INT6_vect) directly
 #define SYNC_IN_DETECT_PIN    6
 
+// Port bits of the pins above, for the INT6 handler (one sbi each instead of digitalWrite)
+#define SYNC_OUT_PORT         PORTC
+#define SYNC_OUT_BIT          PC6
+#define DISPLAY_CLK_PORT      PORTD
+#define DISPLAY_CLK_BIT       PD4
+
+// Analog output bank: DISPLAY_CLK and pins 2 / 3, all on PORTD, driven from one
+// phase count with one port write per clock (see AnalogOutputs.h).
+// Each output: mode, clocks per pulse (divides 96), pulse width, active low
+#define ANALOG_OUT_PORT       PORTD
+#define ANALOG_OUT_DDR        DDRD
+#define ANALOG_OUT_COUNT      3     // Bank entries, output 0 is DISPLAY_CLK
+#define ANALOG_OUT_1_PIN      2     // PD1
+#define ANALOG_OUT_1_BIT      PD1
+#define ANALOG_OUT_2_PIN      3     // PD0
+#define ANALOG_OUT_2_BIT      PD0
+
+#define DISPLAY_CLK_CONFIG    { DISPLAY_CLK_BIT, ANALOG_MODE_CLOCK, 24, 5000, false }  // 1 PPQN for TinyPulse
+#define ANALOG_OUT_1_CONFIG   { ANALOG_OUT_1_BIT, ANALOG_MODE_CLOCK, 6, 5000, false }  // 4 PPQN (16ths)
+#define ANALOG_OUT_2_CONFIG   { ANALOG_OUT_2_BIT, ANALOG_MODE_RUN, 0, 0, false }       // Run gate
+
+// Tempo and beat-in-bar burst after each DISPLAY_CLK pulse (DisplayCode.h), for
+// TinyPulse firmware that decodes it; older displays would count the marks as beats
+#ifndef DISPLAY_CODE
+#define DISPLAY_CODE          false
+#endif
+
 // Sync Rate Selector (1P5T rotary switch - controls BOTH SYNC_IN and SYNC_OUT)
 // Sets the PPQN rate for analog sync signals in both directions:
 //   SYNC_IN:  External clock → MIDI (multiply up to 24 PPQN)
@@ -31,6 +58,19 @@
 #define SYNC_RATE_PIN_4       14   // Position 4 = 6 PPQN
 #define SYNC_RATE_PIN_5       15   // Position 5 = 24 PPQN (MIDI passthrough)
 
+// All five contacts are on PORTB: one pin-change vector, debounced on Timer0 compare B (see Controls.h)
+#define SYNC_RATE_PIN_REG     PINB
+#define SYNC_RATE_BIT_1       PB5
+#define SYNC_RATE_BIT_2       PB6
+#define SYNC_RATE_BIT_3       PB2
+#define SYNC_RATE_BIT_4       PB3
+#define SYNC_RATE_BIT_5       PB1
+
+// Control pots on A0-A3 (ADC7 down to ADC4): tempo, swing, SYNC_OUT pulse width, spare.
+// Scanned by the ADC on every Timer0 overflow, one channel per conversion
+#define CONTROL_POTS          false   // Pots fitted (floating inputs would move the settings)
+#define CONTROL_POT_FIRST_ADC 7       // A0
+
 // LED
 #define LED_PULSE_PIN       8
 
@@ -39,10 +79,65 @@
 #define LED_PULSE_WIDTH_MS 50
 #define PPQN 24
 
+// Clock-lost timeout: CLOCK_LOST_TICKS / _MIN_MS / _MAX_MS in ClockArbiter.h
+// (pure header, also built by the native tests; override with -D)
+
+// MIDI DIN UART buffers (powers of two)
+#define DIN_RX_BUFFER_SIZE    256   // Serial1's size, kept until stress runs show less is safe; + 16-bit stamp each
+#define DIN_TX_BUFFER_SIZE    128
+#define DIN_RT_BUFFER_SIZE    8     // Realtime lane: clocks/transport bypass queued messages
+
+// DIN OUT bandwidth management (USB -> DIN)
+// Below this many free TX bytes (~20 ms of backlog at 31.25 kbaud) CC, pitch bend
+// and aftertouch are held in latest-value-wins slots instead of being queued
+#define DIN_CONGESTION_THRESHOLD  64
+#define COALESCE_SLOTS            16
+
+// USB MIDI virtual cables (separate ports on the host)
+#define USB_MIDI_CABLES       2
+#define USB_CABLE_DIN         0   // DIN MIDI IN traffic: notes, CC, SysEx
+#define USB_CABLE_CLOCK       1   // Clock and transport from the active clock source
+
+// USB MIDI transmit (never blocks the loop)
+#define USB_TX_QUEUE_SIZE     16    // Packets held while the IN endpoint is full (power of two)
+#define USB_TX_STALL_MS       100   // Host not reading for this long: queued packets are dropped
+
+// USB MIDI receive: packets dispatched per loop() pass (one 64-byte endpoint bank = 16)
+// so a DAW burst can't starve sync.update()
+#define USB_RX_PACKETS_PER_PASS  16
+
+// Event bus from the inputs to the outputs (EventBus.h): events of 6 bytes, power of two
+#define EVENT_BUS_SIZE        32
+
+// Deployment profile (full router, analog-only, USB-host-only), see Profile.h
+#include "Profile.h"
+
+// Song Position Pointer: sent on DIN ahead of a Continue forwarded from USB when
+// the USB -> DIN route filters SPP, so downstream units resume on the same 16th
+#define SYNC_SPP_TO_DIN     true
+
 // MIDI IN Forwarding
-#define FORWARD_MIDI_IN_TO_MIDI_OUT   true  // MIDI IN not forwarded to USB MIDI OUT (only mirrored to MIDI THRU PORT)
+#define FORWARD_MIDI_IN_TO_MIDI_OUT   true  // Default DIN IN -> DIN OUT (THRU) routes; runtime table in RouteTable
+
+// EEPROM layout
+#define EEPROM_ROUTES_ADDR    0     // Route table: magic, version, 96 bytes of masks, checksum (99 bytes)
+#define EEPROM_OSC_ADDR       100   // Oscillator correction: magic, ppm, checksum (4 bytes)
+
+// Loop-stall watchdog (post-mortem record published over SysEx after the reset)
+// Worst-case legitimate pass is a full route table EEPROM save (~340 ms)
+#define WATCHDOG_ENABLED    true
+#define WATCHDOG_TIMEOUT    WDTO_250MS  // First timeout saves the record, second one resets
+
+// Event tracer (binary ring buffer, drained over SysEx - see Trace.h)
+#define TRACE_ENABLED       true
+#define TRACE_BUFFER_SIZE   32    // Events of 4 bytes (power of two)
+
+// Cycle benchmark markers for the simavr build (pio run -e bench, see Bench.h)
+#ifndef CYCLE_BENCH
+#define CYCLE_BENCH         false
+#endif
 
-// Debug
+// Debug (blocking Serial prints - setup only; use the tracer for timing issues)
 #define SERIAL_DEBUG        false
 #define DEBUG_BAUD_RATE    115200
 
@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+"""
+Post-build script: static RAM budget per module and total flash, read from the linked ELF.
+Prints a table after every firmware build and writes ram_report.txt next to firmware.elf.
+"""
+import os
+import re
+import subprocess
+
+Import("env")
+
+RAM_SIZE = 2560  # ATmega32U4
+STACK_RESERVE = 512  # Warn when less than this is left for stack + heap
+
+def find_nm():
+    cc = env.subst("$CC")
+    nm = re.sub(r"gcc(\.exe)?$", r"nm\1", cc)
+    return nm if nm != cc else "avr-nm"
+
+def find_size():
+    cc = env.subst("$CC")
+    size = re.sub(r"gcc(\.exe)?$", r"size\1", cc)
+    return size if size != cc else "avr-size"
+
+def flash_used(elf):
+    # .text + .data (initializers live in flash), from "size -A"
+    output = subprocess.check_output([find_size(), "-A", elf], universal_newlines=True)
+    total = 0
+    for line in output.splitlines():
+        parts = line.split()
+        if len(parts) >= 2 and parts[0] in (".text", ".data"):
+            total += int(parts[1])
+    return total
+
+def module_of(name, location):
+    # Prefer the source file when the ELF carries line info
+    if location:
+        return os.path.basename(location.split(":")[0])
+    # Otherwise group by class / namespace, then by object name
+    name = name.split("(")[0]
+    if "::" in name:
+        return name.split("::")[0]
+    return name
+
+def ram_report(source, target, env):
+    elf = str(target[0])
+    try:
+        output = subprocess.check_output(
+            [find_nm(), "-C", "-S", "-l", "--size-sort", elf],
+            universal_newlines=True)
+    except (OSError, subprocess.CalledProcessError) as e:
+        print("RAM report skipped: %s" % e)
+        return
+
+    modules = {}
+    for line in output.splitlines():
+        # address size type name[\tfile:line]
+        parts = line.split(None, 3)
+        if len(parts) < 4 or parts[2] not in "bBdD":
+            continue
+        name, _, location = parts[3].partition("\t")
+        size = int(parts[1], 16)
+        module = module_of(name.strip(), location.strip())
+        total, symbols = modules.get(module, (0, []))
+        symbols.append((size, name.strip()))
+        modules[module] = (total + size, symbols)
+
+    used = sum(total for total, _ in modules.values())
+    lines = ["Static RAM by module (.data + .bss)", "-" * 56]
+    for module, (total, symbols) in sorted(modules.items(), key=lambda m: -m[1][0]):
+        lines.append("%5d  %s" % (total, module))
+        for size, name in sorted(symbols, reverse=True)[:4]:
+            lines.append("         %5d  %s" % (size, name))
+    lines.append("-" * 56)
+    lines.append("%5d  total of %d bytes, %d left for stack + heap" % (used, RAM_SIZE, RAM_SIZE - used))
+
+    # Profiles (Profile.h) differ mostly in flash, so it goes in the same report
+    try:
+        lines.append("%5d  bytes of flash (.text + .data), env %s" % (flash_used(elf), env.subst("$PIOENV")))
+    except (OSError, subprocess.CalledProcessError, ValueError) as e:
+        lines.append("flash size skipped: %s" % e)
+
+    report = "\n".join(lines)
+    print("\n" + report + "\n")
+    if RAM_SIZE - used < STACK_RESERVE:
+        print("⚠️  Warning: less than %d bytes of RAM left for the stack" % STACK_RESERVE)
+
+    with open(os.path.join(os.path.dirname(elf), "ram_report.txt"), "w") as f:
+        f.write(report + "\n")
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", ram_report)
@@ -0,0 +1,88 @@
+#include "Chain.h"
+#include "Sync.h"
+#include "SysExControl.h"
+#include "DinSerial.h"
+
+Sync* Chain::sync = nullptr;
+uint8_t Chain::state = CHAIN_STATE_IDLE;
+uint8_t Chain::seq = 0;
+uint8_t Chain::position = 0;
+uint8_t Chain::units = 0;
+uint16_t Chain::hopUs = 0;
+unsigned long Chain::pingEndUs = 0;
+unsigned long Chain::pingMillis = 0;
+unsigned long Chain::roundTripUs = 0;
+
+void Chain::begin(Sync* s) {
+  sync = s;
+}
+
+void Chain::calibrate() {
+  seq = (seq + 1) & 0x7F;
+  state = CHAIN_STATE_MEASURING;
+  position = 0;
+  units = 0;
+  hopUs = 0;
+  roundTripUs = 0;
+  if (sync) sync->setOutputDelayUs(0);
+
+  // The ping queues behind whatever DIN OUT still holds; its F7 leaves after all of it
+  uint8_t queued = (DIN_TX_BUFFER_SIZE - 1) - dinSerial.availableForWrite();
+  pingMillis = millis();
+  pingEndUs = micros() + (unsigned long)(queued + CHAIN_PING_BYTES) * CHAIN_DIN_BYTE_US;
+  SysExControl::sendChainPing(seq, 0);
+}
+
+void Chain::handlePing(uint8_t pingSeq, uint8_t hops) {
+  // getState() applies the timeout first: a ping back too late is no measurement
+  uint8_t current = getState();
+  if (current == CHAIN_STATE_NO_RING && pingSeq == seq) return;  // Ours, late: not passed on again
+
+  if (current == CHAIN_STATE_MEASURING && pingSeq == seq) {
+    // Our own ping is back: stamp of its F7 from the RX interrupt
+    roundTripUs = dinSerial.lastReadMicros() - pingEndUs;
+    units = hops + 1;
+    hopUs = chainHopLatencyUs(roundTripUs, hops);
+    position = 0;
+    state = CHAIN_STATE_DONE;
+    apply();
+
+    if (units > 1) SysExControl::sendChainResult(0, units, hopUs);
+    return;
+  }
+
+  if (hops + 1 < CHAIN_MAX_UNITS) {
+    SysExControl::sendChainPing(pingSeq, hops + 1);
+  }
+}
+
+void Chain::handleResult(uint8_t hops, uint8_t resultUnits, uint16_t resultHopUs) {
+  // The head sends position 0's result; the last unit doesn't pass it on
+  if (state == CHAIN_STATE_MEASURING || hops + 1 >= resultUnits) return;
+
+  position = hops + 1;
+  units = resultUnits;
+  hopUs = resultHopUs;
+  roundTripUs = 0;
+  state = CHAIN_STATE_DONE;
+  apply();
+
+  if (position + 1 < units) {
+    SysExControl::sendChainResult(position, units, hopUs);
+  }
+}
+
+uint8_t Chain::getState() {
+  if (state == CHAIN_STATE_MEASURING && millis() - pingMillis > CHAIN_PING_TIMEOUT_MS) {
+    state = CHAIN_STATE_NO_RING;
+  }
+  return state;
+}
+
+unsigned long Chain::getOutputDelayUs() {
+  return state == CHAIN_STATE_DONE ? chainOutputDelayUs(units, position, hopUs) : 0;
+}
+
+void Chain::apply() {
+  if (sync) sync->setOutputDelayUs(getOutputDelayUs());
+}
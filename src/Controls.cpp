@@ -0,0 +1,123 @@
+#include "Controls.h"
+#include "Sync.h"
+#include "config.h"
+
+#define CONTROL_SWITCH_MASK  ((1 << SYNC_RATE_BIT_1) | (1 << SYNC_RATE_BIT_2) | (1 << SYNC_RATE_BIT_3) | \
+                              (1 << SYNC_RATE_BIT_4) | (1 << SYNC_RATE_BIT_5))
+
+// Timer0 runs the core's millis() (clk/64, overflow every 1.024 ms); compare B is
+// free, and half a period away from the overflow that triggers the ADC
+#define CONTROL_TICK_COMPARE  0x80
+
+Sync* Controls::sync = nullptr;
+volatile uint8_t Controls::changed = 0;
+volatile uint8_t Controls::switchRate = SYNC_IN_2_PPQN;
+volatile uint8_t Controls::debounceTicks = 0;
+volatile uint8_t Controls::pots[CONTROL_POT_COUNT];
+uint8_t Controls::potChannel = 0;
+
+ISR(PCINT0_vect) {
+  Controls::switchEdge();
+}
+
+ISR(TIMER0_COMPB_vect) {
+  Controls::debounceTick();
+}
+
+ISR(ADC_vect) {
+  Controls::potConverted();
+}
+
+void Controls::begin(Sync* s) {
+  sync = s;
+
+  pinMode(SYNC_RATE_PIN_1, INPUT_PULLUP);
+  pinMode(SYNC_RATE_PIN_2, INPUT_PULLUP);
+  pinMode(SYNC_RATE_PIN_3, INPUT_PULLUP);
+  pinMode(SYNC_RATE_PIN_4, INPUT_PULLUP);
+  pinMode(SYNC_RATE_PIN_5, INPUT_PULLUP);
+
+  switchRate = controlSwitchRate(readSwitch(), SYNC_IN_2_PPQN);
+  if (sync) sync->setSyncRate((SyncInRate)switchRate);
+
+  OCR0B = CONTROL_TICK_COMPARE;
+  PCMSK0 |= CONTROL_SWITCH_MASK;
+  PCIFR = (1 << PCIF0);
+  PCICR |= (1 << PCIE0);
+
+  if (CONTROL_POTS) {
+    DIDR0 |= (1 << ADC4D) | (1 << ADC5D) | (1 << ADC6D) | (1 << ADC7D);  // No digital input buffers on the pots
+    potChannel = 0;
+    selectPot(0);
+    ADCSRB = (1 << ADTS2);   // Auto trigger: Timer0 overflow
+    // clk/128: a conversion takes 104 us, long done before the next trigger
+    ADCSRA = (1 << ADEN) | (1 << ADATE) | (1 << ADIE) | (1 << ADIF) | (1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0);
+  }
+}
+
+void Controls::update() {
+  if (!changed) return;
+
+  uint8_t oldSREG = SREG;
+  cli();
+  uint8_t what = changed;
+  changed = 0;
+  SREG = oldSREG;
+
+  if (!sync) return;
+  if (what & CONTROL_CHANGED_SWITCH) {
+    sync->setSyncRate((SyncInRate)switchRate);
+  }
+  if (what & CONTROL_CHANGED_POTS) {
+    sync->setSwing(pots[CONTROL_POT_SWING]);
+    sync->setPulseWidthUs(controlPulseWidthUs(pots[CONTROL_POT_WIDTH]));
+  }
+}
+
+void Controls::switchEdge() {
+  // Every bounce starts the count again; the contacts are read once they are still
+  debounceTicks = CONTROL_DEBOUNCE_TICKS;
+  TIFR0 = (1 << OCF0B);
+  TIMSK0 |= (1 << OCIE0B);
+}
+
+void Controls::debounceTick() {
+  if (--debounceTicks) return;
+  TIMSK0 &= ~(1 << OCIE0B);
+
+  uint8_t rate = controlSwitchRate(readSwitch(), switchRate);
+  if (rate != switchRate) {
+    switchRate = rate;
+    changed |= CONTROL_CHANGED_SWITCH;
+  }
+}
+
+void Controls::potConverted() {
+  uint8_t reading = ADCH;   // Left adjusted: the top 8 bits are plenty for a pot
+  uint8_t pot = potChannel;
+  if (controlPotMoved(pots[pot], reading)) {
+    pots[pot] = reading;
+    changed |= CONTROL_CHANGED_POTS;
+  }
+
+  // The next trigger is ~1 ms away, so the new channel is set well before it
+  potChannel = (pot + 1) & (CONTROL_POT_COUNT - 1);
+  selectPot(potChannel);
+}
+
+// Closed contacts read low
+uint8_t Controls::readSwitch() {
+  uint8_t pins = ~SYNC_RATE_PIN_REG;
+  uint8_t closed = 0;
+  if (pins & (1 << SYNC_RATE_BIT_1)) closed |= 0x01;
+  if (pins & (1 << SYNC_RATE_BIT_2)) closed |= 0x02;
+  if (pins & (1 << SYNC_RATE_BIT_3)) closed |= 0x04;
+  if (pins & (1 << SYNC_RATE_BIT_4)) closed |= 0x08;
+  if (pins & (1 << SYNC_RATE_BIT_5)) closed |= 0x10;
+  return closed;
+}
+
+// AVcc reference, left adjusted; A0..A3 are ADC7..ADC4 (MUX5 clear)
+void Controls::selectPot(uint8_t pot) {
+  ADMUX = (1 << REFS0) | (1 << ADLAR) | (CONTROL_POT_FIRST_ADC - pot);
+}
@@ -0,0 +1,141 @@
+#include "Diagnostics.h"
+#include "Sync.h"
+#include "Timebase.h"
+#include <avr/wdt.h>
+
+#define STALL_RECORD_MAGIC  0x5717
+#define LOOP_WRAP_MS        250     // Below one Timer1 wrap (262 ms), with margin for millis() steps
+
+// Survives the watchdog reset: not cleared by the C runtime, not painted (lies below _end)
+static StallRecord stallRecord __attribute__((section(".noinit")));
+
+const Sync* Diagnostics::watched = nullptr;
+StallRecord Diagnostics::lastStall;
+bool Diagnostics::stallValid = false;
+uint16_t Diagnostics::lastLoopStamp = 0;
+unsigned long Diagnostics::lastLoopMillis = 0;
+uint32_t Diagnostics::maxLoopUs = 0;
+
+ISR(WDT_vect) {
+  Diagnostics::watchdogIrq();
+}
+
+#ifdef __AVR__
+// Linker / avr-libc symbols
+extern uint8_t __data_start;
+extern uint8_t __bss_end;
+extern uint8_t __heap_start;
+extern uint8_t _end;
+extern uint8_t __stack;
+extern char* __brkval;
+
+// Runs from .init1, before the stack pointer and r1 are set up, so it must not
+// touch the stack or rely on compiler conventions - hence plain assembly.
+// Fills everything between the end of .bss and the top of RAM with the canary.
+void paintStack() __attribute__((naked, used, section(".init1")));
+
+void paintStack() {
+  __asm volatile (
+    "    ldi r30, lo8(_end)       \n"
+    "    ldi r31, hi8(_end)       \n"
+    "    ldi r24, %0              \n"
+    "    ldi r25, hi8(__stack)    \n"
+    "    rjmp 2f                  \n"
+    "1:  st Z+, r24               \n"
+    "2:  cpi r30, lo8(__stack)    \n"
+    "    cpc r31, r25             \n"
+    "    brlo 1b                  \n"
+    "    breq 1b                  \n"
+    :: "M" (STACK_CANARY)
+  );
+}
+
+static uint8_t* heapTop() {
+  return __brkval ? (uint8_t*)__brkval : &__heap_start;
+}
+
+uint16_t Diagnostics::freeRam() {
+  return SP - (uintptr_t)heapTop();
+}
+
+uint16_t Diagnostics::stackHighWater() {
+  // The stack grows down, so the first byte that lost its canary marks the deepest point
+  const uint8_t* p = heapTop();
+  while (p <= &__stack && *p == STACK_CANARY) {
+    p++;
+  }
+  return &__stack - p + 1;
+}
+
+uint16_t Diagnostics::staticRam() {
+  return &__bss_end - &__data_start;
+}
+#else
+// Host replay build (host/): no AVR memory layout to inspect
+uint16_t Diagnostics::freeRam() { return 0; }
+uint16_t Diagnostics::stackHighWater() { return 0; }
+uint16_t Diagnostics::staticRam() { return 0; }
+#endif
+
+void Diagnostics::begin(const Sync* sync) {
+  watched = sync;
+  
+  // The bootloader clears MCUSR, so the magic word is the only reliable reset cause
+  if (stallRecord.magic == STALL_RECORD_MAGIC) {
+    lastStall = stallRecord;
+    stallValid = true;
+  }
+  stallRecord.magic = 0;
+  
+  #if WATCHDOG_ENABLED
+  armWatchdog();
+  #endif
+}
+
+void Diagnostics::armWatchdog() {
+  // Interrupt-then-reset mode: the first timeout runs WDT_vect, the second one resets
+  uint8_t oldSREG = SREG;
+  cli();
+  wdt_reset();
+  WDTCSR = (1 << WDCE) | (1 << WDE);
+  WDTCSR = (1 << WDIE) | (1 << WDE) | ((WATCHDOG_TIMEOUT & 0x08) << 2) | (WATCHDOG_TIMEOUT & 0x07);
+  SREG = oldSREG;
+}
+
+void Diagnostics::loopTick() {
+  uint16_t now = Timebase::now();
+  unsigned long nowMs = millis();
+  if (lastLoopStamp != 0) {
+    // Timer1 stamps wrap every 262 ms; a pass that long is timed in millis
+    unsigned long elapsedMs = nowMs - lastLoopMillis;
+    uint32_t elapsedUs = elapsedMs >= LOOP_WRAP_MS ? elapsedMs * 1000UL
+                                                   : (uint32_t)(uint16_t)(now - lastLoopStamp) * TIMEBASE_US_PER_TICK;
+    if (elapsedUs > maxLoopUs) maxLoopUs = elapsedUs;
+  }
+  lastLoopStamp = now;
+  lastLoopMillis = nowMs;
+  
+  #if WATCHDOG_ENABLED
+  // The USB core re-arms the watchdog without WDIE for the 1200-baud bootloader
+  // reset; stop feeding it then so uploads still work
+  if (WDTCSR & (1 << WDIE)) {
+    wdt_reset();
+  }
+  #endif
+}
+
+uint32_t Diagnostics::getMaxLoopUs() {
+  return maxLoopUs;
+}
+
+void Diagnostics::watchdogIrq() {
+  stallRecord.stage = GPIOR0;
+  stallRecord.clockSource = watched ? watched->getActiveSource() : CLOCK_SOURCE_NONE;
+  stallRecord.maxLoopUs = getMaxLoopUs();
+  stallRecord.stallMillis = millis();
+  stallRecord.lastDINClock = watched ? watched->getLastClockMillis(CLOCK_SOURCE_DIN) : 0;
+  stallRecord.lastUSBClock = watched ? watched->getLastClockMillis(CLOCK_SOURCE_USB) : 0;
+  stallRecord.lastSyncIn = watched ? watched->getLastClockMillis(CLOCK_SOURCE_SYNC_IN) : 0;
+  stallRecord.magic = STALL_RECORD_MAGIC;
+  // WDIE is now cleared by hardware; the next timeout resets the chip
+}
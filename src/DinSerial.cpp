@@ -0,0 +1,144 @@
+#include "DinSerial.h"
+#include "Timebase.h"
+#include "Trace.h"
+#include "Bench.h"
+
+#if (DIN_RX_BUFFER_SIZE & (DIN_RX_BUFFER_SIZE - 1)) || (DIN_TX_BUFFER_SIZE & (DIN_TX_BUFFER_SIZE - 1)) || \
+    (DIN_RT_BUFFER_SIZE & (DIN_RT_BUFFER_SIZE - 1))
+#error "DIN UART buffer sizes must be powers of two"
+#endif
+#if DIN_RX_BUFFER_SIZE > 256 || DIN_TX_BUFFER_SIZE > 256
+#error "DIN UART buffers are indexed with 8 bits"
+#endif
+
+#define RX_MASK (DIN_RX_BUFFER_SIZE - 1)
+#define TX_MASK (DIN_TX_BUFFER_SIZE - 1)
+#define RT_MASK (DIN_RT_BUFFER_SIZE - 1)
+
+DinSerial dinSerial;
+
+#if PROFILE_HAS_DIN
+ISR(USART1_RX_vect) {
+  BENCH_SCOPE(BENCH_DIN_RX_ISR);
+  dinSerial.rxCompleteIrq();
+}
+
+ISR(USART1_UDRE_vect) {
+  BENCH_SCOPE(BENCH_DIN_UDRE_ISR);
+  dinSerial.txUdrEmptyIrq();
+}
+#endif
+
+void DinSerial::begin(unsigned long baud) {
+  // Double-speed mode, same rounding as the Arduino core (31250 baud is exact at 16 MHz)
+  UCSR1A = (1 << U2X1);
+  UBRR1 = (F_CPU / 4 / baud - 1) / 2;
+  UCSR1C = (1 << UCSZ11) | (1 << UCSZ10);  // 8N1
+  UCSR1B = (1 << RXEN1) | (1 << TXEN1) | (1 << RXCIE1);
+}
+
+void DinSerial::rxCompleteIrq() {
+  // Stamp first so the timestamp is as close to the stop bit as possible
+  uint16_t stamp = Timebase::now();
+  uint8_t c = UDR1;
+  if (Trace::isCapturing()) Trace::record(TRACE_EV_DIN_RX, c);
+
+  uint8_t next = (rxHead + 1) & RX_MASK;
+  if (next == rxTail) {
+    rxOverflows++;
+    Trace::record(TRACE_EV_OVERFLOW, TRACE_BUF_DIN_RX);
+    return;
+  }
+
+  rxBytes[rxHead] = c;
+  rxStamps[rxHead] = stamp;
+  rxHead = next;
+}
+
+void DinSerial::txUdrEmptyIrq() {
+  if (rtHead != rtTail) {
+    UDR1 = rtBuffer[rtTail];
+    rtTail = (rtTail + 1) & RT_MASK;
+  } else {
+    UDR1 = txBuffer[txTail];
+    txTail = (txTail + 1) & TX_MASK;
+  }
+
+  if (txHead == txTail && rtHead == rtTail) {
+    UCSR1B &= ~(1 << UDRIE1);
+  }
+}
+
+int DinSerial::available() {
+  return (uint8_t)(rxHead - rxTail) & RX_MASK;
+}
+
+int DinSerial::read() {
+  if (rxHead == rxTail) return -1;
+
+  uint8_t c = rxBytes[rxTail];
+  lastStamp = rxStamps[rxTail];
+  rxTail = (rxTail + 1) & RX_MASK;
+  return c;
+}
+
+unsigned long DinSerial::lastReadMicros() const {
+  return Timebase::toMicros(lastStamp);
+}
+
+uint8_t DinSerial::availableForWrite() const {
+  return (DIN_TX_BUFFER_SIZE - 1) - ((uint8_t)(txHead - txTail) & TX_MASK);
+}
+
+size_t DinSerial::write(uint8_t b) {
+  uint8_t oldSREG = SREG;
+  cli();
+  // Line idle and nothing queued: skip the buffers entirely
+  if (txHead == txTail && rtHead == rtTail && (UCSR1A & (1 << UDRE1))) {
+    UDR1 = b;
+    SREG = oldSREG;
+    return 1;
+  }
+  SREG = oldSREG;
+
+  if (b >= 0xF8) {
+    return enqueue(rtBuffer, rtHead, rtTail, RT_MASK, b);
+  }
+  return enqueue(txBuffer, txHead, txTail, TX_MASK, b);
+}
+
+size_t DinSerial::writeInOrder(uint8_t b) {
+  uint8_t oldSREG = SREG;
+  cli();
+  if (txHead == txTail && rtHead == rtTail && (UCSR1A & (1 << UDRE1))) {
+    UDR1 = b;
+    SREG = oldSREG;
+    return 1;
+  }
+  SREG = oldSREG;
+  
+  return enqueue(txBuffer, txHead, txTail, TX_MASK, b);
+}
+
+// The slot is claimed and filled with interrupts off: the INT6 handler writes
+// realtime bytes too and must not land in the slot the main loop is filling
+size_t DinSerial::enqueue(uint8_t* buffer, volatile uint8_t& head, volatile uint8_t& tail, uint8_t mask, uint8_t b) {
+  for (;;) {
+    uint8_t oldSREG = SREG;
+    cli();
+    uint8_t next = (head + 1) & mask;
+    if (next != tail) {
+      buffer[head] = b;
+      head = next;
+      UCSR1B |= (1 << UDRIE1);
+      SREG = oldSREG;
+      return 1;
+    }
+    SREG = oldSREG;
+    
+    // Buffer full - if interrupts are off the UDRE vector can't run, so drain by polling
+    if (bit_is_clear(SREG, SREG_I) && (UCSR1A & (1 << UDRE1))) {
+      txUdrEmptyIrq();
+    }
+  }
+}
@@ -0,0 +1,66 @@
+#include "DisplayBurst.h"
+#include "Timebase.h"
+#include "config.h"
+
+#define US_TO_TICKS(us)  ((us) / TIMEBASE_US_PER_TICK)
+
+uint8_t DisplayBurst::portBit = 0;
+bool DisplayBurst::inverted = false;
+volatile bool DisplayBurst::sending = false;
+uint16_t DisplayBurst::frame = 0;
+uint8_t DisplayBurst::bitsLeft = 0;
+bool DisplayBurst::inMark = false;
+
+ISR(TIMER1_COMPA_vect) {
+  DisplayBurst::compareMatch();
+}
+
+void DisplayBurst::begin(uint8_t bit, bool invert) {
+  portBit = 1 << bit;
+  inverted = invert;
+}
+
+void DisplayBurst::send(uint16_t value) {
+  if (sending) return;
+  frame = value;
+  bitsLeft = DISPLAY_CODE_BITS;
+  inMark = false;
+  
+  uint8_t oldSREG = SREG;
+  cli();
+  sending = true;
+  OCR1A = TCNT1 + US_TO_TICKS(DISPLAY_CODE_LEAD_US);
+  TIFR1 = (1 << OCF1A);
+  TIMSK1 |= (1 << OCIE1A);
+  SREG = oldSREG;
+}
+
+// Each compare schedules the next from the previous one, so marks don't drift
+void DisplayBurst::compareMatch() {
+  if (inMark) {
+    drive(false);
+    inMark = false;
+    bitsLeft--;
+    OCR1A += US_TO_TICKS(DISPLAY_CODE_SPACE_US);
+    return;
+  }
+  
+  if (bitsLeft == 0) {
+    TIMSK1 &= ~(1 << OCIE1A);
+    sending = false;
+    return;
+  }
+  
+  bool one = (frame >> (bitsLeft - 1)) & 1;
+  drive(true);
+  inMark = true;
+  OCR1A += one ? US_TO_TICKS(DISPLAY_CODE_ONE_US) : US_TO_TICKS(DISPLAY_CODE_ZERO_US);
+}
+
+void DisplayBurst::drive(bool active) {
+  if (active != inverted) {
+    ANALOG_OUT_PORT |= portBit;
+  } else {
+    ANALOG_OUT_PORT &= ~portBit;
+  }
+}
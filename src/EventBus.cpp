@@ -0,0 +1,12 @@
+#include "config.h"
+#include "EventBus.h"
+
+EventBus eventBus;
+
+bool EventBus::post(const BusEvent& event) {
+  uint8_t oldSREG = SREG;
+  cli();
+  bool pushed = push(event);
+  SREG = oldSREG;
+  return pushed;
+}
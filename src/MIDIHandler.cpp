@@ -0,0 +1,398 @@
+#include "MIDIHandler.h"
+#include "Sync.h"
+#include "DinSerial.h"
+#include "RouteTable.h"
+#include "SysExControl.h"
+#include "Bench.h"
+#include "Timebase.h"
+#include "LoopGuard.h"
+#include "Trace.h"
+#include <MIDI.h>
+
+#if PROFILE_HAS_DIN
+MIDI_CREATE_INSTANCE(DinSerial, dinSerial, MIDI_DIN);
+#else
+extern midi::MidiInterface<midi::SerialMIDI<DinSerial>> MIDI_DIN;  // Only named in Profile::din branches
+#endif
+
+Sync* MIDIHandler::sync = nullptr;
+CoalesceQueue MIDIHandler::dinPending;
+uint8_t MIDIHandler::loopFlags = 0;
+LoopGuard loopGuard;
+
+void MIDIHandler::sendMessage(const midiEventPacket_t& event) {
+  usbMidi.sendMIDI(event);
+}
+
+void MIDIHandler::flushBuffer() {
+  usbMidi.flush();
+}
+
+void MIDIHandler::begin() {
+  routeTable.load();
+  if (!Profile::din) return;
+  
+  MIDI_DIN.begin(MIDI_CHANNEL_OMNI);
+  // THRU is done by the route table (DIN -> DIN), not by the library
+  MIDI_DIN.turnThruOff();
+  #if SERIAL_DEBUG
+  DEBUG_PRINTLN("MIDI DIN initialized on USART1");
+  DEBUG_PRINTLN("Listening on all channels (OMNI mode)");
+  #endif
+  
+  MIDI_DIN.setHandleNoteOn(handleNoteOn);
+  MIDI_DIN.setHandleNoteOff(handleNoteOff);
+  MIDI_DIN.setHandleAfterTouchPoly(handleAfterTouchPoly);
+  MIDI_DIN.setHandleControlChange(handleControlChange);
+  MIDI_DIN.setHandleProgramChange(handleProgramChange);
+  MIDI_DIN.setHandleAfterTouchChannel(handleAfterTouchChannel);
+  MIDI_DIN.setHandlePitchBend(handlePitchBend);
+  MIDI_DIN.setHandleSystemExclusive(handleSystemExclusive);
+  MIDI_DIN.setHandleTimeCodeQuarterFrame(handleTimeCodeQuarterFrame);
+  MIDI_DIN.setHandleSongPosition(handleSongPosition);
+  MIDI_DIN.setHandleSongSelect(handleSongSelect);
+  MIDI_DIN.setHandleTuneRequest(handleTuneRequest);
+  MIDI_DIN.setHandleClock(handleClock);
+  MIDI_DIN.setHandleStart(handleStart);
+  MIDI_DIN.setHandleContinue(handleContinue);
+  MIDI_DIN.setHandleStop(handleStop);
+  MIDI_DIN.setHandleActiveSensing(handleActiveSensing);
+  MIDI_DIN.setHandleSystemReset(handleSystemReset);
+}
+
+void MIDIHandler::update() {
+  if (Profile::din) MIDI_DIN.read();
+}
+
+void MIDIHandler::setSync(Sync* s) {
+  sync = s;
+}
+
+void MIDIHandler::dispatch() {
+  BusEvent event;
+  
+  while (eventBus.pop(event)) {
+    uint8_t port = BUS_PORT(event.header);
+    eventBus.recordLatency(port, Timebase::now() - event.stamp);
+    
+    // Our own output coming back: dropped before it is forwarded or clocks Sync
+    if (port != BUS_PORT_SYNC && isEcho(port, event)) continue;
+    
+    switch (port) {
+      case BUS_PORT_DIN:
+        routeFromDIN(event);
+        break;
+      case BUS_PORT_USB:
+        routeFromUSB(event);
+        break;
+      case BUS_PORT_SYNC:
+        if (sync) sync->handleSyncInEvent(event.stamp, event.byte2);
+        break;
+    }
+  }
+  
+  if (Profile::din) drainPendingToDIN();
+}
+
+// Messages are compared as a parser delivers them: bytes past the message length are 0
+static void normalize(const BusEvent& event, uint8_t& byte2, uint8_t& byte3) {
+  uint8_t length = busEventLength(BUS_CIN(event.header));
+  byte2 = length > 1 ? event.byte2 : 0;
+  byte3 = length > 2 ? event.byte3 : 0;
+}
+
+bool MIDIHandler::isEcho(uint8_t port, const BusEvent& event) {
+  if (busIsSysEx(BUS_CIN(event.header), event.byte1)) return false;
+  
+  uint8_t byte2, byte3;
+  normalize(event, byte2, byte3);
+  unsigned long nowMs = millis();
+  bool echo = loopGuard.isEcho(port, event.byte1, byte2, byte3, event.stamp, nowMs);
+  
+  uint8_t flags = loopGuard.getFlags(nowMs);
+  if (flags != loopFlags) {
+    loopFlags = flags;
+    Trace::record(TRACE_EV_LOOP, flags);
+  }
+  return echo;
+}
+
+void MIDIHandler::guardSent(uint8_t port, const BusEvent& event) {
+  uint8_t byte2, byte3;
+  normalize(event, byte2, byte3);
+  loopGuard.sent(port, event.byte1, byte2, byte3, Timebase::now(), millis());
+}
+
+// The one conversion on the DIN side: parser callback arguments to a bus event
+void MIDIHandler::postFromDIN(byte status, byte data1, byte data2) {
+  BusEvent event = {BUS_HEADER(BUS_PORT_DIN, busCodeIndex(status)), status, data1, data2, dinSerial.lastReadStamp()};
+  eventBus.post(event);
+}
+
+void MIDIHandler::routeFromDIN(const BusEvent& event) {
+  byte status = event.byte1;
+  bool transport = status == midi::Clock || status == midi::Start || status == midi::Continue || status == midi::Stop;
+  
+  if (routeTable.allows(ROUTE_SRC_DIN, ROUTE_DST_USB, status)) {
+    forwardDINtoUSB(event, transport ? USB_CABLE_CLOCK : USB_CABLE_DIN);
+  }
+  
+  // Clock and transport only pass THRU while arbitration lets DIN drive the outputs
+  if (routeTable.allows(ROUTE_SRC_DIN, ROUTE_DST_DIN, status) &&
+      !(transport && (!sync || !sync->accepts(CLOCK_SOURCE_DIN)))) {
+    sendEventToDIN(event);
+    // Realtime THRU isn't remembered: the master's next clock can come within the echo window
+    if (status < 0xF8) guardSent(BUS_PORT_DIN, event);
+  }
+  
+  if (!sync) return;
+  switch (status) {
+    case midi::Clock:
+      // Stamped on the UART when its byte arrived
+      sync->handleClock(CLOCK_SOURCE_DIN, Timebase::toMicros(event.stamp));
+      break;
+    case midi::Start:
+      sync->handleStart(CLOCK_SOURCE_DIN);
+      break;
+    case midi::Continue:
+      sync->handleContinue(CLOCK_SOURCE_DIN);
+      break;
+    case midi::Stop:
+      sync->handleStop(CLOCK_SOURCE_DIN);
+      break;
+    case midi::SongPosition:
+      sync->handleSongPosition(CLOCK_SOURCE_DIN, event.byte2 | (event.byte3 << 7));
+      break;
+  }
+}
+
+void MIDIHandler::routeFromUSB(const BusEvent& event) {
+  forwardUSBtoDIN(event);
+  
+  if (!sync) return;
+  
+  // Song position and transport are accepted on any cable
+  uint8_t cin = BUS_CIN(event.header);
+  if (cin == 0x03 && event.byte1 == midi::SongPosition) {
+    sync->handleSongPosition(CLOCK_SOURCE_USB, event.byte2 | (event.byte3 << 7));
+  }
+  if (cin == 0x0F) {
+    switch (event.byte1) {
+      case midi::Clock:
+        sync->handleClock(CLOCK_SOURCE_USB, Timebase::toMicros(event.stamp));
+        break;
+      case midi::Start:
+        sync->handleStart(CLOCK_SOURCE_USB);
+        break;
+      case midi::Continue:
+        sync->handleContinue(CLOCK_SOURCE_USB);
+        break;
+      case midi::Stop:
+        sync->handleStop(CLOCK_SOURCE_USB);
+        break;
+    }
+  }
+}
+
+// Bus events are USB-MIDI packets already: only the cable is filled in
+void MIDIHandler::forwardDINtoUSB(const BusEvent& event, uint8_t cable) {
+  BENCH_SCOPE(BENCH_DIN_TO_USB);
+  midiEventPacket_t packet = {USB_MIDI_HEADER(cable, BUS_CIN(event.header)), event.byte1, event.byte2, event.byte3};
+  sendMessage(packet);
+  guardSent(BUS_PORT_USB, event);
+}
+
+// Wire bytes straight from the event, no trip through the library
+void MIDIHandler::sendEventToDIN(const BusEvent& event) {
+  uint8_t length = busEventLength(BUS_CIN(event.header));
+  dinSerial.write(event.byte1);
+  if (length > 1) dinSerial.write(event.byte2);
+  if (length > 2) dinSerial.write(event.byte3);
+}
+
+void MIDIHandler::sendSysExToUSB(const byte* data, unsigned size) {
+  midiEventPacket_t event;
+  event.header = USB_MIDI_HEADER(USB_CABLE_DIN, 0x04);
+  
+  for (unsigned i = 0; i < size; i += 3) {
+    event.byte1 = (i < size) ? data[i] : 0;
+    event.byte2 = (i + 1 < size) ? data[i + 1] : 0;
+    event.byte3 = (i + 2 < size) ? data[i + 2] : 0;
+    
+    if (i + 3 >= size) {
+      if (i + 1 >= size) event.header = USB_MIDI_HEADER(USB_CABLE_DIN, 0x05);
+      else if (i + 2 >= size) event.header = USB_MIDI_HEADER(USB_CABLE_DIN, 0x06);
+      else event.header = USB_MIDI_HEADER(USB_CABLE_DIN, 0x07);
+    }
+    
+    sendMessage(event);
+  }
+  usbMidi.flush();
+}
+
+void MIDIHandler::forwardUSBSysEx(const BusEvent& event) {
+  midiEventPacket_t packet = {event.header, event.byte1, event.byte2, event.byte3};
+  SysExControl::feedUSBPacket(packet);
+  
+  if (!Profile::din || !routeTable.allows(ROUTE_SRC_USB, ROUTE_DST_DIN, midi::SystemExclusive)) return;
+  
+  // Code index 5/6/7 ends the message with 1/2/3 bytes, 4 carries 3 bytes.
+  // Straight to the UART, not through dinPending: SysEx can go out ahead of
+  // controllers still parked there
+  sendEventToDIN(event);
+}
+
+void MIDIHandler::forwardUSBtoDIN(const BusEvent& event) {
+  BENCH_SCOPE(BENCH_USB_TO_DIN);
+  uint8_t cin = BUS_CIN(event.header);
+  
+  if (busIsSysEx(cin, event.byte1)) {
+    forwardUSBSysEx(event);
+    return;
+  }
+  
+  byte status = event.byte1;
+  
+  if (!Profile::din || !routeTable.allows(ROUTE_SRC_USB, ROUTE_DST_DIN, status)) return;
+  
+  if (status < 0xF0) {
+    // While anything is parked new values park behind it
+    bool congested = !dinPending.isEmpty() || dinSerial.availableForWrite() < DIN_CONGESTION_THRESHOLD;
+    if (dinPending.offer(status, event.byte2, event.byte3, congested)) return;
+    
+    // Not absorbed (note, switch, or slots full): what this channel has
+    // parked goes out first, so a note never sounds at the old bend
+    flushPendingChannel(status & 0x0F);
+    sendChannelToDIN(status, event.byte2, event.byte3);
+    guardSent(BUS_PORT_DIN, event);
+    return;
+  }
+  
+  // Clock and transport are forwarded by Sync after source arbitration
+  if (status == 0xFE || status == 0xFF || status == 0xF1 || status == 0xF2 || status == 0xF3 || status == 0xF6) {
+    sendEventToDIN(event);
+    guardSent(BUS_PORT_DIN, event);
+  }
+}
+
+void MIDIHandler::sendChannelToDIN(byte status, byte data1, byte data2) {
+  // USB packets already carry wire bytes, no need to go through the library
+  dinSerial.write(status);
+  dinSerial.write(data1);
+  
+  byte type = status & 0xF0;
+  if (type != 0xC0 && type != 0xD0) {
+    dinSerial.write(data2);
+  }
+}
+
+void MIDIHandler::flushPendingChannel(uint8_t channel) {
+  byte status, data1, data2;
+  
+  while (dinPending.popChannel(channel, status, data1, data2)) {
+    sendParkedToDIN(status, data1, data2);
+  }
+}
+
+void MIDIHandler::drainPendingToDIN() {
+  byte status, data1, data2;
+  
+  while (!dinPending.isEmpty() && dinSerial.availableForWrite() >= DIN_CONGESTION_THRESHOLD) {
+    dinPending.pop(status, data1, data2);
+    sendParkedToDIN(status, data1, data2);
+  }
+}
+
+void MIDIHandler::sendParkedToDIN(byte status, byte data1, byte data2) {
+  sendChannelToDIN(status, data1, data2);
+  
+  // Remembered when it actually goes out, not when it was parked
+  BusEvent event = {BUS_HEADER(BUS_PORT_USB, busCodeIndex(status)), status, data1, data2, 0};
+  guardSent(BUS_PORT_DIN, event);
+}
+
+void MIDIHandler::handleNoteOn(byte channel, byte note, byte velocity) {
+  postFromDIN(0x90 | (channel - 1), note, velocity);
+}
+
+void MIDIHandler::handleNoteOff(byte channel, byte note, byte velocity) {
+  postFromDIN(0x80 | (channel - 1), note, velocity);
+}
+
+void MIDIHandler::handleAfterTouchPoly(byte channel, byte note, byte pressure) {
+  postFromDIN(0xA0 | (channel - 1), note, pressure);
+}
+
+void MIDIHandler::handleControlChange(byte channel, byte controller, byte value) {
+  postFromDIN(0xB0 | (channel - 1), controller, value);
+}
+
+void MIDIHandler::handleProgramChange(byte channel, byte program) {
+  postFromDIN(0xC0 | (channel - 1), program, 0);
+}
+
+void MIDIHandler::handleAfterTouchChannel(byte channel, byte pressure) {
+  postFromDIN(0xD0 | (channel - 1), pressure, 0);
+}
+
+void MIDIHandler::handlePitchBend(byte channel, int bend) {
+  // The library reports bend centred on 0 (-8192..8191); the wire value is centred on 8192
+  unsigned value = bend + 8192;
+  byte lsb = value & 0x7F;
+  byte msb = (value >> 7) & 0x7F;
+  postFromDIN(0xE0 | (channel - 1), lsb, msb);
+}
+
+void MIDIHandler::handleSystemExclusive(byte* data, unsigned size) {
+  // Messages addressed to this unit are consumed, not forwarded
+  if (SysExControl::handleMessage(data, size, ROUTE_SRC_DIN)) return;
+  
+  if (routeTable.allows(ROUTE_SRC_DIN, ROUTE_DST_USB, midi::SystemExclusive)) {
+    sendSysExToUSB(data, size);
+  }
+  
+  // Bypasses dinPending like USB SysEx (forwardUSBSysEx): parked controllers may follow it
+  if (Profile::din && routeTable.allows(ROUTE_SRC_DIN, ROUTE_DST_DIN, midi::SystemExclusive)) {
+    MIDI_DIN.sendSysEx(size, data, true);
+  }
+}
+
+void MIDIHandler::handleTimeCodeQuarterFrame(byte data) {
+  postFromDIN(midi::TimeCodeQuarterFrame, data, 0);
+}
+
+void MIDIHandler::handleSongPosition(unsigned beats) {
+  postFromDIN(midi::SongPosition, beats & 0x7F, (beats >> 7) & 0x7F);
+}
+
+void MIDIHandler::handleSongSelect(byte song) {
+  postFromDIN(midi::SongSelect, song, 0);
+}
+
+void MIDIHandler::handleTuneRequest() {
+  postFromDIN(midi::TuneRequest, 0, 0);
+}
+
+void MIDIHandler::handleClock() {
+  postFromDIN(midi::Clock, 0, 0);
+}
+
+void MIDIHandler::handleStart() {
+  postFromDIN(midi::Start, 0, 0);
+}
+
+void MIDIHandler::handleContinue() {
+  postFromDIN(midi::Continue, 0, 0);
+}
+
+void MIDIHandler::handleStop() {
+  postFromDIN(midi::Stop, 0, 0);
+}
+
+void MIDIHandler::handleActiveSensing() {
+  postFromDIN(midi::ActiveSensing, 0, 0);
+}
+
+void MIDIHandler::handleSystemReset() {
+  postFromDIN(midi::SystemReset, 0, 0);
+}
@@ -0,0 +1,123 @@
+#include "Oscillator.h"
+#include "Sync.h"
+#include "UsbMidi.h"
+#include "config.h"
+#include <EEPROM.h>
+
+#define OSC_MAGIC       0xD7
+
+// Stored as: magic, ppm low, ppm high, checksum
+#define OSC_CHECKSUM_ADDR  (EEPROM_OSC_ADDR + 3)
+
+Sync* Oscillator::sync = nullptr;
+uint8_t Oscillator::state = OSC_STATE_NONE;
+int16_t Oscillator::ppm = 0;
+int16_t Oscillator::storedPpm = 0;
+int16_t Oscillator::lastWindowPpm = 0;
+uint16_t Oscillator::windows = 0;
+uint16_t Oscillator::rejected = 0;
+bool Oscillator::savePending = false;
+bool Oscillator::sampled = false;
+bool Oscillator::windowOpen = false;
+uint16_t Oscillator::lastFrame = 0;
+unsigned long Oscillator::lastSampleUs = 0;
+uint16_t Oscillator::windowFrames = 0;
+unsigned long Oscillator::windowStartUs = 0;
+
+void Oscillator::begin(Sync* s) {
+  sync = s;
+  load();
+  if (sync) sync->setDriftPpm(ppm);
+}
+
+void Oscillator::update() {
+  if (!usbMidi.isHostReady()) {
+    // No SOFs while detached or suspended: the window would span a gap
+    sampled = false;
+    windowOpen = false;
+  } else {
+    uint8_t oldSREG = SREG;
+    cli();
+    uint16_t frame = UDFNUM & 0x7FF;
+    unsigned long nowUs = micros();
+    SREG = oldSREG;
+
+    if (!sampled) {
+      sampled = true;
+    } else {
+      uint16_t advanced = (frame - lastFrame) & 0x7FF;
+      unsigned long bracketUs = nowUs - lastSampleUs;
+      if (windowOpen) windowFrames += advanced;
+      if (windowFrames >= 2 * DRIFT_WINDOW_FRAMES) windowOpen = false;  // No close pair for too long: start over
+
+      // Exactly one SOF between two close samples: its local time is known to within the pair
+      if (advanced == 1 && bracketUs <= DRIFT_EDGE_MAX_US) {
+        unsigned long edgeUs = nowUs - bracketUs / 2;
+        if (!windowOpen) {
+          windowOpen = true;
+          windowFrames = 0;
+          windowStartUs = edgeUs;
+        } else if (windowFrames >= DRIFT_WINDOW_FRAMES) {
+          closeWindow(edgeUs);
+        }
+      }
+    }
+    lastFrame = frame;
+    lastSampleUs = nowUs;
+  }
+
+  // A few ms of EEPROM writes: only between songs
+  if (savePending && !(sync && sync->isClockRunning())) {
+    save();
+  }
+}
+
+void Oscillator::closeWindow(unsigned long edgeUs) {
+  int32_t measured = driftPpm(windowFrames, edgeUs - windowStartUs);
+  windowFrames = 0;
+  windowStartUs = edgeUs;   // The next window starts at this edge
+
+  if (!driftPlausible(measured)) {
+    rejected++;
+    return;
+  }
+
+  lastWindowPpm = measured;
+  ppm = driftFilter(ppm, lastWindowPpm, state != OSC_STATE_LIVE);
+  state = OSC_STATE_LIVE;
+  if (windows < 0xFFFF) windows++;
+  if (sync) sync->setDriftPpm(ppm);
+
+  int16_t moved = ppm - storedPpm;
+  if (windows >= OSC_SAVE_WINDOWS && (moved >= OSC_SAVE_STEP_PPM || moved <= -OSC_SAVE_STEP_PPM)) {
+    savePending = true;
+  }
+}
+
+void Oscillator::load() {
+  uint8_t lo = EEPROM.read(EEPROM_OSC_ADDR + 1);
+  uint8_t hi = EEPROM.read(EEPROM_OSC_ADDR + 2);
+
+  if (EEPROM.read(EEPROM_OSC_ADDR) != OSC_MAGIC ||
+      EEPROM.read(OSC_CHECKSUM_ADDR) != (uint8_t)(OSC_MAGIC ^ lo ^ hi)) {
+    return;
+  }
+
+  int16_t stored = (int16_t)(lo | (hi << 8));
+  if (!driftPlausible(stored)) return;
+
+  ppm = stored;
+  storedPpm = stored;
+  state = OSC_STATE_STORED;
+}
+
+void Oscillator::save() {
+  uint8_t lo = (uint16_t)ppm & 0xFF;
+  uint8_t hi = (uint16_t)ppm >> 8;
+  EEPROM.update(EEPROM_OSC_ADDR + 1, lo);  // update() skips unchanged cells
+  EEPROM.update(EEPROM_OSC_ADDR + 2, hi);
+  EEPROM.update(OSC_CHECKSUM_ADDR, OSC_MAGIC ^ lo ^ hi);
+  EEPROM.update(EEPROM_OSC_ADDR, OSC_MAGIC);
+  storedPpm = ppm;
+  savePending = false;
+}
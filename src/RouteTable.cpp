@@ -0,0 +1,89 @@
+#include "RouteTable.h"
+#include "config.h"
+#include <EEPROM.h>
+#include <avr/eeprom.h>
+
+#define ROUTES_MAGIC    0xB5
+#define ROUTES_VERSION  1
+
+// Stored as: magic, version, masks, checksum
+#define ROUTES_DATA_ADDR      (EEPROM_ROUTES_ADDR + 2)
+#define ROUTES_CHECKSUM_ADDR  (ROUTES_DATA_ADDR + sizeof(masks))
+
+RouteTable routeTable;
+
+void RouteTable::setDefaults() {
+  for (uint8_t s = 0; s < ROUTE_SOURCE_COUNT; s++) {
+    for (uint8_t d = 0; d < ROUTE_DEST_COUNT; d++) {
+      for (uint8_t r = 0; r < ROUTE_ROWS; r++) {
+        masks[s][d][r] = 0;
+      }
+    }
+  }
+
+  for (uint8_t r = 0; r < ROUTE_ROW_SYSTEM; r++) {
+    masks[ROUTE_SRC_DIN][ROUTE_DST_USB][r] = ROUTE_ALL_CHANNELS;
+    masks[ROUTE_SRC_USB][ROUTE_DST_DIN][r] = ROUTE_ALL_CHANNELS;
+    #if FORWARD_MIDI_IN_TO_MIDI_OUT
+    masks[ROUTE_SRC_DIN][ROUTE_DST_DIN][r] = ROUTE_ALL_CHANNELS;
+    #endif
+  }
+
+  masks[ROUTE_SRC_DIN][ROUTE_DST_USB][ROUTE_ROW_SYSTEM] =
+    ROUTE_SYS_SYSEX | ROUTE_SYS_COMMON | ROUTE_SYS_CLOCK | ROUTE_SYS_TRANSPORT |
+    ROUTE_SYS_ACTIVE_SENSING | ROUTE_SYS_RESET;
+  masks[ROUTE_SRC_USB][ROUTE_DST_DIN][ROUTE_ROW_SYSTEM] =
+    ROUTE_SYS_CLOCK | ROUTE_SYS_TRANSPORT;
+  #if FORWARD_MIDI_IN_TO_MIDI_OUT
+  masks[ROUTE_SRC_DIN][ROUTE_DST_DIN][ROUTE_ROW_SYSTEM] =
+    ROUTE_SYS_SYSEX | ROUTE_SYS_COMMON | ROUTE_SYS_CLOCK | ROUTE_SYS_TRANSPORT |
+    ROUTE_SYS_ACTIVE_SENSING | ROUTE_SYS_RESET;
+  #endif
+  masks[ROUTE_SRC_SYNC][ROUTE_DST_DIN][ROUTE_ROW_SYSTEM] = ROUTE_SYS_CLOCK;
+  masks[ROUTE_SRC_SYNC][ROUTE_DST_USB][ROUTE_ROW_SYSTEM] = ROUTE_SYS_CLOCK;
+}
+
+void RouteTable::load() {
+  if (EEPROM.read(EEPROM_ROUTES_ADDR) != ROUTES_MAGIC ||
+      EEPROM.read(EEPROM_ROUTES_ADDR + 1) != ROUTES_VERSION) {
+    setDefaults();
+    return;
+  }
+
+  uint8_t* bytes = (uint8_t*)masks;
+  uint8_t checksum = ROUTES_MAGIC;
+  for (uint8_t i = 0; i < sizeof(masks); i++) {
+    bytes[i] = EEPROM.read(ROUTES_DATA_ADDR + i);
+    checksum ^= bytes[i];
+  }
+
+  if (checksum != EEPROM.read(ROUTES_CHECKSUM_ADDR)) {
+    setDefaults();
+  }
+}
+
+// A full write is ~100 cells of 3.4 ms: spread over loop passes instead of stalling one
+void RouteTable::save() {
+  saveStep = 0;
+  saveChecksum = ROUTES_MAGIC;
+}
+
+void RouteTable::update() {
+  if (saveStep == ROUTE_SAVE_IDLE || !eeprom_is_ready()) return;
+  
+  // The checksum covers the bytes as written, so a mask changed mid-save still loads consistently
+  const uint8_t* bytes = (const uint8_t*)masks;
+  if (saveStep < sizeof(masks)) {
+    EEPROM.update(ROUTES_DATA_ADDR + saveStep, bytes[saveStep]);  // update() skips unchanged cells
+    saveChecksum ^= bytes[saveStep];
+  } else if (saveStep == sizeof(masks)) {
+    EEPROM.update(ROUTES_CHECKSUM_ADDR, saveChecksum);
+  } else if (saveStep == sizeof(masks) + 1) {
+    EEPROM.update(EEPROM_ROUTES_ADDR + 1, ROUTES_VERSION);
+  } else {
+    EEPROM.update(EEPROM_ROUTES_ADDR, ROUTES_MAGIC);
+    saveStep = ROUTE_SAVE_IDLE;
+    return;
+  }
+  saveStep++;
+}
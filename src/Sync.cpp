@@ -1,38 +1,60 @@
 #include "Sync.h"
 #include "config.h"
-#include <MIDIUSB.h>
+#include "DinSerial.h"
+#include "UsbMidi.h"
+#include "RouteTable.h"
+#include "Timebase.h"
+#include "EventBus.h"
+#include "LoopGuard.h"
+#include "Trace.h"
+#include "Bench.h"
+#include "OscillatorDrift.h"
+#include "ControlInputs.h"
+#include "DisplayBurst.h"
 #include <MIDI.h>
 
-extern midi::MidiInterface<midi::SerialMIDI<HardwareSerial>> MIDI_DIN;
+extern midi::MidiInterface<midi::SerialMIDI<DinSerial>> MIDI_DIN;
+
+static const AnalogOutputConfig analogOutputs[ANALOG_OUT_COUNT] = {
+  DISPLAY_CLK_CONFIG,
+  ANALOG_OUT_1_CONFIG,
+  ANALOG_OUT_2_CONFIG
+};
 
 void Sync::begin() {
   pinMode(SYNC_OUT_PIN, OUTPUT);
-  pinMode(DISPLAY_CLK_PIN, OUTPUT);
+  ANALOG_OUT_DDR |= analogPortMask(analogOutputs, ANALOG_OUT_COUNT);
   pinMode(SYNC_IN_PIN, INPUT_PULLUP);
   pinMode(SYNC_IN_DETECT_PIN, INPUT_PULLUP);
   pinMode(LED_PULSE_PIN, OUTPUT);
   
-  pinMode(SYNC_RATE_PIN_1, INPUT_PULLUP);
-  pinMode(SYNC_RATE_PIN_2, INPUT_PULLUP);
-  pinMode(SYNC_RATE_PIN_3, INPUT_PULLUP);
-  pinMode(SYNC_RATE_PIN_4, INPUT_PULLUP);
-  pinMode(SYNC_RATE_PIN_5, INPUT_PULLUP);
-  
-  syncRate = readSyncInRate();
-  lastSwitchReadTime = millis();
-  
   digitalWrite(SYNC_OUT_PIN, LOW);
-  digitalWrite(DISPLAY_CLK_PIN, LOW);
+  Trace::record(TRACE_EV_SYNC_OUT, 0);
   digitalWrite(LED_PULSE_PIN, LOW);
   
+  // A new run starts with every bank output active: clocks at phase 0, reset, run
+  analogRunMask = analogModeMask(analogOutputs, ANALOG_OUT_COUNT, ANALOG_MODE_RUN);
+  analogResetMask = analogModeMask(analogOutputs, ANALOG_OUT_COUNT, ANALOG_MODE_RESET);
+  uint8_t allOutputs = (1 << ANALOG_OUT_COUNT) - 1;
+  analogStartSet = analogPortLevels(analogOutputs, ANALOG_OUT_COUNT, allOutputs);
+  analogStartClear = analogPortMask(analogOutputs, ANALOG_OUT_COUNT) & ~analogStartSet;
+  analogActive = allOutputs;
+  writeAnalog(0);   // Idle levels (active-low outputs high)
+  if (DISPLAY_CODE) DisplayBurst::begin(analogOutputs[0].bit, analogOutputs[0].inverted);
+  
   ppqnCounter = 0;
-  isPlaying = false;
-  usbIsPlaying = false;
-  syncInIsPlaying = false;
   clockState = false;
   ledState = false;
   activeSource = CLOCK_SOURCE_NONE;
   lastUSBClockTime = 0;
+  lastClockStampUs = 0;
+  clockPeriodUs = 0;
+  tickPeriodUs = 0;
+  songPosition = 0;
+  songTick = 0;
+  rebaseAnalog();
+  setDriftPpm(0);
+  syncInConnected = isSyncInConnected();
 }
 
 void Sync::handleSyncInPulse() {
@@ -46,74 +68,282 @@ void Sync::handleSyncInPulse() {
   
   lastInterruptTime = interruptTime;
   
-  if (!isSyncInConnected()) return;
-  syncInPulseTime = interruptTime;
+  if (!syncInConnected) return;
+  
+  // A pulse the bus consumer hasn't picked up yet: this one takes the deferred path as well
+  // Delayed outputs (chain compensation) leave the whole burst to the consumer
+  bool first = syncInQueued == 0 && outputDelayUs == 0;
+  BusEvent event = {BUS_HEADER(BUS_PORT_SYNC, 0x0F), 0xF8, first, 0, Timebase::now()};
+  if (!eventBus.push(event)) return;   // Bus full: the pulse is lost, counted as an overflow
+  syncInQueued++;
+  Trace::record(TRACE_EV_SYNC_IN);
+  if (!first) return;
+  
+  // SYNC_IN always wins arbitration, so the burst starts here: a new run at position 0,
+  // a running one where the last burst left the counter (only update() moves it)
+  bool running = activeSource == CLOCK_SOURCE_SYNC_IN;
+  uint8_t position = running ? ppqnCounter : 0;
+  if (position % getSyncOutDivisor() == 0) {
+    SYNC_OUT_PORT |= (1 << SYNC_OUT_BIT);
+  }
+  // Analog bank: the outputs due on this clock, one port write
+  if (running) {
+    ANALOG_OUT_PORT = (ANALOG_OUT_PORT | analogDueSet) & ~analogDueClear;
+    analogIsrRaised = analogDueOutputs;
+  } else {
+    ANALOG_OUT_PORT = (ANALOG_OUT_PORT | analogStartSet) & ~analogStartClear;
+    analogIsrRaised = (1 << ANALOG_OUT_COUNT) - 1;
+  }
+  if (Profile::din && routeTable.allows(ROUTE_SRC_SYNC, ROUTE_DST_DIN, midi::Clock)) {
+    dinSerial.write(0xF8);  // Realtime lane, or straight into UDR1 when the line is idle
+  }
 }
 
-void Sync::handleClock(ClockSource source) {
-  unsigned long now = millis();
+// One SYNC_IN edge off the event bus (MIDIHandler::dispatch): the rest of its burst
+void Sync::handleSyncInEvent(uint16_t stamp, bool firstSent) {
+  uint8_t oldSREG = SREG;
+  cli();
+  uint8_t isrRaised = analogIsrRaised;
+  syncInQueued--;
+  SREG = oldSREG;
   
-  // Priority: SYNC_IN > USB > DIN
-  // Reject lower priority sources completely when higher priority is active
-  if (source == CLOCK_SOURCE_DIN && (activeSource == CLOCK_SOURCE_USB || activeSource == CLOCK_SOURCE_SYNC_IN)) {
-    return;  // Ignore DIN if USB or SYNC_IN is active
-  }
-  if (source == CLOCK_SOURCE_USB && activeSource == CLOCK_SOURCE_SYNC_IN) {
-    return;  // Ignore USB if SYNC_IN is active
-  }
+  unsigned long currentTime = micros();
+  unsigned long currentMillis = millis();
   
-  // Handle first clock from each source
-  if (source == CLOCK_SOURCE_USB && !usbIsPlaying) {
-    usbIsPlaying = true;
-    isPlaying = true;
-    activeSource = CLOCK_SOURCE_USB;
-    ppqnCounter = 0;
-    lastUSBClockTime = now;
+  // Bank outputs the handler already drove: known as active before anything rewrites the port
+  if (firstSent) {
+    unsigned long riseUs = Timebase::toMicros(stamp);
+    for (uint8_t i = 0; i < ANALOG_OUT_COUNT; i++) {
+      if ((isrRaised >> i) & 1) analogRiseUs[i] = riseUs;
+    }
+    analogActive |= isrRaised;
+    Trace::record(TRACE_EV_ANALOG_OUT, analogActive);
+    
+    // The handler's DIN clock, as of the edge
+    if (Profile::din && routeTable.allows(ROUTE_SRC_SYNC, ROUTE_DST_DIN, midi::Clock)) {
+      loopGuard.sent(BUS_PORT_DIN, midi::Clock, 0, 0, stamp, currentMillis);
+    }
   }
   
-  if (source == CLOCK_SOURCE_DIN && !isPlaying) {
-    isPlaying = true;
-    activeSource = CLOCK_SOURCE_DIN;
-    ppqnCounter = 0;
-    lastDINClockTime = now;
-  }
+  // SYNC_IN does NOT send Start message - only clocks
+  arbitrate(CLOCK_SOURCE_SYNC_IN, CLOCK_EVENT_CLOCK, midi::Clock);
   
-  // USB can override DIN after it's started
-  if (source == CLOCK_SOURCE_USB && activeSource == CLOCK_SOURCE_DIN) {
-    activeSource = CLOCK_SOURCE_USB;
-    usbIsPlaying = true;
-    ppqnCounter = 0;  // Reset counter on source switch
-    lastUSBClockTime = now;
+  lastSyncInTime = currentMillis;  // Update for timeout detection
+  trackClockPeriod(Timebase::toMicros(stamp), getSyncInMultiplier());
+  
+  uint8_t multiplier = getSyncInMultiplier();
+  uint8_t divisor = getSyncOutDivisor();
+  
+  // Now send MIDI clocks and update counter
+  // Analog bank outputs pulse on their own ratios (as for MIDI clock sources)
+  // Pulse SYNC_OUT based on divisor setting
+  BENCH_SCOPE(BENCH_SYNC_IN_BURST);
+  for (uint8_t i = 0; i < multiplier; i++) {
+    // The INT6 handler already raised the first clock's edges and sent it on DIN
+    bool early = firstSent && i == 0;
+    unsigned long riseUs = early ? Timebase::toMicros(stamp) : currentTime;
+    sendMIDIClock(!early);
+    
+    // Rewrites the levels the handler already set for an early clock: no second edge
+    tickAnalog(riseUs);
+    
+    // Check if we should pulse SYNC_OUT based on divisor before incrementing
+    if (ppqnCounter % divisor == 0) {
+      if (!delayEdge(DELAY_EDGE_SYNC_OUT)) {
+        if (!early) digitalWrite(SYNC_OUT_PIN, HIGH);
+        Trace::record(TRACE_EV_SYNC_OUT, 1);
+        clockState = true;
+        lastPulseTime = riseUs;
+      }
+      
+      if (!ledState) {
+        digitalWrite(LED_PULSE_PIN, HIGH);
+        ledState = true;
+        ledPulseTime = currentMillis;
+      }
+    }
+    
+    advancePosition();
+  }
+  updateAnalogDue();
+}
+
+void Sync::setOutputDelayUs(unsigned long us) {
+  if (delayedEdges) fireDelayedEdges();
+  outputDelayUs = us;
+}
+
+void Sync::setDriftPpm(int16_t ppm) {
+  driftPpm = ppm;
+  pulseWidthUs = driftLocalUs(syncOutWidthUs, ppm);
+  for (uint8_t i = 0; i < ANALOG_OUT_COUNT; i++) {
+    bool gate = analogOutputs[i].mode == ANALOG_MODE_RUN;
+    analogWidthUs[i] = gate ? 0 : driftLocalUs(analogOutputs[i].widthUs, ppm);
   }
+}
+
+void Sync::setSyncRate(SyncInRate rate) {
+  if (rate == syncRate) return;
+  syncRate = rate;
+  syncRateFactor = 24 / (uint8_t)rate;
+  Trace::record(TRACE_EV_SYNC_RATE, rate);
+}
+
+void Sync::setPulseWidthUs(unsigned long us) {
+  syncOutWidthUs = us;
+  pulseWidthUs = driftLocalUs(us, driftPpm);
+}
+
+void Sync::setSwing(uint8_t value) {
+  swing = value;
+}
+
+// Every second SYNC_OUT pulse of a MIDI clock source goes out late by the swing;
+// SYNC_IN pulses are passed on as they came (the source has its own groove)
+bool Sync::swingEdge() {
+  if (swing == 0 || clockPeriodUs == 0) return false;
+  uint8_t divisor = getSyncOutDivisor();
+  if (!((ppqnCounter / divisor) & 1)) return false;
   
-  // Update last clock time for active source
-  if (source == CLOCK_SOURCE_USB && activeSource == CLOCK_SOURCE_USB) {
-    lastUSBClockTime = now;
+  unsigned long delayUs = controlSwingUs(clockPeriodUs * divisor, swing, pulseWidthUs);
+  if (delayUs == 0) return false;
+  swingDueUs = micros() + outputDelayUs + delayUs;
+  swingPending = true;
+  return true;
+}
+
+void Sync::raiseSyncOut() {
+  digitalWrite(SYNC_OUT_PIN, HIGH);
+  Trace::record(TRACE_EV_SYNC_OUT, 1);
+  clockState = true;
+  lastPulseTime = micros();
+}
+
+void Sync::raiseAnalog(uint8_t outputs, unsigned long riseUs) {
+  for (uint8_t i = 0; i < ANALOG_OUT_COUNT; i++) {
+    if ((outputs >> i) & 1) analogRiseUs[i] = riseUs;
   }
-  if (source == CLOCK_SOURCE_DIN && activeSource == CLOCK_SOURCE_DIN) {
-    lastDINClockTime = now;
+  writeAnalog(analogActive | outputs);
+}
+
+// All bank outputs change together: one read-modify-write of the port
+void Sync::writeAnalog(uint8_t active) {
+  if (active == analogActive) return;
+  analogActive = active;
+  
+  uint8_t mask = analogPortMask(analogOutputs, ANALOG_OUT_COUNT);
+  uint8_t levels = analogPortLevels(analogOutputs, ANALOG_OUT_COUNT, active);
+  uint8_t oldSREG = SREG;
+  cli();
+  if (DISPLAY_CODE) mask &= ~DisplayBurst::portBits();   // Mid-burst: the marks are the burst's
+  ANALOG_OUT_PORT = (ANALOG_OUT_PORT & ~mask) | (levels & mask);
+  SREG = oldSREG;
+  Trace::record(TRACE_EV_ANALOG_OUT, active);
+}
+
+// One clock on the bank: pulses the outputs due on it (queued with an output delay)
+void Sync::tickAnalog(unsigned long riseUs) {
+  uint8_t rising = analogTick(analogOutputs, ANALOG_OUT_COUNT, analogPhase);
+  if (rising && !delayEdge(DELAY_EDGE_ANALOG, rising)) {
+    raiseAnalog(rising, riseUs);
+  }
+}
+
+// Phases from the song position, after a reset or a Song Position Pointer
+void Sync::rebaseAnalog() {
+  analogRebase(analogOutputs, ANALOG_OUT_COUNT, analogPhase, songClocks(songPosition, songTick));
+  updateAnalogDue();
+}
+
+// What the INT6 handler raises on the next SYNC_IN clock: after a rebase and after each burst
+void Sync::updateAnalogDue() {
+  uint8_t due = analogDue(analogOutputs, ANALOG_OUT_COUNT, analogPhase);
+  uint8_t bits = analogPortMask(analogOutputs, ANALOG_OUT_COUNT, due);
+  uint8_t levels = analogPortLevels(analogOutputs, ANALOG_OUT_COUNT, due) & bits;
+  
+  uint8_t oldSREG = SREG;
+  cli();
+  analogDueOutputs = due;
+  analogDueSet = levels;
+  analogDueClear = bits & ~levels;
+  SREG = oldSREG;
+}
+
+// DISPLAY_CLK beat pulse just ended: tempo and beat in the bar follow it
+void Sync::sendDisplayCode() {
+  uint32_t beatUs = clockPeriodUs * analogOutputs[0].divisor;
+  if (clockPeriodUs == 0 || !displayCodeFits(beatUs, analogWidthUs[0])) return;
+  
+  uint8_t beat = (songPosition >> 2) & 0x03;   // Four 16ths to the quarter, 4/4 assumed
+  DisplayBurst::send(displayCodeFrame(displayCodeTempo(clockPeriodUs), beat));
+}
+
+// With an output delay the edge is queued instead of raised; returns true if it was
+bool Sync::delayEdge(uint8_t output, uint8_t analog) {
+  if (outputDelayUs == 0) return false;
+  
+  if (delayedEdges & output) fireDelayedEdges();  // Previous one still waiting: never drop an edge
+  if (!delayedEdges) delayedDueUs = micros() + outputDelayUs;
+  delayedEdges |= output;
+  delayedAnalog |= analog;
+  return true;
+}
+
+void Sync::fireDelayedEdges() {
+  if (delayedEdges & DELAY_EDGE_ANALOG) raiseAnalog(delayedAnalog, micros());
+  if (delayedEdges & DELAY_EDGE_SYNC_OUT) raiseSyncOut();
+  delayedEdges = 0;
+  delayedAnalog = 0;
+}
+
+unsigned long Sync::getLastClockMillis(ClockSource source) const {
+  switch (source) {
+    case CLOCK_SOURCE_DIN: return lastDINClockTime;
+    case CLOCK_SOURCE_USB: return lastUSBClockTime;
+    case CLOCK_SOURCE_SYNC_IN: return lastSyncInTime;
+    default: return 0;
   }
+}
+
+void Sync::handleClock(ClockSource source) {
+  handleClock(source, micros());
+}
+
+void Sync::handleClock(ClockSource source, unsigned long timestampUs) {
+  BENCH_SCOPE(BENCH_HANDLE_CLOCK);
+  unsigned long now = millis();
+  Trace::record(TRACE_EV_CLOCK_IN, source);
+  
+  uint8_t actions = arbitrate(source, CLOCK_EVENT_CLOCK, midi::Clock);
+  if (!(actions & CLOCK_ACT_ACCEPT)) return;
   
-  if (!isPlaying) return;
+  if (source == CLOCK_SOURCE_USB) lastUSBClockTime = now;
+  if (source == CLOCK_SOURCE_DIN) lastDINClockTime = now;
+  
+  trackClockPeriod(timestampUs);
   
   // Forward clock to MIDI DIN OUT (only for USB/SYNC_IN, DIN already forwards itself)
-  if (source == CLOCK_SOURCE_USB || source == CLOCK_SOURCE_SYNC_IN) {
+  if (Profile::din && source == CLOCK_SOURCE_USB && routeTable.allows(ROUTE_SRC_USB, ROUTE_DST_DIN, midi::Clock)) {
     MIDI_DIN.sendRealTime(midi::Clock);
+    loopGuard.sent(BUS_PORT_DIN, midi::Clock, 0, 0, Timebase::now(), now);
+    Trace::record(TRACE_EV_CLOCK_OUT, source);
   }
-  
-  if (ppqnCounter == 0) {
-    digitalWrite(DISPLAY_CLK_PIN, HIGH);
-    displayClkState = true;
-    displayClkPulseTime = millis();
+  if (Profile::din && source == CLOCK_SOURCE_SYNC_IN && routeTable.allows(ROUTE_SRC_SYNC, ROUTE_DST_DIN, midi::Clock)) {
+    MIDI_DIN.sendRealTime(midi::Clock);
+    loopGuard.sent(BUS_PORT_DIN, midi::Clock, 0, 0, Timebase::now(), now);
+    Trace::record(TRACE_EV_CLOCK_OUT, source);
   }
   
+  // Pulses timed from the clock's arrival, not from when it was dispatched
+  tickAnalog(timestampUs);
+  
   uint8_t divisor = getSyncOutDivisor();
   if (ppqnCounter % divisor == 0) {
     unsigned long now = millis();
     
-    digitalWrite(SYNC_OUT_PIN, HIGH);
-    clockState = true;
-    lastPulseTime = micros();
+    if (!swingEdge() && !delayEdge(DELAY_EDGE_SYNC_OUT)) {
+      raiseSyncOut();
+    }
     
     if (!ledState) {
       digitalWrite(LED_PULSE_PIN, HIGH);
@@ -122,297 +352,208 @@ void Sync::handleClock(ClockSource source) {
     }
   }
   
-  ppqnCounter++;
-  if (ppqnCounter >= PPQN) {
-    ppqnCounter = 0;
-  }
+  advancePosition();
 }
 
 void Sync::handleStart(ClockSource source) {
-  if (source == CLOCK_SOURCE_USB) {
-    usbIsPlaying = true;
-    activeSource = CLOCK_SOURCE_USB;
-    lastUSBClockTime = millis();
-    isPlaying = true;
-    ppqnCounter = 0;
-    
-    // USB is master: forward Start to MIDI OUT
-    MIDI_DIN.sendRealTime(midi::Start);
+  startTransport(source, midi::Start);
+}
+
+void Sync::handleContinue(ClockSource source) {
+  startTransport(source, midi::Continue);
+}
+
+void Sync::startTransport(ClockSource source, uint8_t status) {
+  Trace::record(TRACE_EV_START, source);
+  
+  // A DIN Start / Continue was already forwarded to USB and MIDI OUT by MIDIHandler
+  uint8_t actions = arbitrate(source, CLOCK_EVENT_START, status);
+  if (actions & CLOCK_ACT_STARTED) {
+    // The clock-lost timeout runs from the Start until the first clock
+    if (source == CLOCK_SOURCE_USB) lastUSBClockTime = millis();
+    if (source == CLOCK_SOURCE_DIN) lastDINClockTime = millis();
+  }
+}
+
+void Sync::handleStop(ClockSource source) {
+  Trace::record(TRACE_EV_STOP, source);
+  arbitrate(source, CLOCK_EVENT_STOP, midi::Stop);
+}
+
+void Sync::handleSongPosition(ClockSource source, uint16_t beats) {
+  // Only a source that may drive the outputs moves them
+  if (!accepts(source)) return;
+  
+  songPosition = beats & SONG_POSITION_MASK;
+  songTick = 0;
+  ppqnCounter = songQuarterCounter(songPosition, songTick);  // Takes effect on the next clock, even mid-song
+  rebaseAnalog();
+}
+
+uint8_t Sync::arbitrate(ClockSource source, ClockEvent event, uint8_t status) {
+  uint8_t step = clockArbiterStep(activeSource, source, event);
+  activeSource = clockArbiterNext(step);
+  
+  if (step & CLOCK_ACT_RESET) {
+    lastClockStampUs = 0;
+    tickPeriodUs = 0;
     
-    if (onClockStart) {
-      onClockStart();
+    // Only a Start rewinds the song. Stop and a lost source keep the position, and
+    // Continue or a source retaking with clocks alone (after a hiccup) resumes on it
+    if ((step & CLOCK_ACT_STARTED) && status != midi::Continue) {
+      songPosition = 0;
+      songTick = 0;
     }
-    
-    return;
+    ppqnCounter = songQuarterCounter(songPosition, songTick);
+    rebaseAnalog();
   }
   
-  if (source == CLOCK_SOURCE_DIN && usbIsPlaying) {
-    return;  // DIN blocked by USB
+  // USB is master: pass its transport on to MIDI OUT
+  if (Profile::din && (step & CLOCK_ACT_FORWARD) && routeTable.allows(ROUTE_SRC_USB, ROUTE_DST_DIN, status)) {
+    // Downstream units relock on the same 16th; Continue must not overtake the SPP.
+    // A route that passes SPP has already sent the host's own one to DIN
+    if (status == midi::Continue && SYNC_SPP_TO_DIN && !routeTable.allows(ROUTE_SRC_USB, ROUTE_DST_DIN, midi::SongPosition)) {
+      MIDI_DIN.sendCommon(midi::SongPosition, songPosition);
+      dinSerial.writeInOrder(status);
+      loopGuard.sent(BUS_PORT_DIN, midi::SongPosition, songPosition & 0x7F, (songPosition >> 7) & 0x7F, Timebase::now(), millis());
+    } else {
+      MIDI_DIN.sendRealTime((midi::MidiType)status);
+    }
+    loopGuard.sent(BUS_PORT_DIN, status, 0, 0, Timebase::now(), millis());
   }
   
-  if (source == CLOCK_SOURCE_DIN && !usbIsPlaying) {
-    activeSource = CLOCK_SOURCE_DIN;
-    isPlaying = true;
-    ppqnCounter = 0;
-    
-    // DIN is master: MidiHandler already forwarded to both USB and MIDI OUT
-    
+  // Run gates follow the active source, also when it took over with clocks alone
+  if (activeSource != CLOCK_SOURCE_NONE && (analogRunMask & ~analogActive)) {
+    raiseAnalog(analogRunMask, micros());
+  }
+  
+  if (step & CLOCK_ACT_STARTED) {
+    // Reset triggers fire unless the song carries on from where it was
+    if (analogResetMask && status != midi::Continue) {
+      raiseAnalog(analogResetMask, micros());
+    }
     if (onClockStart) {
       onClockStart();
     }
   }
-}
-
-void Sync::handleStop(ClockSource source) {
-  if (source == CLOCK_SOURCE_USB) {
-    usbIsPlaying = false;
-    isPlaying = false;
-    activeSource = CLOCK_SOURCE_NONE;
-    ppqnCounter = 0;
-    
-    // USB is master: forward Stop to MIDI OUT
-    MIDI_DIN.sendRealTime(midi::Stop);
-    
+  if (step & CLOCK_ACT_STOPPED) {
+    clearOutputs();
     if (onClockStop) {
       onClockStop();
     }
-    
-    return;
-  }
-  
-  if (source == CLOCK_SOURCE_DIN && usbIsPlaying) {
-    return;  // DIN blocked by USB
   }
   
-  if (source == CLOCK_SOURCE_DIN && !usbIsPlaying) {
-    activeSource = CLOCK_SOURCE_NONE;
-    isPlaying = false;
+  return step;
+}
+
+void Sync::advancePosition() {
+  ppqnCounter++;
+  if (ppqnCounter >= PPQN) {
     ppqnCounter = 0;
-    
-    digitalWrite(SYNC_OUT_PIN, LOW);
-    digitalWrite(DISPLAY_CLK_PIN, LOW);
-    digitalWrite(LED_PULSE_PIN, LOW);
-    clockState = false;
-    displayClkState = false;
-    ledState = false;
-    
-    // DIN is master: MidiHandler already forwarded to both USB and MIDI OUT
-    
-    if (onClockStop) {
-      onClockStop();
-    }
   }
+  songAdvance(songPosition, songTick);
+}
+
+void Sync::clearOutputs() {
+  digitalWrite(SYNC_OUT_PIN, LOW);
+  Trace::record(TRACE_EV_SYNC_OUT, 0);
+  writeAnalog(0);
+  digitalWrite(LED_PULSE_PIN, LOW);
+  clockState = false;
+  delayedEdges = 0;
+  delayedAnalog = 0;
+  swingPending = false;
+  ledState = false;
 }
 
 void Sync::update() {
-  unsigned long currentTime = micros();
-  unsigned long currentMillis = millis();
-  
-  if (syncInPulseTime > 0) {
-    unsigned long pulseTime = syncInPulseTime;
-    syncInPulseTime = 0;
-    
-    if (!syncInIsPlaying) {
-      syncInIsPlaying = true;
-      isPlaying = true;
-      activeSource = CLOCK_SOURCE_SYNC_IN;
-      ppqnCounter = 0;
-      lastSyncInTime = pulseTime;
-      
-      // SYNC_IN does NOT send Start message - only clocks
-      
-      if (onClockStart) {
-        onClockStart();
-      }
-    }
-    
-    lastSyncInTime = pulseTime;  // Update for timeout detection
-    
-    uint8_t multiplier = getSyncInMultiplier();
-    uint8_t divisor = getSyncOutDivisor();
-    
-    // Now send MIDI clocks and update counter
-    // Pulse DISPLAY_CLK once per quarter note (when ppqnCounter wraps to 0)
-    // Pulse SYNC_OUT based on divisor setting
-    for (uint8_t i = 0; i < multiplier; i++) {
-      sendMIDIClock();
-      
-      // Check if we should pulse SYNC_OUT based on divisor before incrementing
-      if (ppqnCounter % divisor == 0) {
-        digitalWrite(SYNC_OUT_PIN, HIGH);
-        clockState = true;
-        lastPulseTime = currentTime;
-        
-        if (!ledState) {
-          digitalWrite(LED_PULSE_PIN, HIGH);
-          ledState = true;
-          ledPulseTime = currentMillis;
-        }
-      }
-      
-      ppqnCounter++;
-      if (ppqnCounter >= PPQN) {
-        ppqnCounter = 0;
-        // Pulse DISPLAY_CLK once per beat using actual SYNC_IN pulse arrival time
-        digitalWrite(DISPLAY_CLK_PIN, HIGH);
-        displayClkState = true;
-        displayClkPulseTime = pulseTime;
-      }
-    }
+  // Before currentTime is taken: the pulse-width checks below must not see a later edge
+  if (delayedEdges && (long)(micros() - delayedDueUs) >= 0) {
+    fireDelayedEdges();
   }
-  
-  if (syncInIsPlaying) {
-    if (!isSyncInConnected()) {
-      syncInIsPlaying = false;
-      if (activeSource == CLOCK_SOURCE_SYNC_IN) {
-        activeSource = CLOCK_SOURCE_NONE;
-        isPlaying = false;
-        ppqnCounter = 0;
-        
-        // SYNC_IN does NOT send Stop message - only stops clocks
-        
-        if (onClockStop) {
-          onClockStop();
-        }
-      }
-    }
-    else if ((millis() - lastSyncInTime) > 3000) {
-      syncInIsPlaying = false;
-      if (activeSource == CLOCK_SOURCE_SYNC_IN) {
-        activeSource = CLOCK_SOURCE_NONE;
-        isPlaying = false;
-        ppqnCounter = 0;
-        
-        // SYNC_IN does NOT send Stop message - only stops clocks;
-        
-        if (onClockStop) {
-          onClockStop();
-        }
-      }
-    }
+  if (swingPending && (long)(micros() - swingDueUs) >= 0) {
+    swingPending = false;
+    raiseSyncOut();
   }
   
-  checkUSBTimeout();
+  unsigned long currentTime = micros();
+  unsigned long currentMillis = millis();
+  if (Profile::syncIn) syncInConnected = isSyncInConnected();
   
-  // Debounced switch reading - require 3 consecutive stable readings
-  if (currentMillis - lastSwitchReadTime >= 50) {
-    SyncInRate newRate = readSyncInRate();
-    
-    static SyncInRate pendingRate = SYNC_IN_2_PPQN;
-    static uint8_t stableCount = 0;
-    
-    if (newRate == pendingRate) {
-      stableCount++;
-      if (stableCount >= 3 && newRate != syncRate) {
-        syncRate = newRate;
-        stableCount = 0;
-      }
-    } else {
-      pendingRate = newRate;
-      stableCount = 1;
-    }
-    
-    lastSwitchReadTime = currentMillis;
+  // SYNC_IN does NOT send Stop message - only stops clocks
+  if (Profile::syncIn && activeSource == CLOCK_SOURCE_SYNC_IN && !isSyncInConnected()) {
+    arbitrate(CLOCK_SOURCE_SYNC_IN, CLOCK_EVENT_LOST, 0);
   }
   
-  if (clockState && (currentTime - lastPulseTime >= CLOCK_PULSE_WIDTH_US)) {
+  checkClockTimeout();
+  
+  if (clockState && (currentTime - lastPulseTime >= pulseWidthUs)) {
     digitalWrite(SYNC_OUT_PIN, LOW);
+    Trace::record(TRACE_EV_SYNC_OUT, 0);
     clockState = false;
   }
   
-  if (displayClkState && (currentMillis - displayClkPulseTime >= 5)) {
-    digitalWrite(DISPLAY_CLK_PIN, LOW);
-    displayClkState = false;
+  // Bank pulses end per output; gates (width 0) stay up until the clock stops
+  uint8_t ending = 0;
+  for (uint8_t i = 0; i < ANALOG_OUT_COUNT; i++) {
+    if (((analogActive >> i) & 1) && analogWidthUs[i] && currentTime - analogRiseUs[i] >= analogWidthUs[i]) {
+      ending |= 1 << i;
+    }
   }
+  if (ending) writeAnalog(analogActive & ~ending);
+  if (DISPLAY_CODE && (ending & 1)) sendDisplayCode();
   
   if (ledState && (currentMillis - ledPulseTime >= LED_PULSE_WIDTH_MS)) {
     digitalWrite(LED_PULSE_PIN, LOW);
     ledState = false;
   }
+  
+  // Source switches happen in several places; one check per pass is enough for the trace
+  static ClockSource tracedSource = CLOCK_SOURCE_NONE;
+  if (activeSource != tracedSource) {
+    tracedSource = activeSource;
+    Trace::record(TRACE_EV_SOURCE, activeSource);
+  }
 }
 
-void Sync::checkUSBTimeout() {
-  if (!usbIsPlaying) return;
-  
-  unsigned long now = millis();
-  if ((now - lastUSBClockTime) > 3000) {
-    usbIsPlaying = false;
-    isPlaying = false;
-    activeSource = CLOCK_SOURCE_NONE;
-    ppqnCounter = 0;
+// clocks: MIDI clocks since the previous call (a SYNC_IN edge stands for several)
+void Sync::trackClockPeriod(unsigned long timestampUs, uint8_t clocks) {
+  if (lastClockStampUs != 0) {
+    unsigned long tick = timestampUs - lastClockStampUs;
+    unsigned long interval = tick / clocks;
     
-    if (onClockStop) {
-      onClockStop();
+    // Ignore gaps longer than a 20 BPM clock (pause or source change)
+    if (interval < 125000UL) {
+      // 1/8 weight moving average smooths USB frame and loop jitter
+      clockPeriodUs = clockPeriodUs ? clockPeriodUs - (clockPeriodUs >> 3) + (interval >> 3) : interval;
+      tickPeriodUs = tickPeriodUs ? tickPeriodUs - (tickPeriodUs >> 3) + (tick >> 3) : tick;
     }
   }
+  lastClockStampUs = timestampUs;
 }
 
-bool Sync::isSyncInConnected() {
-  return digitalRead(SYNC_IN_DETECT_PIN) == HIGH;
-}
-
-SyncInRate Sync::readSyncInRate() {
-  // Read all pins
-  bool pin1 = (digitalRead(SYNC_RATE_PIN_1) == LOW);
-  bool pin2 = (digitalRead(SYNC_RATE_PIN_2) == LOW);
-  bool pin3 = (digitalRead(SYNC_RATE_PIN_3) == LOW);
-  bool pin4 = (digitalRead(SYNC_RATE_PIN_4) == LOW);
-  bool pin5 = (digitalRead(SYNC_RATE_PIN_5) == LOW);
-  
-  // Count how many pins are active
-  uint8_t activeCount = pin1 + pin2 + pin3 + pin4 + pin5;
-  
-  #if SERIAL_DEBUG
-  static unsigned long lastDebugTime = 0;
-  if (millis() - lastDebugTime > 2000) {
-    DEBUG_PRINT("Switch: P1=");
-    DEBUG_PRINT(pin1);
-    DEBUG_PRINT(" P2=");
-    DEBUG_PRINT(pin2);
-    DEBUG_PRINT(" P3=");
-    DEBUG_PRINT(pin3);
-    DEBUG_PRINT(" P4=");
-    DEBUG_PRINT(pin4);
-    DEBUG_PRINT(" P5=");
-    DEBUG_PRINT(pin5);
-    DEBUG_PRINT(" Active=");
-    DEBUG_PRINT(activeCount);
-    DEBUG_PRINT(" Rate=");
-    DEBUG_PRINTLN((int)syncRate);
-    lastDebugTime = millis();
-  }
-  #endif
-  
-  // If no pins active, keep current setting
-  if (activeCount == 0) {
-    return syncRate;
-  }
+// The active source is lost after CLOCK_LOST_TICKS of its own ticks without one
+void Sync::checkClockTimeout() {
+  if (activeSource == CLOCK_SOURCE_NONE) return;
   
-  // Special case: If P1 and P2 are both active (hardware issue), treat as position 1
-  if (pin1 && pin2 && !pin3 && !pin4 && !pin5) {
-    return SYNC_IN_1_PPQN;
+  if ((millis() - getLastClockMillis(activeSource)) > clockLostTimeoutMs(tickPeriodUs)) {
+    arbitrate(activeSource, CLOCK_EVENT_LOST, 0);
   }
-  
-  // Priority order: 5, 4, 3, 2, 1 (highest value wins if multiple active)
-  if (pin5) return SYNC_IN_24_PPQN;
-  if (pin4) return SYNC_IN_6_PPQN;
-  if (pin3) return SYNC_IN_4_PPQN;
-  if (pin2) return SYNC_IN_2_PPQN;
-  if (pin1) return SYNC_IN_1_PPQN;
-  
-  return syncRate;
-}
-
-uint8_t Sync::getSyncInMultiplier() {
-  return 24 / (uint8_t)syncRate;
 }
 
-uint8_t Sync::getSyncOutDivisor() {
-  return 24 / (uint8_t)syncRate;
+bool Sync::isSyncInConnected() {
+  return digitalRead(SYNC_IN_DETECT_PIN) == HIGH;
 }
 
-void Sync::sendMIDIClock() {
-  midiEventPacket_t clockEvent = {0x0F, 0xF8, 0, 0};
-  MidiUSB.sendMIDI(clockEvent);
-  MIDI_DIN.sendRealTime(midi::Clock);
+void Sync::sendMIDIClock(bool toDin) {
+  if (Profile::usb && routeTable.allows(ROUTE_SRC_SYNC, ROUTE_DST_USB, midi::Clock)) {
+    midiEventPacket_t clockEvent = {USB_MIDI_HEADER(USB_CABLE_CLOCK, 0x0F), 0xF8, 0, 0};
+    usbMidi.sendMIDI(clockEvent);
+    loopGuard.sent(BUS_PORT_USB, midi::Clock, 0, 0, Timebase::now(), millis());
+  }
+  if (Profile::din && toDin && routeTable.allows(ROUTE_SRC_SYNC, ROUTE_DST_DIN, midi::Clock)) {
+    MIDI_DIN.sendRealTime(midi::Clock);
+    loopGuard.sent(BUS_PORT_DIN, midi::Clock, 0, 0, Timebase::now(), millis());
+  }
+  Trace::record(TRACE_EV_CLOCK_OUT, CLOCK_SOURCE_SYNC_IN);
 }
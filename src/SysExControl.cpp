@@ -0,0 +1,337 @@
+#include "SysExControl.h"
+#include "MIDIHandler.h"
+#include "RouteTable.h"
+#include "DinSerial.h"
+#include "Diagnostics.h"
+#include "Trace.h"
+#include "Chain.h"
+#include "Oscillator.h"
+#include "Controls.h"
+#include "EventBus.h"
+#include "LoopGuard.h"
+#include "Timebase.h"
+#include <MIDI.h>
+
+extern midi::MidiInterface<midi::SerialMIDI<DinSerial>> MIDI_DIN;
+
+static const byte sysExHeader[SYSEX_HEADER_SIZE - 1] = {
+  0xF0, SYSEX_MANUFACTURER_ID, SYSEX_DEVICE_ID_1, SYSEX_DEVICE_ID_2
+};
+
+byte SysExControl::usbBuffer[SYSEX_MAX_MESSAGE_SIZE];
+uint8_t SysExControl::usbLength = 0;
+bool SysExControl::usbDiscard = true;
+
+bool SysExControl::handleMessage(const byte* data, unsigned size, uint8_t port) {
+  if (size < SYSEX_HEADER_SIZE + 1 || data[size - 1] != 0xF7) return false;
+  
+  for (uint8_t i = 0; i < sizeof(sysExHeader); i++) {
+    if (data[i] != sysExHeader[i]) return false;
+  }
+  
+  dispatch(data, size, port);
+  return true;
+}
+
+void SysExControl::feedUSBPacket(const midiEventPacket_t& event) {
+  uint8_t cin = USB_MIDI_CIN(event.header);
+  uint8_t count = (cin == 0x05) ? 1 : (cin == 0x06) ? 2 : 3;
+  const byte bytes[3] = { event.byte1, event.byte2, event.byte3 };
+  
+  for (uint8_t i = 0; i < count; i++) {
+    byte b = bytes[i];
+    
+    if (b == 0xF0) {
+      usbLength = 0;
+      usbDiscard = false;
+    }
+    if (usbDiscard) continue;
+    
+    // Drop foreign or oversized messages as early as possible
+    if (usbLength >= SYSEX_MAX_MESSAGE_SIZE ||
+        (usbLength < sizeof(sysExHeader) && b != sysExHeader[usbLength])) {
+      usbDiscard = true;
+      continue;
+    }
+    
+    usbBuffer[usbLength++] = b;
+    
+    if (b == 0xF7) {
+      handleMessage(usbBuffer, usbLength, ROUTE_SRC_USB);
+      usbDiscard = true;
+    }
+  }
+}
+
+void SysExControl::dispatch(const byte* data, unsigned size, uint8_t port) {
+  const byte* payload = data + SYSEX_HEADER_SIZE;
+  unsigned payloadSize = size - SYSEX_HEADER_SIZE - 1;
+  
+  switch (data[SYSEX_HEADER_SIZE - 1]) {
+    case SYSEX_CMD_ROUTE_SET:
+      if (payloadSize >= 6 && payload[0] < ROUTE_SOURCE_COUNT &&
+          payload[1] < ROUTE_DEST_COUNT && payload[2] < ROUTE_ROWS) {
+        uint16_t mask = payload[3] | (payload[4] << 7) | ((uint16_t)payload[5] << 14);
+        routeTable.setMask(payload[0], payload[1], payload[2], mask);
+      }
+      break;
+      
+    case SYSEX_CMD_ROUTE_GET:
+      if (payloadSize >= 2 && payload[0] < ROUTE_SOURCE_COUNT && payload[1] < ROUTE_DEST_COUNT) {
+        sendRouteData(payload[0], payload[1], port);
+      }
+      break;
+      
+    case SYSEX_CMD_ROUTE_SAVE:
+      routeTable.save();
+      break;
+      
+    case SYSEX_CMD_ROUTE_DEFAULTS:
+      routeTable.setDefaults();
+      break;
+      
+    case SYSEX_CMD_STATS_GET:
+      sendStats(port);
+      break;
+      
+    case SYSEX_CMD_MEMORY_GET:
+      sendMemory(port);
+      break;
+      
+    case SYSEX_CMD_STALL_GET:
+      sendStallRecord(port);
+      break;
+      
+    case SYSEX_CMD_TRACE_STREAM:
+      if (payloadSize >= 1) {
+        Trace::setStreaming(payload[0] != 0, port);
+        Trace::setCapturing(payload[0] == 2);
+      }
+      break;
+      
+    case SYSEX_CMD_CHAIN_CALIBRATE:
+      Chain::calibrate();
+      break;
+      
+    case SYSEX_CMD_CHAIN_PING:
+      if (port == ROUTE_SRC_DIN && payloadSize >= 2) {
+        Chain::handlePing(payload[0], payload[1]);
+      }
+      break;
+      
+    case SYSEX_CMD_CHAIN_RESULT:
+      if (port == ROUTE_SRC_DIN && payloadSize >= 6) {
+        uint16_t hopUs = payload[3] | (payload[4] << 7) | ((uint16_t)payload[5] << 14);
+        Chain::handleResult(payload[0], payload[1], hopUs);
+      }
+      break;
+      
+    case SYSEX_CMD_CHAIN_GET:
+      sendChainData(port);
+      break;
+      
+    case SYSEX_CMD_OSC_GET:
+      sendOscillatorData(port);
+      break;
+      
+    case SYSEX_CMD_CONTROLS_GET:
+      sendControlsData(port);
+      break;
+      
+    case SYSEX_CMD_BUS_GET:
+      sendBusData(port);
+      break;
+  }
+}
+
+void SysExControl::sendRouteData(uint8_t source, uint8_t dest, uint8_t port) {
+  byte msg[SYSEX_HEADER_SIZE + 2 + ROUTE_ROWS * 3 + 1];
+  uint8_t n = 0;
+  
+  for (uint8_t i = 0; i < sizeof(sysExHeader); i++) msg[n++] = sysExHeader[i];
+  msg[n++] = SYSEX_CMD_ROUTE_DATA;
+  msg[n++] = source;
+  msg[n++] = dest;
+  
+  for (uint8_t r = 0; r < ROUTE_ROWS; r++) {
+    uint16_t mask = routeTable.getMask(source, dest, r);
+    msg[n++] = mask & 0x7F;
+    msg[n++] = (mask >> 7) & 0x7F;
+    msg[n++] = (mask >> 14) & 0x03;
+  }
+  msg[n++] = 0xF7;
+  
+  reply(msg, n, port);
+}
+
+void SysExControl::sendStats(uint8_t port) {
+  uint16_t stats[SYSEX_STAT_COUNT];
+  stats[SYSEX_STAT_DIN_RX_OVERFLOWS] = dinSerial.getRxOverflows();
+  stats[SYSEX_STAT_DIN_COALESCED] = MIDIHandler::getCoalescedCount();
+  stats[SYSEX_STAT_DIN_PARKED] = MIDIHandler::getParkedCount();
+  stats[SYSEX_STAT_USB_DROP_NO_HOST] = usbMidi.getDroppedNoHost();
+  stats[SYSEX_STAT_USB_DROP_FULL] = usbMidi.getDroppedFull();
+  stats[SYSEX_STAT_USB_RX_BATCH] = usbMidi.getRxMaxBatch();
+  stats[SYSEX_STAT_USB_RX_CYCLES] = usbMidi.getRxCyclesPerPacket();
+  stats[SYSEX_STAT_LOOP_ECHOES] = loopGuard.getEchoes();
+  
+  sendCounters(SYSEX_CMD_STATS_DATA, stats, SYSEX_STAT_COUNT, port);
+}
+
+void SysExControl::sendMemory(uint8_t port) {
+  uint16_t memory[3];
+  memory[0] = Diagnostics::freeRam();
+  memory[1] = Diagnostics::stackHighWater();
+  memory[2] = Diagnostics::staticRam();
+  
+  sendCounters(SYSEX_CMD_MEMORY_DATA, memory, 3, port);
+}
+
+static uint16_t clampMillis(unsigned long ms) {
+  return ms > 0xFFFF ? 0xFFFF : ms;
+}
+
+void SysExControl::sendChainData(uint8_t port) {
+  uint16_t values[6];
+  values[0] = Chain::getState();
+  values[1] = Chain::getPosition();
+  values[2] = Chain::getUnits();
+  values[3] = Chain::getHopUs();
+  values[4] = clampMillis(Chain::getOutputDelayUs());
+  values[5] = clampMillis(Chain::getRoundTripUs());
+  
+  sendCounters(SYSEX_CMD_CHAIN_DATA, values, 6, port);
+}
+
+void SysExControl::sendOscillatorData(uint8_t port) {
+  uint16_t values[5];
+  values[0] = Oscillator::getState();
+  values[1] = (uint16_t)Oscillator::getPpm();
+  values[2] = (uint16_t)Oscillator::getLastWindowPpm();
+  values[3] = Oscillator::getWindows();
+  values[4] = Oscillator::getRejected();
+  
+  sendCounters(SYSEX_CMD_OSC_DATA, values, 5, port);
+}
+
+void SysExControl::sendControlsData(uint8_t port) {
+  uint16_t values[2 + CONTROL_POT_COUNT];
+  values[0] = Controls::getSwitchRate();
+  for (uint8_t i = 0; i < CONTROL_POT_COUNT; i++) {
+    values[1 + i] = Controls::getPot(i);
+  }
+  values[1 + CONTROL_POT_COUNT] = Controls::getTempoBpm();
+  
+  sendCounters(SYSEX_CMD_CONTROLS_DATA, values, 2 + CONTROL_POT_COUNT, port);
+}
+
+void SysExControl::sendBusData(uint8_t port) {
+  uint16_t values[3 + BUS_PORT_COUNT];
+  values[0] = eventBus.getHighWater();
+  values[1] = eventBus.getOverflows();
+  for (uint8_t i = 0; i < BUS_PORT_COUNT; i++) {
+    values[2 + i] = clampMillis((unsigned long)eventBus.getMaxLatency(i) * TIMEBASE_US_PER_TICK);
+  }
+  values[2 + BUS_PORT_COUNT] = loopGuard.getFlags(millis());
+  
+  sendCounters(SYSEX_CMD_BUS_DATA, values, 3 + BUS_PORT_COUNT, port);
+}
+
+void SysExControl::sendStallRecord(uint8_t port) {
+  uint16_t values[9] = {0};
+  
+  if (Diagnostics::hasStallRecord()) {
+    const StallRecord& stall = Diagnostics::getStallRecord();
+    values[0] = 1;
+    values[1] = stall.stage;
+    values[2] = stall.clockSource;
+    values[3] = clampMillis(stall.maxLoopUs);  // Saturates at 65535 us, [8] has it in ms
+    values[4] = clampMillis(stall.stallMillis / 1000);
+    values[5] = clampMillis(stall.stallMillis - stall.lastDINClock);
+    values[6] = clampMillis(stall.stallMillis - stall.lastUSBClock);
+    values[7] = clampMillis(stall.stallMillis - stall.lastSyncIn);
+    values[8] = clampMillis(stall.maxLoopUs / 1000);
+  }
+  
+  sendCounters(SYSEX_CMD_STALL_DATA, values, 9, port);
+}
+
+void SysExControl::sendTrace() {
+  if (!Trace::isStreaming() || Trace::pending() == 0) return;
+  
+  // A dropped message would record an overflow event, which is traced in turn
+  const uint8_t size = SYSEX_HEADER_SIZE + SYSEX_TRACE_EVENTS * 5 + 1;
+  if (Trace::getStreamPort() == ROUTE_SRC_USB && Profile::usb && !usbMidi.hasRoomFor((size + 2) / 3)) return;
+  
+  byte msg[size];
+  uint8_t n = 0;
+  
+  for (uint8_t i = 0; i < sizeof(sysExHeader); i++) msg[n++] = sysExHeader[i];
+  msg[n++] = SYSEX_CMD_TRACE_DATA;
+  
+  TraceEvent event;
+  for (uint8_t i = 0; i < SYSEX_TRACE_EVENTS && Trace::pop(event); i++) {
+    msg[n++] = event.id & 0x7F;
+    msg[n++] = event.arg & 0x7F;
+    msg[n++] = (event.arg >> 7) | ((event.stamp >> 14) << 1);
+    msg[n++] = event.stamp & 0x7F;
+    msg[n++] = (event.stamp >> 7) & 0x7F;
+  }
+  msg[n++] = 0xF7;
+  
+  reply(msg, n, Trace::getStreamPort());
+}
+
+void SysExControl::sendChainPing(uint8_t seq, uint8_t hops) {
+  byte msg[CHAIN_PING_BYTES];
+  uint8_t n = 0;
+  
+  for (uint8_t i = 0; i < sizeof(sysExHeader); i++) msg[n++] = sysExHeader[i];
+  msg[n++] = SYSEX_CMD_CHAIN_PING;
+  msg[n++] = seq & 0x7F;
+  msg[n++] = hops & 0x7F;
+  msg[n++] = 0xF7;
+  
+  reply(msg, n, ROUTE_SRC_DIN);
+}
+
+void SysExControl::sendChainResult(uint8_t hops, uint8_t units, uint16_t hopUs) {
+  byte msg[SYSEX_HEADER_SIZE + 6 + 1];
+  uint8_t n = 0;
+  
+  for (uint8_t i = 0; i < sizeof(sysExHeader); i++) msg[n++] = sysExHeader[i];
+  msg[n++] = SYSEX_CMD_CHAIN_RESULT;
+  msg[n++] = hops & 0x7F;
+  msg[n++] = units & 0x7F;
+  msg[n++] = hopUs & 0x7F;
+  msg[n++] = (hopUs >> 7) & 0x7F;
+  msg[n++] = (hopUs >> 14) & 0x03;
+  msg[n++] = 0xF7;
+  
+  reply(msg, n, ROUTE_SRC_DIN);
+}
+
+void SysExControl::sendCounters(uint8_t command, const uint16_t* values, uint8_t count, uint8_t port) {
+  byte msg[SYSEX_MAX_MESSAGE_SIZE];
+  uint8_t n = 0;
+  
+  for (uint8_t i = 0; i < sizeof(sysExHeader); i++) msg[n++] = sysExHeader[i];
+  msg[n++] = command;
+  
+  for (uint8_t i = 0; i < count && n + 4 <= SYSEX_MAX_MESSAGE_SIZE; i++) {
+    msg[n++] = values[i] & 0x7F;
+    msg[n++] = (values[i] >> 7) & 0x7F;
+    msg[n++] = (values[i] >> 14) & 0x03;
+  }
+  msg[n++] = 0xF7;
+  
+  reply(msg, n, port);
+}
+
+void SysExControl::reply(const byte* data, unsigned size, uint8_t port) {
+  if (port == ROUTE_SRC_USB) {
+    if (Profile::usb) MIDIHandler::sendSysExToUSB(data, size);
+  } else if (Profile::din) {
+    MIDI_DIN.sendSysEx(size, data, true);
+  }
+}
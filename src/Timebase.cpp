@@ -0,0 +1,32 @@
+#include "Timebase.h"
+
+volatile uint8_t Timebase::overflows = 0;
+
+ISR(TIMER1_OVF_vect) {
+  Timebase::overflowIrq();
+}
+
+void Timebase::begin() {
+  // The Arduino core leaves Timer1 in 8-bit phase-correct PWM mode.
+  // Switch it to normal mode so TCNT1 counts the full 16-bit range.
+  uint8_t oldSREG = SREG;
+  cli();
+  TCCR1A = 0;
+  TCCR1B = (1 << CS11) | (1 << CS10);  // clk/64 = 250 kHz
+  TCCR1C = 0;
+  TCNT1 = 0;
+  TIFR1 = (1 << TOV1);
+  TIMSK1 = (1 << TOIE1);
+  SREG = oldSREG;
+}
+
+unsigned long Timebase::toMicros(uint16_t stamp) {
+  uint8_t oldSREG = SREG;
+  cli();
+  uint16_t ticks = TCNT1;
+  unsigned long nowUs = micros();
+  SREG = oldSREG;
+
+  uint16_t age = ticks - stamp;
+  return nowUs - (unsigned long)age * TIMEBASE_US_PER_TICK;
+}
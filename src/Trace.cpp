@@ -0,0 +1,27 @@
+#include "Trace.h"
+
+#if TRACE_BUFFER_SIZE & (TRACE_BUFFER_SIZE - 1)
+#error "TRACE_BUFFER_SIZE must be a power of two"
+#endif
+
+TraceEvent Trace::buffer[TRACE_BUFFER_SIZE];
+volatile uint8_t Trace::head = 0;
+volatile uint8_t Trace::tail = 0;
+uint8_t Trace::lastEpoch = 0;
+uint8_t Trace::lost = 0;
+bool Trace::streaming = false;
+bool Trace::capturing = false;
+uint8_t Trace::streamPort = 0;
+
+bool Trace::pop(TraceEvent& event) {
+  if (head == tail) return false;
+  
+  // Copy before releasing the slot; record() may run from an interrupt
+  event = buffer[tail];
+  tail = (tail + 1) & (TRACE_BUFFER_SIZE - 1);
+  return true;
+}
+
+uint8_t Trace::pending() {
+  return (uint8_t)(head - tail) & (TRACE_BUFFER_SIZE - 1);
+}
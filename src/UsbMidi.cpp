@@ -0,0 +1,287 @@
+#include "UsbMidi.h"
+#include "Timebase.h"
+#include "Trace.h"
+#include <stddef.h>
+
+// USB Audio / MIDI Streaming class codes
+#define AUDIO_CLASS              0x01
+#define AUDIO_SUBCLASS_CONTROL   0x01
+#define AUDIO_SUBCLASS_STREAMING 0x03
+#define CS_INTERFACE             0x24
+#define CS_ENDPOINT              0x25
+#define MS_HEADER                0x01
+#define MS_MIDI_IN_JACK          0x02
+#define MS_MIDI_OUT_JACK         0x03
+#define MS_GENERAL               0x01
+#define JACK_EMBEDDED            0x01
+#define JACK_EXTERNAL            0x02
+
+#define USB_MIDI_STRING_INDEX    0x10   // Clear of the core's manufacturer/product/serial strings
+
+#if USB_TX_QUEUE_SIZE & (USB_TX_QUEUE_SIZE - 1)
+#error "USB_TX_QUEUE_SIZE must be a power of two"
+#endif
+
+#define TX_QUEUE_MASK (USB_TX_QUEUE_SIZE - 1)
+
+// Wire layout: packed so 16-bit fields sit where they do on the AVR (the host build pads them)
+typedef struct __attribute__((packed)) {
+  uint8_t len;
+  uint8_t dtype;
+  uint8_t subtype;
+  uint16_t bcdADC;
+  uint16_t wTotalLength;
+  uint8_t numInterfaces;
+  uint8_t streamingInterface;
+} ACHeaderDescriptor;
+
+typedef struct __attribute__((packed)) {
+  uint8_t len;
+  uint8_t dtype;
+  uint8_t subtype;
+  uint16_t bcdMSC;
+  uint16_t wTotalLength;
+} MSHeaderDescriptor;
+
+typedef struct {
+  uint8_t len;
+  uint8_t dtype;
+  uint8_t subtype;
+  uint8_t jackType;
+  uint8_t jackID;
+  uint8_t iJack;
+} MIDIInJackDescriptor;
+
+typedef struct {
+  uint8_t len;
+  uint8_t dtype;
+  uint8_t subtype;
+  uint8_t jackType;
+  uint8_t jackID;
+  uint8_t numInputPins;
+  uint8_t sourceID;
+  uint8_t sourcePin;
+  uint8_t iJack;
+} MIDIOutJackDescriptor;
+
+// One virtual cable = an embedded/external jack pair in each direction
+typedef struct {
+  MIDIInJackDescriptor embeddedIn;
+  MIDIInJackDescriptor externalIn;
+  MIDIOutJackDescriptor embeddedOut;
+  MIDIOutJackDescriptor externalOut;
+} MIDICableJacks;
+
+typedef struct {
+  EndpointDescriptor endpoint;
+  uint8_t refresh;
+  uint8_t syncAddress;
+} MIDIEndpointDescriptor;
+
+typedef struct {
+  uint8_t len;
+  uint8_t dtype;
+  uint8_t subtype;
+  uint8_t numJacks;
+  uint8_t jackIDs[USB_MIDI_CABLES];
+} MIDIClassEndpointDescriptor;
+
+typedef struct {
+  IADDescriptor iad;
+  InterfaceDescriptor controlInterface;
+  ACHeaderDescriptor controlHeader;
+  InterfaceDescriptor streamingInterface;
+  MSHeaderDescriptor streamingHeader;
+  MIDICableJacks cables[USB_MIDI_CABLES];
+  MIDIEndpointDescriptor outEndpoint;
+  MIDIClassEndpointDescriptor outJacks;
+  MIDIEndpointDescriptor inEndpoint;
+  MIDIClassEndpointDescriptor inJacks;
+} UsbMidiDescriptor;
+
+// Jack IDs per cable: 1 = embedded IN, 2 = external IN, 3 = embedded OUT, 4 = external OUT
+#define JACK_ID(cable, n)  ((uint8_t)((cable) * 4 + (n)))
+
+// Port names shown by the host (cables beyond this list stay unnamed)
+static const char cableNameDIN[] PROGMEM = "BytePulse DIN";
+static const char cableNameClock[] PROGMEM = "BytePulse Clock";
+static const char* const cableNames[] = { cableNameDIN, cableNameClock };
+#define CABLE_NAME_COUNT (sizeof(cableNames) / sizeof(cableNames[0]))
+
+UsbMidi usbMidi;
+
+UsbMidi::UsbMidi() : PluggableUSBModule(2, 2, epType) {
+  epType[0] = EP_TYPE_BULK_OUT;  // Host -> BytePulse
+  epType[1] = EP_TYPE_BULK_IN;   // BytePulse -> host
+  // Without USB MIDI the unit enumerates as the core's serial port only
+  if (Profile::usb) PluggableUSB().plug(this);
+}
+
+bool UsbMidi::setup(USBSetup&) {
+  return false;
+}
+
+int UsbMidi::getInterface(uint8_t* interfaceCount) {
+  *interfaceCount += 2;  // Audio Control + MIDI Streaming
+
+  uint8_t controlInterface = pluggedInterface;
+  uint8_t streamingInterface = pluggedInterface + 1;
+
+  UsbMidiDescriptor d;
+  d.iad = D_IAD(controlInterface, 2, AUDIO_CLASS, AUDIO_SUBCLASS_CONTROL, 0);
+  d.controlInterface = D_INTERFACE(controlInterface, 0, AUDIO_CLASS, AUDIO_SUBCLASS_CONTROL, 0);
+  d.controlHeader = { sizeof(ACHeaderDescriptor), CS_INTERFACE, MS_HEADER, 0x0100,
+                      sizeof(ACHeaderDescriptor), 1, streamingInterface };
+  d.streamingInterface = D_INTERFACE(streamingInterface, 2, AUDIO_CLASS, AUDIO_SUBCLASS_STREAMING, 0);
+  d.streamingHeader = { sizeof(MSHeaderDescriptor), CS_INTERFACE, MS_HEADER, 0x0100,
+                        (uint16_t)(sizeof(UsbMidiDescriptor) - offsetof(UsbMidiDescriptor, streamingHeader)) };
+
+  for (uint8_t c = 0; c < USB_MIDI_CABLES; c++) {
+    uint8_t name = (c < CABLE_NAME_COUNT) ? USB_MIDI_STRING_INDEX + c : 0;
+    MIDICableJacks& jacks = d.cables[c];
+    jacks.embeddedIn = { sizeof(MIDIInJackDescriptor), CS_INTERFACE, MS_MIDI_IN_JACK,
+                         JACK_EMBEDDED, JACK_ID(c, 1), name };
+    jacks.externalIn = { sizeof(MIDIInJackDescriptor), CS_INTERFACE, MS_MIDI_IN_JACK,
+                         JACK_EXTERNAL, JACK_ID(c, 2), 0 };
+    jacks.embeddedOut = { sizeof(MIDIOutJackDescriptor), CS_INTERFACE, MS_MIDI_OUT_JACK,
+                          JACK_EMBEDDED, JACK_ID(c, 3), 1, JACK_ID(c, 2), 1, name };
+    jacks.externalOut = { sizeof(MIDIOutJackDescriptor), CS_INTERFACE, MS_MIDI_OUT_JACK,
+                          JACK_EXTERNAL, JACK_ID(c, 4), 1, JACK_ID(c, 1), 1, 0 };
+    d.outJacks.jackIDs[c] = JACK_ID(c, 1);
+    d.inJacks.jackIDs[c] = JACK_ID(c, 3);
+  }
+
+  d.outEndpoint.endpoint = D_ENDPOINT(USB_ENDPOINT_OUT(rxEndpoint()), USB_ENDPOINT_TYPE_BULK, USB_EP_SIZE, 0);
+  d.outEndpoint.endpoint.len = sizeof(MIDIEndpointDescriptor);  // 9: D_ENDPOINT says 7, without refresh / syncAddress
+  d.outEndpoint.refresh = 0;
+  d.outEndpoint.syncAddress = 0;
+  d.outJacks.len = sizeof(MIDIClassEndpointDescriptor);
+  d.outJacks.dtype = CS_ENDPOINT;
+  d.outJacks.subtype = MS_GENERAL;
+  d.outJacks.numJacks = USB_MIDI_CABLES;
+
+  d.inEndpoint.endpoint = D_ENDPOINT(USB_ENDPOINT_IN(txEndpoint()), USB_ENDPOINT_TYPE_BULK, USB_EP_SIZE, 0);
+  d.inEndpoint.endpoint.len = sizeof(MIDIEndpointDescriptor);  // 9: D_ENDPOINT says 7, without refresh / syncAddress
+  d.inEndpoint.refresh = 0;
+  d.inEndpoint.syncAddress = 0;
+  d.inJacks.len = sizeof(MIDIClassEndpointDescriptor);
+  d.inJacks.dtype = CS_ENDPOINT;
+  d.inJacks.subtype = MS_GENERAL;
+  d.inJacks.numJacks = USB_MIDI_CABLES;
+
+  return USB_SendControl(0, &d, sizeof(d));
+}
+
+int UsbMidi::getDescriptor(USBSetup& setup) {
+  // Jack name strings; everything else is handled by the core
+  if (setup.wValueH != USB_STRING_DESCRIPTOR_TYPE) return 0;
+
+  uint8_t cable = setup.wValueL - USB_MIDI_STRING_INDEX;
+  if (cable >= CABLE_NAME_COUNT) return 0;
+
+  const char* name = cableNames[cable];
+  uint8_t length = strlen_P(name);
+  uint8_t header[2] = { (uint8_t)(2 + length * 2), USB_STRING_DESCRIPTOR_TYPE };
+  int sent = USB_SendControl(0, header, sizeof(header));
+
+  // UTF-16LE, one character at a time to avoid a RAM copy
+  for (uint8_t i = 0; i < length; i++) {
+    uint8_t utf16[2] = { pgm_read_byte(name + i), 0 };
+    sent += USB_SendControl(0, utf16, sizeof(utf16));
+  }
+  return sent;
+}
+
+uint8_t UsbMidi::readPackets(midiEventPacket_t* packets, uint8_t maxPackets) {
+  // USB_Available() only reports the current bank; the next bank is picked up next pass
+  uint8_t count = USB_Available(rxEndpoint()) / sizeof(midiEventPacket_t);
+  if (count > maxPackets) count = maxPackets;
+  if (count == 0) return 0;
+  
+  USB_Recv(rxEndpoint(), packets, count * sizeof(midiEventPacket_t));
+  return count;
+}
+
+void UsbMidi::recordRxPass(uint8_t packets, uint16_t ticks) {
+  if (packets == 0) return;
+  
+  if (packets > rxMaxBatch) rxMaxBatch = packets;
+  
+  // Timer1 ticks are 64 CPU cycles; average over ~8 passes
+  uint32_t cycles = (uint32_t)ticks * (F_CPU / 1000000UL * TIMEBASE_US_PER_TICK) / packets;
+  if (cycles > 0xFFFF) cycles = 0xFFFF;
+  rxCyclesPerPacket = rxCyclesPerPacket - (rxCyclesPerPacket >> 3) + (cycles >> 3);
+}
+
+// USB_Send() waits up to 250 ms for a full endpoint, so it is only called
+// once USB_SendSpace() guarantees the packet fits
+void UsbMidi::sendMIDI(const midiEventPacket_t& event) {
+  if (!pollHost()) {
+    droppedNoHost++;
+    return;
+  }
+  
+  drainQueue();
+  
+  if (txHead == txTail && USB_SendSpace(txEndpoint()) >= sizeof(event)) {
+    USB_Send(txEndpoint(), &event, sizeof(event));
+    return;
+  }
+  
+  uint8_t next = (txHead + 1) & TX_QUEUE_MASK;
+  if (next == txTail) {
+    droppedFull++;
+    Trace::record(TRACE_EV_OVERFLOW, TRACE_BUF_USB_FULL);
+    return;
+  }
+  txQueue[txHead] = event;
+  txHead = next;
+}
+
+bool UsbMidi::hasRoomFor(uint8_t packets) {
+  if (!pollHost()) return false;
+  
+  drainQueue();
+  uint8_t room = USB_TX_QUEUE_SIZE - 1 - queued();
+  if (txHead == txTail) room += USB_SendSpace(txEndpoint()) / sizeof(midiEventPacket_t);
+  return room >= packets;
+}
+
+void UsbMidi::flush() {
+  if (!pollHost()) return;
+  
+  drainQueue();
+  USB_Flush(txEndpoint());
+}
+
+bool UsbMidi::pollHost() {
+  bool ready = USBDevice.configured() && !USBDevice.isSuspended();
+  
+  if (ready != hostReady) {
+    // Unplug, suspend or re-enumeration: whatever is queued belongs to the old session
+    droppedNoHost += queued();
+    txHead = txTail = 0;
+    lastTxProgress = millis();
+    hostReady = ready;
+  }
+  return ready;
+}
+
+void UsbMidi::drainQueue() {
+  unsigned long now = millis();
+  
+  while (txHead != txTail && USB_SendSpace(txEndpoint()) >= sizeof(midiEventPacket_t)) {
+    USB_Send(txEndpoint(), &txQueue[txTail], sizeof(midiEventPacket_t));
+    txTail = (txTail + 1) & TX_QUEUE_MASK;
+    lastTxProgress = now;
+  }
+  
+  if (txHead == txTail) {
+    lastTxProgress = now;
+  } else if (now - lastTxProgress > USB_TX_STALL_MS) {
+    // Enumerated but nobody is reading the port (e.g. no DAW open); stale clocks are useless
+    droppedFull += queued();
+    txHead = txTail = 0;
+    Trace::record(TRACE_EV_OVERFLOW, TRACE_BUF_USB_FULL);
+  }
+}
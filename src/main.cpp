@@ -1,43 +1,57 @@
 #include <Arduino.h>
-#include <MIDIUSB.h>
 #include "config.h"
 #include "MIDIHandler.h"
 #include "Sync.h"
 #include "TestModes.h"
+#include "Timebase.h"
+#include "Diagnostics.h"
+#include "SysExControl.h"
+#include "Chain.h"
+#include "Oscillator.h"
+#include "Controls.h"
+#include "RouteTable.h"
+#include "DinSerial.h"
+#include "UsbMidi.h"
+#include "Trace.h"
+#include "Bench.h"
 
 MIDIHandler midiHandler;
 Sync sync;
 TestModes testModes;
 
-void syncInInterrupt() {
+// SYNC_IN edge, vectored directly: attachInterrupt's dispatcher would add a few us
+ISR(INT6_vect) {
+  BENCH_SCOPE(BENCH_SYNC_IN_ISR);
   sync.handleSyncInPulse();
 }
 
-void processUSBMIDI() {
-  while (true) {
-    midiEventPacket_t rx = MidiUSB.read();
+uint8_t processUSBMIDI() {
+  midiEventPacket_t packets[USB_RX_PACKETS_PER_PASS];
+  uint16_t start = Timebase::now();
+  
+#if CYCLE_BENCH
+  uint8_t count = benchReadPackets(packets, USB_RX_PACKETS_PER_PASS);
+#else
+  uint8_t count = usbMidi.readPackets(packets, USB_RX_PACKETS_PER_PASS);
+#endif
+  
+  if (count && Trace::isCapturing()) Trace::record(TRACE_EV_USB_RX, count);
+  
+  for (uint8_t i = 0; i < count; i++) {
+    const midiEventPacket_t& rx = packets[i];
     
-    if (rx.header == 0) break;
-
-    midiHandler.forwardUSBtoDIN(rx);
-
-    if (rx.header == 0x0F) {
-      switch (rx.byte1) {
-        case 0xF8: 
-          sync.handleClock(CLOCK_SOURCE_USB);
-          break;
-        case 0xFA:
-          sync.handleStart(CLOCK_SOURCE_USB);
-          break;
-        case 0xFB: 
-          sync.handleStart(CLOCK_SOURCE_USB);
-          break;
-        case 0xFC: 
-          sync.handleStop(CLOCK_SOURCE_USB);
-          break;
-      }
-    }
+    if (Trace::isCapturing()) Trace::recordPacket(rx.header, rx.byte1, rx.byte2, rx.byte3);
+    
+    // Zero padding would otherwise reach DIN OUT as 00 00 00
+    if (!busIsMessage(USB_MIDI_CIN(rx.header), rx.byte1)) continue;
+    
+    // Routing and sync are the bus consumer's job (MIDIHandler::dispatch)
+    BusEvent event = {BUS_HEADER(BUS_PORT_USB, USB_MIDI_CIN(rx.header)), rx.byte1, rx.byte2, rx.byte3, start};
+    eventBus.post(event);
   }
+  
+  usbMidi.recordRxPass(count, Timebase::now() - start);
+  return count;
 }
 
 void setup() {
@@ -53,17 +67,43 @@ void setup() {
   DEBUG_PRINTLN(0);
   #endif
   
+  Diagnostics::setStage(DIAG_STAGE_SETUP);
+  Timebase::begin();
   sync.begin();
+  Oscillator::begin(&sync);
+  Controls::begin(&sync);
   midiHandler.setSync(&sync);
   midiHandler.begin();
   
   testModes.setup(&sync);
+  Chain::begin(&sync);
   
-  attachInterrupt(digitalPinToInterrupt(SYNC_IN_PIN), syncInInterrupt, RISING);
+  // SYNC_IN: INT6 on the rising edge
+  if (Profile::syncIn) {
+    EICRB |= (1 << ISC61) | (1 << ISC60);
+    EIFR = (1 << INTF6);
+    EIMSK |= (1 << INT6);
+  }
+  
+  Diagnostics::begin(&sync);
+  #if SERIAL_DEBUG
+  if (Diagnostics::hasStallRecord()) {
+    const StallRecord& stall = Diagnostics::getStallRecord();
+    DEBUG_PRINT("Watchdog reset - stalled in stage ");
+    DEBUG_PRINT(stall.stage);
+    DEBUG_PRINT(" at ");
+    DEBUG_PRINT(stall.stallMillis);
+    DEBUG_PRINT(" ms, clock source ");
+    DEBUG_PRINTLN(stall.clockSource);
+  }
+  #endif
 }
 
 void loop() {
+  Diagnostics::loopTick();
+  
 #if TEST_MODE_CLOCK || TEST_MODE_SYNC_IN || TEST_MODE_MIDI_IN
+  Diagnostics::setStage(DIAG_STAGE_TEST_MODES);
   testModes.loop(&sync);
   
   #if TEST_MODE_CLOCK
@@ -71,8 +111,35 @@ void loop() {
   #endif
 #endif
   // Normal operation
-  midiHandler.update();
-  processUSBMIDI();
+  // Profile:: conditions are compile-time constants: unused inputs drop out of the image
+  Diagnostics::setStage(DIAG_STAGE_DIN_READ);
+  if (Profile::din) midiHandler.update();
+  Diagnostics::setStage(DIAG_STAGE_USB_RX);
+  uint8_t usbPackets = Profile::usb ? processUSBMIDI() : 0;
+  Diagnostics::setStage(DIAG_STAGE_BUS);
+  MIDIHandler::dispatch();
+  Diagnostics::setStage(DIAG_STAGE_SYNC_UPDATE);
+  Controls::update();
   sync.update();
-  midiHandler.flushBuffer();
+  Diagnostics::setStage(DIAG_STAGE_USB_FLUSH);
+  if (Profile::usb) midiHandler.flushBuffer();
+  Diagnostics::setStage(DIAG_STAGE_OSC_CAL);
+  if (Profile::usb) Oscillator::update();
+  Diagnostics::setStage(DIAG_STAGE_EEPROM);
+  routeTable.update();
+  
+  // Trace output only when nothing else is waiting; a capture drains once the
+  // buffer is half full, since one USB pass alone adds up to 17 events
+  bool idle = usbPackets == 0 && !(Profile::din && dinSerial.available());
+  if (idle || (Trace::isCapturing() && Trace::pending() >= TRACE_BUFFER_SIZE / 2)) {
+    Diagnostics::setStage(DIAG_STAGE_TRACE);
+    SysExControl::sendTrace();
+  }
+  
+  // Announce the previous run's stall once a host is listening (still queryable afterwards)
+  static bool stallAnnounced = false;
+  if (Profile::usb && !stallAnnounced && Diagnostics::hasStallRecord() && usbMidi.isHostReady()) {
+    SysExControl::sendStallRecord(ROUTE_SRC_USB);
+    stallAnnounced = true;
+  }
 }
@@ -0,0 +1,95 @@
+#include <unity.h>
+#include "AnalogOutputs.h"
+
+// 1 PPQN, 4 PPQN, 24 PPQN (active low), run gate, one per bar
+static const AnalogOutputConfig outputs[] = {
+    { 4, ANALOG_MODE_CLOCK, 24, 5000, false },
+    { 1, ANALOG_MODE_CLOCK, 6, 5000, false },
+    { 0, ANALOG_MODE_CLOCK, 1, 2000, true },
+    { 7, ANALOG_MODE_RUN, 0, 0, false },
+    { 6, ANALOG_MODE_CLOCK, 96, 5000, false },
+};
+#define COUNT  5
+
+static uint8_t phase[COUNT];
+
+// From the song start every clock output pulses on the first clock
+void test_all_clocks_on_first_tick() {
+    analogRebase(outputs, COUNT, phase, 0);
+    TEST_ASSERT_EQUAL_HEX8(0x17, analogTick(outputs, COUNT, phase));
+    // Next clock: only 24 PPQN
+    TEST_ASSERT_EQUAL_HEX8(0x04, analogTick(outputs, COUNT, phase));
+}
+
+// Pulses per quarter note follow each output's ratio
+void test_rates_over_one_bar() {
+    uint8_t counts[COUNT] = {0};
+    analogRebase(outputs, COUNT, phase, 0);
+    for (uint8_t clock = 0; clock < 96; clock++) {
+        uint8_t rising = analogTick(outputs, COUNT, phase);
+        for (uint8_t i = 0; i < COUNT; i++) {
+            if ((rising >> i) & 1) counts[i]++;
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT8(4, counts[0]);
+    TEST_ASSERT_EQUAL_UINT8(16, counts[1]);
+    TEST_ASSERT_EQUAL_UINT8(96, counts[2]);
+    TEST_ASSERT_EQUAL_UINT8(0, counts[3]);
+    TEST_ASSERT_EQUAL_UINT8(1, counts[4]);
+}
+
+// A Song Position Pointer lands every output on its grid: 16th 6 = 36 clocks
+void test_rebase_from_song_position() {
+    analogRebase(outputs, COUNT, phase, 6 * 6);
+    TEST_ASSERT_EQUAL_HEX8(0x06, analogDue(outputs, COUNT, phase));
+
+    // The quarter note is 12 clocks away, the bar 60
+    for (uint8_t clock = 0; clock < 12; clock++) analogTick(outputs, COUNT, phase);
+    TEST_ASSERT_EQUAL_HEX8(0x07, analogDue(outputs, COUNT, phase));
+    for (uint8_t clock = 0; clock < 48; clock++) analogTick(outputs, COUNT, phase);
+    TEST_ASSERT_EQUAL_HEX8(0x17, analogDue(outputs, COUNT, phase));
+}
+
+// The whole song range stays on the bar grid (SPP wraps at 16384 16ths)
+void test_rebase_at_song_wrap() {
+    analogRebase(outputs, COUNT, phase, 16383UL * 6);
+    TEST_ASSERT_EQUAL_UINT8(90, phase[4]);
+    for (uint8_t clock = 0; clock < 6; clock++) analogTick(outputs, COUNT, phase);
+    analogRebase(outputs, COUNT, phase, 0);
+    TEST_ASSERT_EQUAL_UINT8(0, phase[4]);
+}
+
+// Port bits and polarity: an idle active-low output sits high
+void test_port_levels() {
+    TEST_ASSERT_EQUAL_HEX8(0xD3, analogPortMask(outputs, COUNT));
+    TEST_ASSERT_EQUAL_HEX8(0x12, analogPortMask(outputs, COUNT, 0x03));
+    TEST_ASSERT_EQUAL_HEX8(0x01, analogPortLevels(outputs, COUNT, 0x00));
+    TEST_ASSERT_EQUAL_HEX8(0x90, analogPortLevels(outputs, COUNT, 0x0D));
+    TEST_ASSERT_EQUAL_HEX8(0xD2, analogPortLevels(outputs, COUNT, 0x1F));
+}
+
+// Transport outputs are picked out by mode
+void test_mode_masks() {
+    TEST_ASSERT_EQUAL_HEX8(0x08, analogModeMask(outputs, COUNT, ANALOG_MODE_RUN));
+    TEST_ASSERT_EQUAL_HEX8(0x00, analogModeMask(outputs, COUNT, ANALOG_MODE_RESET));
+    TEST_ASSERT_EQUAL_HEX8(0x17, analogModeMask(outputs, COUNT, ANALOG_MODE_CLOCK));
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_all_clocks_on_first_tick);
+    RUN_TEST(test_rates_over_one_bar);
+    RUN_TEST(test_rebase_from_song_position);
+    RUN_TEST(test_rebase_at_song_wrap);
+    RUN_TEST(test_port_levels);
+    RUN_TEST(test_mode_masks);
+
+    return UNITY_END();
+}
@@ -0,0 +1,68 @@
+#include <unity.h>
+#include "ChainLatency.h"
+
+// Per forward the ping costs its own 8 bytes on the wire, a clock costs one
+void test_hop_latency_removes_store_and_forward() {
+    // 3 forwards, each 2560 us serialization + 500 us processing
+    TEST_ASSERT_EQUAL_UINT16(820, chainHopLatencyUs(3 * (2560 + 500), 3));
+    TEST_ASSERT_EQUAL_UINT16(320 + 40, chainHopLatencyUs(2560 + 40, 1));
+}
+
+// A ring without other units (OUT looped straight back) has no hop to measure
+void test_no_forwards() {
+    TEST_ASSERT_EQUAL_UINT16(0, chainHopLatencyUs(2600, 0));
+}
+
+// Round trips shorter than the serialization alone are measurement errors
+void test_implausibly_short_round_trip() {
+    TEST_ASSERT_EQUAL_UINT16(0, chainHopLatencyUs(2000, 1));
+    TEST_ASSERT_EQUAL_UINT16(0, chainHopLatencyUs(2240, 1));
+}
+
+// Huge round trips saturate instead of wrapping
+void test_hop_latency_saturates() {
+    TEST_ASSERT_EQUAL_UINT16(0xFFFF, chainHopLatencyUs(200000UL, 1));
+}
+
+// The first unit waits for every hop, the last one fires immediately
+void test_output_delay_by_position() {
+    TEST_ASSERT_EQUAL_UINT32(3 * 700, chainOutputDelayUs(4, 0, 700));
+    TEST_ASSERT_EQUAL_UINT32(2 * 700, chainOutputDelayUs(4, 1, 700));
+    TEST_ASSERT_EQUAL_UINT32(700, chainOutputDelayUs(4, 2, 700));
+    TEST_ASSERT_EQUAL_UINT32(0, chainOutputDelayUs(4, 3, 700));
+}
+
+// Uncalibrated or inconsistent positions never delay
+void test_output_delay_invalid() {
+    TEST_ASSERT_EQUAL_UINT32(0, chainOutputDelayUs(0, 0, 700));
+    TEST_ASSERT_EQUAL_UINT32(0, chainOutputDelayUs(4, 4, 700));
+    TEST_ASSERT_EQUAL_UINT32(0, chainOutputDelayUs(1, 0, 700));
+}
+
+// Every unit ends up firing when the last unit receives the clock
+void test_chain_phase_aligned() {
+    const uint8_t units = 5;
+    const uint16_t hop = chainHopLatencyUs((units - 1) * (2560UL + 380), units - 1);
+    for (uint8_t position = 0; position < units; position++) {
+        unsigned long fire = position * (unsigned long)hop + chainOutputDelayUs(units, position, hop);
+        TEST_ASSERT_EQUAL_UINT32((units - 1) * (unsigned long)hop, fire);
+    }
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_hop_latency_removes_store_and_forward);
+    RUN_TEST(test_no_forwards);
+    RUN_TEST(test_implausibly_short_round_trip);
+    RUN_TEST(test_hop_latency_saturates);
+    RUN_TEST(test_output_delay_by_position);
+    RUN_TEST(test_output_delay_invalid);
+    RUN_TEST(test_chain_phase_aligned);
+    return UNITY_END();
+}
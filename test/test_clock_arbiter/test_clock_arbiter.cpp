@@ -0,0 +1,153 @@
+#include <unity.h>
+#include <stdio.h>
+#include "ClockArbiter.h"
+
+static const uint8_t sources[] = { CLOCK_SOURCE_SYNC_IN, CLOCK_SOURCE_DIN, CLOCK_SOURCE_USB };
+
+static uint8_t rank(uint8_t source) {
+    switch (source) {
+        case CLOCK_SOURCE_SYNC_IN: return 3;
+        case CLOCK_SOURCE_USB: return 2;
+        case CLOCK_SOURCE_DIN: return 1;
+        default: return 0;
+    }
+}
+
+// The rules written out longhand; the table must agree with them everywhere
+static uint8_t expectedStep(uint8_t active, uint8_t source, uint8_t event) {
+    uint8_t forward = source == CLOCK_SOURCE_USB ? CLOCK_ACT_FORWARD : 0;
+
+    switch (event) {
+        case CLOCK_EVENT_CLOCK:
+            if (source == active) return active | CLOCK_ACT_ACCEPT;
+            if (rank(source) > rank(active)) {
+                uint8_t started = source == CLOCK_SOURCE_SYNC_IN ? CLOCK_ACT_STARTED : 0;
+                return source | CLOCK_ACT_ACCEPT | CLOCK_ACT_RESET | started;
+            }
+            return active;
+
+        case CLOCK_EVENT_START:
+            if (source == CLOCK_SOURCE_SYNC_IN || rank(source) < rank(active)) return active;
+            return source | CLOCK_ACT_RESET | CLOCK_ACT_STARTED | forward;
+
+        case CLOCK_EVENT_STOP:
+            if (source == CLOCK_SOURCE_SYNC_IN) return active;
+            if (source == active) return CLOCK_SOURCE_NONE | CLOCK_ACT_RESET | CLOCK_ACT_STOPPED | forward;
+            if (active == CLOCK_SOURCE_NONE) return CLOCK_SOURCE_NONE | forward;
+            return active;
+
+        case CLOCK_EVENT_LOST:
+            if (source == active) return CLOCK_SOURCE_NONE | CLOCK_ACT_RESET | CLOCK_ACT_STOPPED;
+            return active;
+    }
+    return active;
+}
+
+// Every (state, source, event) entry of the table
+void test_every_transition() {
+    char message[64];
+
+    for (uint8_t active = 0; active < CLOCK_SOURCE_COUNT; active++) {
+        for (uint8_t s = 0; s < sizeof(sources); s++) {
+            for (uint8_t event = 0; event < CLOCK_EVENT_COUNT; event++) {
+                snprintf(message, sizeof(message), "active %d source %d event %d", active, sources[s], event);
+                TEST_ASSERT_EQUAL_HEX8_MESSAGE(expectedStep(active, sources[s], event),
+                                               clockArbiterStep(active, sources[s], event), message);
+            }
+        }
+    }
+}
+
+// Entries only use the next-state bits and defined actions
+void test_no_stray_bits() {
+    const uint8_t known = CLOCK_NEXT_MASK | CLOCK_ACT_ACCEPT | CLOCK_ACT_RESET |
+                          CLOCK_ACT_STARTED | CLOCK_ACT_STOPPED | CLOCK_ACT_FORWARD;
+
+    for (uint8_t active = 0; active < CLOCK_SOURCE_COUNT; active++) {
+        for (uint8_t s = 0; s < sizeof(sources); s++) {
+            for (uint8_t event = 0; event < CLOCK_EVENT_COUNT; event++) {
+                TEST_ASSERT_EQUAL_HEX8(0, clockArbiterStep(active, sources[s], event) & ~known);
+            }
+        }
+    }
+}
+
+// DIN Start used to take over while SYNC_IN was running
+void test_din_start_blocked_by_sync_in() {
+    uint8_t step = clockArbiterStep(CLOCK_SOURCE_SYNC_IN, CLOCK_SOURCE_DIN, CLOCK_EVENT_START);
+    TEST_ASSERT_EQUAL(CLOCK_SOURCE_SYNC_IN, clockArbiterNext(step));
+    TEST_ASSERT_EQUAL_HEX8(0, step & ~CLOCK_NEXT_MASK);
+
+    step = clockArbiterStep(CLOCK_SOURCE_USB, CLOCK_SOURCE_DIN, CLOCK_EVENT_START);
+    TEST_ASSERT_EQUAL(CLOCK_SOURCE_USB, clockArbiterNext(step));
+}
+
+// USB transport can't interrupt SYNC_IN, and its Stop doesn't stop a DIN clock
+void test_usb_transport_respects_priority() {
+    TEST_ASSERT_EQUAL(CLOCK_SOURCE_SYNC_IN,
+                      clockArbiterNext(clockArbiterStep(CLOCK_SOURCE_SYNC_IN, CLOCK_SOURCE_USB, CLOCK_EVENT_START)));
+    TEST_ASSERT_EQUAL(CLOCK_SOURCE_SYNC_IN,
+                      clockArbiterNext(clockArbiterStep(CLOCK_SOURCE_SYNC_IN, CLOCK_SOURCE_USB, CLOCK_EVENT_STOP)));
+    TEST_ASSERT_EQUAL(CLOCK_SOURCE_DIN,
+                      clockArbiterNext(clockArbiterStep(CLOCK_SOURCE_DIN, CLOCK_SOURCE_USB, CLOCK_EVENT_STOP)));
+}
+
+// A higher source takes over on its first clock and restarts the count
+void test_takeover_resets_counter() {
+    uint8_t step = clockArbiterStep(CLOCK_SOURCE_DIN, CLOCK_SOURCE_USB, CLOCK_EVENT_CLOCK);
+    TEST_ASSERT_EQUAL(CLOCK_SOURCE_USB, clockArbiterNext(step));
+    TEST_ASSERT_TRUE(step & CLOCK_ACT_ACCEPT);
+    TEST_ASSERT_TRUE(step & CLOCK_ACT_RESET);
+
+    step = clockArbiterStep(CLOCK_SOURCE_USB, CLOCK_SOURCE_USB, CLOCK_EVENT_CLOCK);
+    TEST_ASSERT_FALSE(step & CLOCK_ACT_RESET);
+}
+
+// After the active source goes quiet the next one gets in
+void test_fallback_after_lost() {
+    uint8_t active = CLOCK_SOURCE_SYNC_IN;
+    TEST_ASSERT_FALSE(clockArbiterAccepts(active, CLOCK_SOURCE_USB));
+
+    active = clockArbiterNext(clockArbiterStep(active, CLOCK_SOURCE_SYNC_IN, CLOCK_EVENT_LOST));
+    TEST_ASSERT_EQUAL(CLOCK_SOURCE_NONE, active);
+    TEST_ASSERT_TRUE(clockArbiterAccepts(active, CLOCK_SOURCE_USB));
+    TEST_ASSERT_TRUE(clockArbiterAccepts(active, CLOCK_SOURCE_DIN));
+}
+
+// DIN THRU of clock and transport follows the same table
+void test_din_accepted_only_when_idle_or_active() {
+    TEST_ASSERT_TRUE(clockArbiterAccepts(CLOCK_SOURCE_NONE, CLOCK_SOURCE_DIN));
+    TEST_ASSERT_TRUE(clockArbiterAccepts(CLOCK_SOURCE_DIN, CLOCK_SOURCE_DIN));
+    TEST_ASSERT_FALSE(clockArbiterAccepts(CLOCK_SOURCE_USB, CLOCK_SOURCE_DIN));
+    TEST_ASSERT_FALSE(clockArbiterAccepts(CLOCK_SOURCE_SYNC_IN, CLOCK_SOURCE_DIN));
+}
+
+// Clock-lost timeout: CLOCK_LOST_TICKS of the source's own ticks, clamped
+void test_lost_timeout_follows_tick_interval() {
+    TEST_ASSERT_EQUAL_UINT16(CLOCK_LOST_MAX_MS, clockLostTimeoutMs(0));        // Interval unknown
+    TEST_ASSERT_EQUAL_UINT16(CLOCK_LOST_MIN_MS, clockLostTimeoutMs(20833));    // 24 PPQN at 120 BPM: 83 ms
+    TEST_ASSERT_EQUAL_UINT16(1000, clockLostTimeoutMs(250000));                // 2 PPQN SYNC_IN at 120 BPM
+    TEST_ASSERT_EQUAL_UINT16(CLOCK_LOST_MAX_MS, clockLostTimeoutMs(2000000));  // 1 PPQN at 30 BPM: 8 s
+    TEST_ASSERT_EQUAL_UINT16(CLOCK_LOST_MAX_MS, clockLostTimeoutMs(0xFFFFFFFFUL / CLOCK_LOST_TICKS));
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_every_transition);
+    RUN_TEST(test_no_stray_bits);
+    RUN_TEST(test_din_start_blocked_by_sync_in);
+    RUN_TEST(test_usb_transport_respects_priority);
+    RUN_TEST(test_takeover_resets_counter);
+    RUN_TEST(test_fallback_after_lost);
+    RUN_TEST(test_din_accepted_only_when_idle_or_active);
+    RUN_TEST(test_lost_timeout_follows_tick_interval);
+
+    return UNITY_END();
+}
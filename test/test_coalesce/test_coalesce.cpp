@@ -0,0 +1,180 @@
+#include <unity.h>
+#include "CoalesceQueue.h"
+
+CoalesceQueue queue;
+
+// Only continuous controllers are eligible
+void test_coalescable_types() {
+    TEST_ASSERT_TRUE(CoalesceQueue::isCoalescable(0xB0, 7));    // Volume
+    TEST_ASSERT_TRUE(CoalesceQueue::isCoalescable(0xB3, 74));   // Cutoff
+    TEST_ASSERT_TRUE(CoalesceQueue::isCoalescable(0xE0, 0));    // Pitch bend
+    TEST_ASSERT_TRUE(CoalesceQueue::isCoalescable(0xA0, 60));   // Poly AT
+    TEST_ASSERT_TRUE(CoalesceQueue::isCoalescable(0xD5, 0));    // Channel AT
+
+    TEST_ASSERT_FALSE(CoalesceQueue::isCoalescable(0x90, 60));  // Note On
+    TEST_ASSERT_FALSE(CoalesceQueue::isCoalescable(0x80, 60));  // Note Off
+    TEST_ASSERT_FALSE(CoalesceQueue::isCoalescable(0xC0, 1));   // Program
+    TEST_ASSERT_FALSE(CoalesceQueue::isCoalescable(0xF8, 0));   // Clock
+}
+
+// Order-sensitive controllers are never merged
+void test_order_sensitive_controllers() {
+    TEST_ASSERT_FALSE(CoalesceQueue::isCoalescable(0xB0, 0));    // Bank MSB
+    TEST_ASSERT_FALSE(CoalesceQueue::isCoalescable(0xB0, 32));   // Bank LSB
+    TEST_ASSERT_FALSE(CoalesceQueue::isCoalescable(0xB0, 6));    // Data entry
+    TEST_ASSERT_FALSE(CoalesceQueue::isCoalescable(0xB0, 64));   // Sustain
+    TEST_ASSERT_FALSE(CoalesceQueue::isCoalescable(0xB0, 99));   // NRPN MSB
+    TEST_ASSERT_FALSE(CoalesceQueue::isCoalescable(0xB0, 101));  // RPN MSB
+    TEST_ASSERT_FALSE(CoalesceQueue::isCoalescable(0xB0, 123));  // All notes off
+}
+
+// Nothing is held while DIN OUT has room
+void test_not_congested_passes_through() {
+    TEST_ASSERT_FALSE(queue.offer(0xB0, 7, 100, false));
+    TEST_ASSERT_TRUE(queue.isEmpty());
+}
+
+// Congestion parks a value, newer values replace it
+void test_latest_value_wins() {
+    TEST_ASSERT_TRUE(queue.offer(0xB0, 7, 10, true));
+    TEST_ASSERT_TRUE(queue.offer(0xB0, 7, 20, true));
+    TEST_ASSERT_TRUE(queue.offer(0xB0, 7, 30, true));
+
+    TEST_ASSERT_EQUAL(1, queue.size());
+    TEST_ASSERT_EQUAL(2, queue.getCoalescedCount());
+    TEST_ASSERT_EQUAL(1, queue.getParkedCount());
+
+    uint8_t status, data1, data2;
+    TEST_ASSERT_TRUE(queue.pop(status, data1, data2));
+    TEST_ASSERT_EQUAL_HEX8(0xB0, status);
+    TEST_ASSERT_EQUAL(7, data1);
+    TEST_ASSERT_EQUAL(30, data2);
+    TEST_ASSERT_FALSE(queue.pop(status, data1, data2));
+}
+
+// A pending value is replaced even after congestion clears
+void test_pending_replaced_when_not_congested() {
+    queue.offer(0xB0, 7, 10, true);
+
+    TEST_ASSERT_TRUE(queue.offer(0xB0, 7, 99, false));
+    TEST_ASSERT_EQUAL(1, queue.size());
+}
+
+// Once the slots are drained, a value for the same key goes straight out
+void test_drained_key_not_replaced() {
+    uint8_t status, data1, data2;
+    queue.offer(0xB0, 7, 10, true);
+    queue.pop(status, data1, data2);
+
+    TEST_ASSERT_FALSE(queue.offer(0xB0, 7, 20, false));
+    TEST_ASSERT_TRUE(queue.isEmpty());
+    TEST_ASSERT_EQUAL(0, queue.getCoalescedCount());
+}
+
+// Pitch bend is keyed by channel, both data bytes are replaced
+void test_pitch_bend_keyed_by_channel() {
+    queue.offer(0xE0, 0x00, 0x40, true);
+    queue.offer(0xE0, 0x7F, 0x7F, true);
+    queue.offer(0xE1, 0x00, 0x00, true);
+
+    TEST_ASSERT_EQUAL(2, queue.size());
+
+    uint8_t status, data1, data2;
+    queue.pop(status, data1, data2);
+    TEST_ASSERT_EQUAL_HEX8(0xE0, status);
+    TEST_ASSERT_EQUAL_HEX8(0x7F, data1);
+    TEST_ASSERT_EQUAL_HEX8(0x7F, data2);
+}
+
+// Different controllers and channels keep their own slot, oldest first
+void test_independent_keys_fifo() {
+    queue.offer(0xB0, 1, 10, true);   // Mod wheel ch 1
+    queue.offer(0xB0, 7, 20, true);   // Volume ch 1
+    queue.offer(0xB1, 1, 30, true);   // Mod wheel ch 2
+    queue.offer(0xA0, 60, 40, true);  // Poly AT note 60
+    queue.offer(0xA0, 61, 50, true);  // Poly AT note 61
+
+    TEST_ASSERT_EQUAL(5, queue.size());
+
+    uint8_t status, data1, data2;
+    queue.pop(status, data1, data2);
+    TEST_ASSERT_EQUAL(10, data2);
+    queue.pop(status, data1, data2);
+    TEST_ASSERT_EQUAL(20, data2);
+    queue.pop(status, data1, data2);
+    TEST_ASSERT_EQUAL(30, data2);
+    queue.pop(status, data1, data2);
+    TEST_ASSERT_EQUAL(40, data2);
+    queue.pop(status, data1, data2);
+    TEST_ASSERT_EQUAL(50, data2);
+}
+
+// Full slots hand the message back to the caller
+void test_full_slots_reject() {
+    for (uint8_t i = 0; i < COALESCE_SLOTS; i++) {
+        TEST_ASSERT_TRUE(queue.offer(0xB0, 10 + i, i, true));
+    }
+
+    TEST_ASSERT_FALSE(queue.offer(0xB0, 50, 1, true));
+
+    // Existing keys still coalesce
+    TEST_ASSERT_TRUE(queue.offer(0xB0, 10, 127, true));
+    TEST_ASSERT_EQUAL(COALESCE_SLOTS, queue.size());
+}
+
+// Notes are never absorbed, even when congested
+void test_notes_never_parked() {
+    TEST_ASSERT_FALSE(queue.offer(0x90, 60, 100, true));
+    TEST_ASSERT_FALSE(queue.offer(0x80, 60, 0, true));
+    TEST_ASSERT_TRUE(queue.isEmpty());
+}
+
+// A note flushes its own channel's parked values, oldest first, and no other
+void test_pop_channel_keeps_order() {
+    queue.offer(0xE0, 0x00, 0x50, true);   // Bend ch 1
+    queue.offer(0xB1, 1, 30, true);        // Mod wheel ch 2
+    queue.offer(0xB0, 7, 20, true);        // Volume ch 1
+
+    uint8_t status, data1, data2;
+    TEST_ASSERT_TRUE(queue.popChannel(0, status, data1, data2));
+    TEST_ASSERT_EQUAL_HEX8(0xE0, status);
+    TEST_ASSERT_EQUAL_HEX8(0x50, data2);
+    TEST_ASSERT_TRUE(queue.popChannel(0, status, data1, data2));
+    TEST_ASSERT_EQUAL_HEX8(0xB0, status);
+    TEST_ASSERT_FALSE(queue.popChannel(0, status, data1, data2));
+
+    // Channel 2 is still parked
+    TEST_ASSERT_EQUAL(1, queue.size());
+    TEST_ASSERT_TRUE(queue.pop(status, data1, data2));
+    TEST_ASSERT_EQUAL_HEX8(0xB1, status);
+}
+
+void setUp(void) {
+    queue.clear();
+}
+
+void tearDown(void) {
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    // Message classification
+    RUN_TEST(test_coalescable_types);
+    RUN_TEST(test_order_sensitive_controllers);
+
+    // Latest-value-wins behaviour
+    RUN_TEST(test_not_congested_passes_through);
+    RUN_TEST(test_latest_value_wins);
+    RUN_TEST(test_pending_replaced_when_not_congested);
+    RUN_TEST(test_drained_key_not_replaced);
+    RUN_TEST(test_pitch_bend_keyed_by_channel);
+    RUN_TEST(test_independent_keys_fifo);
+
+    // Limits
+    RUN_TEST(test_full_slots_reject);
+    RUN_TEST(test_notes_never_parked);
+    RUN_TEST(test_pop_channel_keeps_order);
+
+    return UNITY_END();
+}
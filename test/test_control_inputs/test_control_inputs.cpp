@@ -0,0 +1,78 @@
+#include <unity.h>
+#include "ControlInputs.h"
+
+// One contact per position, as wired
+void test_switch_positions() {
+    TEST_ASSERT_EQUAL_UINT8(1, controlSwitchRate(0x01, 2));
+    TEST_ASSERT_EQUAL_UINT8(2, controlSwitchRate(0x02, 1));
+    TEST_ASSERT_EQUAL_UINT8(4, controlSwitchRate(0x04, 2));
+    TEST_ASSERT_EQUAL_UINT8(6, controlSwitchRate(0x08, 2));
+    TEST_ASSERT_EQUAL_UINT8(24, controlSwitchRate(0x10, 2));
+}
+
+// Between positions nothing is closed: the rate stays where it was
+void test_switch_between_positions() {
+    TEST_ASSERT_EQUAL_UINT8(6, controlSwitchRate(0x00, 6));
+    TEST_ASSERT_EQUAL_UINT8(4, controlSwitchRate(0xE0, 4));   // Bits above the switch ignored
+}
+
+// Positions 1 + 2 together read as 1; any other overlap goes to the highest
+void test_switch_overlaps() {
+    TEST_ASSERT_EQUAL_UINT8(1, controlSwitchRate(0x03, 24));
+    TEST_ASSERT_EQUAL_UINT8(4, controlSwitchRate(0x06, 2));
+    TEST_ASSERT_EQUAL_UINT8(24, controlSwitchRate(0x11, 2));
+}
+
+// Small wobbles are held, real moves and the ends of the travel get through
+void test_pot_hysteresis() {
+    TEST_ASSERT_FALSE(controlPotMoved(100, 100));
+    TEST_ASSERT_FALSE(controlPotMoved(100, 102));
+    TEST_ASSERT_FALSE(controlPotMoved(100, 98));
+    TEST_ASSERT_TRUE(controlPotMoved(100, 103));
+    TEST_ASSERT_TRUE(controlPotMoved(100, 97));
+    TEST_ASSERT_TRUE(controlPotMoved(2, 0));
+    TEST_ASSERT_TRUE(controlPotMoved(254, 255));
+}
+
+void test_pot_ranges() {
+    TEST_ASSERT_EQUAL_UINT16(CONTROL_TEMPO_MIN_BPM, controlTempoBpm(0));
+    TEST_ASSERT_EQUAL_UINT16(CONTROL_TEMPO_MAX_BPM, controlTempoBpm(255));
+    TEST_ASSERT_EQUAL_UINT16(140, controlTempoBpm(128));
+    TEST_ASSERT_EQUAL_UINT16(CONTROL_WIDTH_MIN_US, controlPulseWidthUs(0));
+    TEST_ASSERT_EQUAL_UINT16(CONTROL_WIDTH_MAX_US, controlPulseWidthUs(255));
+}
+
+// 4 PPQN at 120 BPM: 125 ms between pulses
+void test_swing_delay() {
+    TEST_ASSERT_EQUAL_UINT32(0, controlSwingUs(125000, 0, 5000));
+    TEST_ASSERT_EQUAL_UINT32(31250, controlSwingUs(125000, 128, 5000));   // 62.5 / 37.5
+    TEST_ASSERT_EQUAL_UINT32(62255, controlSwingUs(125000, 255, 5000));   // ~75 / 25
+}
+
+// The late pulse must end before the next on-beat one starts
+void test_swing_limited_by_width() {
+    // 24 PPQN at 300 BPM: 8.3 ms between pulses, 5 ms wide
+    TEST_ASSERT_EQUAL_UINT32(2333, controlSwingUs(8333, 255, 5000));
+    // No room at all: straight
+    TEST_ASSERT_EQUAL_UINT32(0, controlSwingUs(5500, 255, 5000));
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_switch_positions);
+    RUN_TEST(test_switch_between_positions);
+    RUN_TEST(test_switch_overlaps);
+    RUN_TEST(test_pot_hysteresis);
+    RUN_TEST(test_pot_ranges);
+    RUN_TEST(test_swing_delay);
+    RUN_TEST(test_swing_limited_by_width);
+
+    return UNITY_END();
+}
@@ -0,0 +1,67 @@
+#include <unity.h>
+#include "DisplayCode.h"
+
+// 24 PPQN intervals: 120 BPM = 20833 us, 90 BPM = 27778 us
+void test_tempo_from_period() {
+    TEST_ASSERT_EQUAL_UINT16(1200, displayCodeTempo(20833));
+    TEST_ASSERT_EQUAL_UINT16(900, displayCodeTempo(27778));
+    TEST_ASSERT_EQUAL_UINT16(1275, displayCodeTempo(19608));   // 127.5 BPM
+    TEST_ASSERT_EQUAL_UINT16(0, displayCodeTempo(0));          // Unknown
+    TEST_ASSERT_EQUAL_UINT16(DISPLAY_CODE_MAX_TEMPO, displayCodeTempo(1000));
+}
+
+void test_frame_layout() {
+    uint16_t frame = displayCodeFrame(1200, 2);
+    TEST_ASSERT_EQUAL_UINT16(1200, frame >> 4);
+    TEST_ASSERT_EQUAL_UINT8(2, (frame >> 2) & 0x03);
+    TEST_ASSERT_EQUAL_UINT8(displayCodeCheck(frame >> 2), frame & 0x03);
+}
+
+void test_round_trip() {
+    uint16_t tempo;
+    uint8_t beat;
+    for (uint8_t b = 0; b < 4; b++) {
+        TEST_ASSERT_TRUE(displayCodeDecode(displayCodeFrame(1337, b), tempo, beat));
+        TEST_ASSERT_EQUAL_UINT16(1337, tempo);
+        TEST_ASSERT_EQUAL_UINT8(b, beat);
+    }
+    TEST_ASSERT_TRUE(displayCodeDecode(displayCodeFrame(DISPLAY_CODE_MAX_TEMPO, 3), tempo, beat));
+    TEST_ASSERT_EQUAL_UINT16(DISPLAY_CODE_MAX_TEMPO, tempo);
+}
+
+// Any single misread mark is caught
+void test_single_bit_errors_rejected() {
+    uint16_t frame = displayCodeFrame(1200, 1);
+    uint16_t tempo;
+    uint8_t beat;
+    for (uint8_t i = 0; i < DISPLAY_CODE_BITS; i++) {
+        TEST_ASSERT_FALSE(displayCodeDecode(frame ^ (1 << i), tempo, beat));
+    }
+}
+
+// Pulse, lead and the longest burst before the next beat
+void test_fits_before_next_beat() {
+    TEST_ASSERT_EQUAL_UINT32(17000, DISPLAY_CODE_BURST_US);
+    TEST_ASSERT_TRUE(displayCodeFits(500000, 5000));    // 120 BPM
+    TEST_ASSERT_TRUE(displayCodeFits(24000, 5000));     // 5 + 1 + 17 ms: just room
+    TEST_ASSERT_FALSE(displayCodeFits(23000, 5000));
+    TEST_ASSERT_FALSE(displayCodeFits(0, 5000));
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_tempo_from_period);
+    RUN_TEST(test_frame_layout);
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_single_bit_errors_rejected);
+    RUN_TEST(test_fits_before_next_beat);
+
+    return UNITY_END();
+}
@@ -0,0 +1,142 @@
+#include <unity.h>
+#include "EventBus.h"
+
+static BusEvent makeEvent(uint8_t port, uint8_t status, uint16_t stamp) {
+    BusEvent event = {BUS_HEADER(port, busCodeIndex(status)), status, 0x40, 0x7F, stamp};
+    return event;
+}
+
+void test_header_fields() {
+    uint8_t header = BUS_HEADER(BUS_PORT_SYNC, 0x0F);
+    TEST_ASSERT_EQUAL_UINT8(BUS_PORT_SYNC, BUS_PORT(header));
+    TEST_ASSERT_EQUAL_UINT8(0x0F, BUS_CIN(header));
+}
+
+// Same code index a USB-MIDI packet would carry
+void test_code_index() {
+    TEST_ASSERT_EQUAL_UINT8(0x09, busCodeIndex(0x93));
+    TEST_ASSERT_EQUAL_UINT8(0x0B, busCodeIndex(0xB0));
+    TEST_ASSERT_EQUAL_UINT8(0x0E, busCodeIndex(0xEF));
+    TEST_ASSERT_EQUAL_UINT8(0x02, busCodeIndex(0xF1));
+    TEST_ASSERT_EQUAL_UINT8(0x03, busCodeIndex(0xF2));
+    TEST_ASSERT_EQUAL_UINT8(0x02, busCodeIndex(0xF3));
+    TEST_ASSERT_EQUAL_UINT8(0x05, busCodeIndex(0xF6));
+    TEST_ASSERT_EQUAL_UINT8(0x0F, busCodeIndex(0xF8));
+    TEST_ASSERT_EQUAL_UINT8(0x0F, busCodeIndex(0xFC));
+}
+
+void test_event_length() {
+    TEST_ASSERT_EQUAL_UINT8(3, busEventLength(busCodeIndex(0x90)));
+    TEST_ASSERT_EQUAL_UINT8(2, busEventLength(busCodeIndex(0xC0)));
+    TEST_ASSERT_EQUAL_UINT8(2, busEventLength(busCodeIndex(0xD0)));
+    TEST_ASSERT_EQUAL_UINT8(2, busEventLength(busCodeIndex(0xF1)));
+    TEST_ASSERT_EQUAL_UINT8(3, busEventLength(busCodeIndex(0xF2)));
+    TEST_ASSERT_EQUAL_UINT8(1, busEventLength(busCodeIndex(0xF6)));
+    TEST_ASSERT_EQUAL_UINT8(1, busEventLength(busCodeIndex(0xF8)));
+    // SysEx packets: 4 = start / continue, 5-7 = end with 1-3 bytes
+    TEST_ASSERT_EQUAL_UINT8(3, busEventLength(0x04));
+    TEST_ASSERT_EQUAL_UINT8(2, busEventLength(0x06));
+    TEST_ASSERT_EQUAL_UINT8(3, busEventLength(0x07));
+}
+
+// Zero padding and stray data bytes never become events
+void test_padded_packets_rejected() {
+    TEST_ASSERT_FALSE(busIsMessage(0x00, 0x00));   // Zero padding
+    TEST_ASSERT_FALSE(busIsMessage(0x01, 0x90));   // Reserved code index
+    TEST_ASSERT_FALSE(busIsMessage(0x09, 0x00));   // Note code index, no status
+    TEST_ASSERT_FALSE(busIsMessage(0x0F, 0x40));
+    TEST_ASSERT_TRUE(busIsMessage(0x09, 0x90));
+    TEST_ASSERT_TRUE(busIsMessage(0x0F, 0xF8));
+    TEST_ASSERT_TRUE(busIsMessage(0x05, 0xF6));    // Tune request
+    // SysEx continuation and end packets carry data bytes
+    TEST_ASSERT_TRUE(busIsMessage(0x04, 0x01));
+    TEST_ASSERT_TRUE(busIsMessage(0x06, 0x7F));
+    TEST_ASSERT_TRUE(busIsMessage(0x05, 0xF7));
+    TEST_ASSERT_FALSE(busIsMessage(0x05, 0x12));
+}
+
+void test_fifo_order() {
+    EventBus bus;
+    BusEvent event;
+
+    TEST_ASSERT_TRUE(bus.isEmpty());
+    TEST_ASSERT_FALSE(bus.pop(event));
+
+    TEST_ASSERT_TRUE(bus.push(makeEvent(BUS_PORT_DIN, 0x90, 100)));
+    TEST_ASSERT_TRUE(bus.push(makeEvent(BUS_PORT_USB, 0xF8, 200)));
+    TEST_ASSERT_EQUAL_UINT8(2, bus.count());
+
+    TEST_ASSERT_TRUE(bus.pop(event));
+    TEST_ASSERT_EQUAL_UINT8(BUS_PORT_DIN, BUS_PORT(event.header));
+    TEST_ASSERT_EQUAL_UINT8(0x90, event.byte1);
+    TEST_ASSERT_EQUAL_UINT16(100, event.stamp);
+
+    TEST_ASSERT_TRUE(bus.pop(event));
+    TEST_ASSERT_EQUAL_UINT8(BUS_PORT_USB, BUS_PORT(event.header));
+    TEST_ASSERT_EQUAL_UINT16(200, event.stamp);
+    TEST_ASSERT_TRUE(bus.isEmpty());
+}
+
+// One slot stays free to tell full from empty
+void test_overflow_counted() {
+    EventBus bus;
+    for (uint16_t i = 0; i < EVENT_BUS_SIZE - 1; i++) {
+        TEST_ASSERT_TRUE(bus.push(makeEvent(BUS_PORT_DIN, 0xB0, i)));
+    }
+    TEST_ASSERT_FALSE(bus.push(makeEvent(BUS_PORT_DIN, 0xB0, 999)));
+    TEST_ASSERT_FALSE(bus.push(makeEvent(BUS_PORT_DIN, 0xB0, 999)));
+    TEST_ASSERT_EQUAL_UINT16(2, bus.getOverflows());
+    TEST_ASSERT_EQUAL_UINT8(EVENT_BUS_SIZE - 1, bus.getHighWater());
+
+    // The events already queued are untouched
+    BusEvent event;
+    TEST_ASSERT_TRUE(bus.pop(event));
+    TEST_ASSERT_EQUAL_UINT16(0, event.stamp);
+}
+
+void test_wraps_around() {
+    EventBus bus;
+    BusEvent event;
+    for (uint16_t i = 0; i < EVENT_BUS_SIZE * 3; i++) {
+        TEST_ASSERT_TRUE(bus.push(makeEvent(BUS_PORT_USB, 0x80, i)));
+        TEST_ASSERT_TRUE(bus.pop(event));
+        TEST_ASSERT_EQUAL_UINT16(i, event.stamp);
+    }
+    TEST_ASSERT_TRUE(bus.isEmpty());
+    TEST_ASSERT_EQUAL_UINT8(1, bus.getHighWater());
+    TEST_ASSERT_EQUAL_UINT16(0, bus.getOverflows());
+}
+
+// Worst time on the bus, kept per input port
+void test_latency_per_port() {
+    EventBus bus;
+    bus.recordLatency(BUS_PORT_DIN, 50);
+    bus.recordLatency(BUS_PORT_DIN, 20);
+    bus.recordLatency(BUS_PORT_SYNC, 7);
+    bus.recordLatency(BUS_PORT_COUNT, 1000);   // Not a port: ignored
+    TEST_ASSERT_EQUAL_UINT16(50, bus.getMaxLatency(BUS_PORT_DIN));
+    TEST_ASSERT_EQUAL_UINT16(0, bus.getMaxLatency(BUS_PORT_USB));
+    TEST_ASSERT_EQUAL_UINT16(7, bus.getMaxLatency(BUS_PORT_SYNC));
+    TEST_ASSERT_EQUAL_UINT16(0, bus.getMaxLatency(BUS_PORT_COUNT));
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_header_fields);
+    RUN_TEST(test_code_index);
+    RUN_TEST(test_event_length);
+    RUN_TEST(test_padded_packets_rejected);
+    RUN_TEST(test_fifo_order);
+    RUN_TEST(test_overflow_counted);
+    RUN_TEST(test_wraps_around);
+    RUN_TEST(test_latency_per_port);
+
+    return UNITY_END();
+}
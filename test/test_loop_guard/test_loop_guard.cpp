@@ -0,0 +1,133 @@
+#include <unity.h>
+#include "LoopGuard.h"
+
+#define PORT_DIN  0
+#define PORT_USB  1
+
+// Nothing sent: nothing is an echo, no flags
+void test_unrelated_traffic_passes() {
+    LoopGuard guard;
+    TEST_ASSERT_FALSE(guard.isEcho(PORT_DIN, 0x90, 60, 100, 1000, 0));
+    TEST_ASSERT_FALSE(guard.isEcho(PORT_USB, 0xF8, 0, 0, 1000, 0));
+    TEST_ASSERT_EQUAL_UINT8(0, guard.getFlags(0));
+    TEST_ASSERT_EQUAL_UINT16(0, guard.getEchoes());
+}
+
+// The first echo only counts, from the second on they are dropped
+void test_echo_confirmed_then_dropped() {
+    LoopGuard guard;
+    guard.sent(PORT_DIN, 0x90, 60, 100, 1000, 8);
+    TEST_ASSERT_FALSE(guard.isEcho(PORT_DIN, 0x90, 60, 100, 1400, 10));
+    TEST_ASSERT_EQUAL_UINT8(0, guard.getFlags(10));
+
+    guard.sent(PORT_DIN, 0x80, 60, 0, 2000, 18);
+    TEST_ASSERT_TRUE(guard.isEcho(PORT_DIN, 0x80, 60, 0, 2400, 20));
+    TEST_ASSERT_EQUAL_UINT8(1 << PORT_DIN, guard.getFlags(20));
+    TEST_ASSERT_EQUAL_UINT16(1, guard.getEchoes());
+}
+
+// Echoes are only looked for on the port the message went out on
+void test_directions_kept_apart() {
+    LoopGuard guard;
+    guard.sent(PORT_USB, 0xF8, 0, 0, 0, 0);
+    guard.sent(PORT_USB, 0xF8, 0, 0, 10, 0);
+    TEST_ASSERT_FALSE(guard.isEcho(PORT_DIN, 0xF8, 0, 0, 100, 0));
+    TEST_ASSERT_FALSE(guard.isEcho(PORT_USB, 0xF8, 0, 0, 100, 0));
+    TEST_ASSERT_TRUE(guard.isEcho(PORT_USB, 0xF8, 0, 0, 110, 0));
+    TEST_ASSERT_EQUAL_UINT8(1 << PORT_USB, guard.getFlags(0));
+}
+
+// Same message after the window: a new one, not an echo
+void test_window() {
+    LoopGuard guard;
+    guard.sent(PORT_DIN, 0xB0, 7, 64, 60000, 0);
+    guard.sent(PORT_DIN, 0xB0, 7, 64, 60001, 0);
+    TEST_ASSERT_FALSE(guard.isEcho(PORT_DIN, 0xB0, 7, 64, 60001 + LOOP_GUARD_WINDOW_TICKS + 1, 0));
+
+    // Across the 16-bit stamp wrap
+    guard.sent(PORT_DIN, 0xB0, 7, 65, 65500, 0);
+    guard.sent(PORT_DIN, 0xB0, 7, 66, 65510, 0);
+    TEST_ASSERT_FALSE(guard.isEcho(PORT_DIN, 0xB0, 7, 65, 100, 0));
+    TEST_ASSERT_TRUE(guard.isEcho(PORT_DIN, 0xB0, 7, 66, 200, 0));
+}
+
+// Each message sent absorbs one echo; a second copy is real traffic
+void test_one_echo_per_message() {
+    LoopGuard guard;
+    guard.sent(PORT_DIN, 0x90, 60, 100, 0, 0);
+    guard.sent(PORT_DIN, 0x90, 61, 100, 0, 0);
+    TEST_ASSERT_FALSE(guard.isEcho(PORT_DIN, 0x90, 60, 100, 10, 0));
+    TEST_ASSERT_TRUE(guard.isEcho(PORT_DIN, 0x90, 61, 100, 10, 0));
+    TEST_ASSERT_FALSE(guard.isEcho(PORT_DIN, 0x90, 61, 100, 20, 0));
+}
+
+// Only the last LOOP_GUARD_ENTRIES messages per port are remembered
+void test_oldest_forgotten() {
+    LoopGuard guard;
+    guard.sent(PORT_DIN, 0xC0, 1, 0, 0, 0);
+    for (uint8_t i = 0; i < LOOP_GUARD_ENTRIES; i++) {
+        guard.sent(PORT_DIN, 0xC0, 10 + i, 0, 0, 0);
+    }
+    TEST_ASSERT_FALSE(guard.isEcho(PORT_DIN, 0xC0, 1, 0, 10, 0));
+    TEST_ASSERT_FALSE(guard.isEcho(PORT_DIN, 0xC0, 10, 0, 10, 0));
+    TEST_ASSERT_TRUE(guard.isEcho(PORT_DIN, 0xC0, 11, 0, 10, 0));
+}
+
+// The flag drops once no echo came back for LOOP_GUARD_HOLD_MS
+void test_flag_clears() {
+    LoopGuard guard;
+    guard.sent(PORT_USB, 0xFA, 0, 0, 0, 100);
+    guard.sent(PORT_USB, 0xFC, 0, 0, 0, 100);
+    guard.isEcho(PORT_USB, 0xFA, 0, 0, 5, 100);
+    guard.isEcho(PORT_USB, 0xFC, 0, 0, 5, 100);
+    TEST_ASSERT_EQUAL_UINT8(1 << PORT_USB, guard.getFlags(100 + LOOP_GUARD_HOLD_MS));
+    TEST_ASSERT_EQUAL_UINT8(0, guard.getFlags(101 + LOOP_GUARD_HOLD_MS));
+
+    // Counting starts over: the next echo passes again
+    guard.sent(PORT_USB, 0xFA, 0, 0, 0, 2000);
+    TEST_ASSERT_FALSE(guard.isEcho(PORT_USB, 0xFA, 0, 0, 5, 2000));
+}
+
+// Stamps wrap every 262 ms: after a longer gap an old entry can't match a new clock
+void test_stale_entries_after_gap() {
+    LoopGuard guard;
+    for (uint8_t i = 0; i < 8; i++) {
+        guard.sent(PORT_DIN, 0xF8, 0, 0, i * 5000, i * 20);
+    }
+    // 2 s later a DIN master clocks in: every stamp lines up with one sent
+    for (uint8_t i = 0; i < 8; i++) {
+        TEST_ASSERT_FALSE(guard.isEcho(PORT_DIN, 0xF8, 0, 0, i * 5000 + 10, 2000 + i * 20));
+    }
+    TEST_ASSERT_EQUAL_UINT8(0, guard.getFlags(2200));
+
+    // One wrap (262 ms) on, the same stamp is a new clock
+    guard.sent(PORT_DIN, 0xF8, 0, 0, 100, 3000);
+    TEST_ASSERT_FALSE(guard.isEcho(PORT_DIN, 0xF8, 0, 0, 110, 3262));
+
+    // Echoes that do come back in time are still caught
+    guard.sent(PORT_DIN, 0xF8, 0, 0, 200, 4000);
+    guard.sent(PORT_DIN, 0xF8, 0, 0, 300, 4000);
+    TEST_ASSERT_FALSE(guard.isEcho(PORT_DIN, 0xF8, 0, 0, 400, 4001));
+    TEST_ASSERT_TRUE(guard.isEcho(PORT_DIN, 0xF8, 0, 0, 400, 4001));
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_unrelated_traffic_passes);
+    RUN_TEST(test_echo_confirmed_then_dropped);
+    RUN_TEST(test_directions_kept_apart);
+    RUN_TEST(test_window);
+    RUN_TEST(test_one_echo_per_message);
+    RUN_TEST(test_oldest_forgotten);
+    RUN_TEST(test_flag_clears);
+    RUN_TEST(test_stale_entries_after_gap);
+
+    return UNITY_END();
+}
@@ -0,0 +1,66 @@
+#include <unity.h>
+#include "OscillatorDrift.h"
+
+// 8192 frames counted as 8192 ms of local time: no drift
+void test_exact_window() {
+    TEST_ASSERT_EQUAL_INT32(0, driftPpm(8192, 8192000UL));
+}
+
+// A fast timer counts more local us per frame
+void test_fast_and_slow_timer() {
+    TEST_ASSERT_EQUAL_INT32(100, driftPpm(10000, 10001000UL));
+    TEST_ASSERT_EQUAL_INT32(-250, driftPpm(8000, 7998000UL));
+    TEST_ASSERT_EQUAL_INT32(5000, driftPpm(8192, 8232960UL));
+}
+
+// No frames, nothing measured
+void test_empty_window() {
+    TEST_ASSERT_EQUAL_INT32(0, driftPpm(0, 1234));
+}
+
+// Windows far outside a resonator's tolerance are thrown away
+void test_plausibility() {
+    TEST_ASSERT_TRUE(driftPlausible(0));
+    TEST_ASSERT_TRUE(driftPlausible(-DRIFT_MAX_PPM));
+    TEST_ASSERT_TRUE(driftPlausible(DRIFT_MAX_PPM));
+    TEST_ASSERT_FALSE(driftPlausible(DRIFT_MAX_PPM + 1));
+    // A frame lost to a bus reset: the window is a whole ms longer than its count
+    TEST_ASSERT_FALSE(driftPlausible(driftPpm(100, 101000UL)));
+}
+
+// First window sets the estimate, later ones move it a quarter of the way
+void test_filter() {
+    TEST_ASSERT_EQUAL_INT16(120, driftFilter(0, 120, true));
+    TEST_ASSERT_EQUAL_INT16(130, driftFilter(120, 160, false));
+    TEST_ASSERT_EQUAL_INT16(110, driftFilter(120, 80, false));
+    TEST_ASSERT_EQUAL_INT16(-300, driftFilter(-300, -300, false));
+}
+
+// Real intervals become local timer intervals
+void test_local_us() {
+    TEST_ASSERT_EQUAL_UINT32(5000, driftLocalUs(5000, 0));
+    // 5 ms pulse on a timer 0.5 % fast: 25 us more local time
+    TEST_ASSERT_EQUAL_UINT32(5025, driftLocalUs(5000, 5000));
+    TEST_ASSERT_EQUAL_UINT32(4975, driftLocalUs(5000, -5000));
+    // 10 s at 100 ppm: 1 ms
+    TEST_ASSERT_EQUAL_UINT32(10001000UL, driftLocalUs(10000000UL, 100));
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_exact_window);
+    RUN_TEST(test_fast_and_slow_timer);
+    RUN_TEST(test_empty_window);
+    RUN_TEST(test_plausibility);
+    RUN_TEST(test_filter);
+    RUN_TEST(test_local_us);
+
+    return UNITY_END();
+}
@@ -0,0 +1,132 @@
+#include <unity.h>
+#include "RouteTable.h"
+
+RouteTable table;
+
+void clearTable() {
+    for (uint8_t s = 0; s < ROUTE_SOURCE_COUNT; s++) {
+        for (uint8_t d = 0; d < ROUTE_DEST_COUNT; d++) {
+            for (uint8_t r = 0; r < ROUTE_ROWS; r++) {
+                table.setMask(s, d, r, 0);
+            }
+        }
+    }
+}
+
+// Empty table blocks everything
+void test_empty_table_blocks_all() {
+    for (int status = 0x80; status <= 0xFF; status++) {
+        TEST_ASSERT_FALSE(table.allows(ROUTE_SRC_USB, ROUTE_DST_DIN, (uint8_t)status));
+    }
+}
+
+// Each channel message row maps to its own status nibble
+void test_channel_rows_map_to_status() {
+    // Allow only Control Change (row 3)
+    table.setMask(ROUTE_SRC_USB, ROUTE_DST_DIN, 3, ROUTE_ALL_CHANNELS);
+
+    TEST_ASSERT_TRUE(table.allows(ROUTE_SRC_USB, ROUTE_DST_DIN, 0xB0));
+    TEST_ASSERT_TRUE(table.allows(ROUTE_SRC_USB, ROUTE_DST_DIN, 0xBF));
+    TEST_ASSERT_FALSE(table.allows(ROUTE_SRC_USB, ROUTE_DST_DIN, 0x90));
+    TEST_ASSERT_FALSE(table.allows(ROUTE_SRC_USB, ROUTE_DST_DIN, 0xE0));
+}
+
+// Channel bits filter individual MIDI channels
+void test_channel_filter() {
+    // Note On, channels 1 and 10 only
+    table.setMask(ROUTE_SRC_DIN, ROUTE_DST_USB, 1, 0x0201);
+
+    TEST_ASSERT_TRUE(table.allows(ROUTE_SRC_DIN, ROUTE_DST_USB, 0x90));   // Ch 1
+    TEST_ASSERT_TRUE(table.allows(ROUTE_SRC_DIN, ROUTE_DST_USB, 0x99));   // Ch 10
+    TEST_ASSERT_FALSE(table.allows(ROUTE_SRC_DIN, ROUTE_DST_USB, 0x91));  // Ch 2
+    TEST_ASSERT_FALSE(table.allows(ROUTE_SRC_DIN, ROUTE_DST_USB, 0x9F));  // Ch 16
+}
+
+// Filtering aftertouch keeps notes flowing
+void test_filter_aftertouch_only() {
+    for (uint8_t r = 0; r < ROUTE_ROW_SYSTEM; r++) {
+        table.setMask(ROUTE_SRC_USB, ROUTE_DST_DIN, r, ROUTE_ALL_CHANNELS);
+    }
+    table.setMask(ROUTE_SRC_USB, ROUTE_DST_DIN, 2, 0);  // Poly aftertouch
+    table.setMask(ROUTE_SRC_USB, ROUTE_DST_DIN, 5, 0);  // Channel aftertouch
+
+    TEST_ASSERT_TRUE(table.allows(ROUTE_SRC_USB, ROUTE_DST_DIN, 0x90));
+    TEST_ASSERT_TRUE(table.allows(ROUTE_SRC_USB, ROUTE_DST_DIN, 0xE3));
+    TEST_ASSERT_FALSE(table.allows(ROUTE_SRC_USB, ROUTE_DST_DIN, 0xA0));
+    TEST_ASSERT_FALSE(table.allows(ROUTE_SRC_USB, ROUTE_DST_DIN, 0xD7));
+}
+
+// System classes cover every status byte in the class
+void test_system_classes() {
+    table.setMask(ROUTE_SRC_DIN, ROUTE_DST_DIN, ROUTE_ROW_SYSTEM, ROUTE_SYS_TRANSPORT | ROUTE_SYS_COMMON);
+
+    TEST_ASSERT_TRUE(table.allows(ROUTE_SRC_DIN, ROUTE_DST_DIN, 0xFA));
+    TEST_ASSERT_TRUE(table.allows(ROUTE_SRC_DIN, ROUTE_DST_DIN, 0xFB));
+    TEST_ASSERT_TRUE(table.allows(ROUTE_SRC_DIN, ROUTE_DST_DIN, 0xFC));
+    TEST_ASSERT_TRUE(table.allows(ROUTE_SRC_DIN, ROUTE_DST_DIN, 0xF1));
+    TEST_ASSERT_TRUE(table.allows(ROUTE_SRC_DIN, ROUTE_DST_DIN, 0xF2));
+    TEST_ASSERT_TRUE(table.allows(ROUTE_SRC_DIN, ROUTE_DST_DIN, 0xF3));
+    TEST_ASSERT_TRUE(table.allows(ROUTE_SRC_DIN, ROUTE_DST_DIN, 0xF6));
+
+    TEST_ASSERT_FALSE(table.allows(ROUTE_SRC_DIN, ROUTE_DST_DIN, 0xF8));  // Clock
+    TEST_ASSERT_FALSE(table.allows(ROUTE_SRC_DIN, ROUTE_DST_DIN, 0xFE));  // Active Sensing
+    TEST_ASSERT_FALSE(table.allows(ROUTE_SRC_DIN, ROUTE_DST_DIN, 0xF0));  // SysEx
+
+    // System row must not leak into channel rows
+    TEST_ASSERT_FALSE(table.allows(ROUTE_SRC_DIN, ROUTE_DST_DIN, 0x93));
+}
+
+// Active Sensing can be dropped while clock still passes
+void test_filter_active_sensing() {
+    table.setMask(ROUTE_SRC_DIN, ROUTE_DST_DIN, ROUTE_ROW_SYSTEM, ROUTE_SYS_CLOCK);
+
+    TEST_ASSERT_TRUE(table.allows(ROUTE_SRC_DIN, ROUTE_DST_DIN, 0xF8));
+    TEST_ASSERT_FALSE(table.allows(ROUTE_SRC_DIN, ROUTE_DST_DIN, 0xFE));
+}
+
+// Undefined system bytes are never routed
+void test_undefined_status_blocked() {
+    table.setMask(ROUTE_SRC_USB, ROUTE_DST_DIN, ROUTE_ROW_SYSTEM, 0xFFFF);
+
+    TEST_ASSERT_FALSE(table.allows(ROUTE_SRC_USB, ROUTE_DST_DIN, 0xF4));
+    TEST_ASSERT_FALSE(table.allows(ROUTE_SRC_USB, ROUTE_DST_DIN, 0xF5));
+    TEST_ASSERT_FALSE(table.allows(ROUTE_SRC_USB, ROUTE_DST_DIN, 0xF9));
+    TEST_ASSERT_FALSE(table.allows(ROUTE_SRC_USB, ROUTE_DST_DIN, 0xFD));
+}
+
+// Routes are independent of each other
+void test_routes_are_independent() {
+    table.setMask(ROUTE_SRC_DIN, ROUTE_DST_USB, 1, ROUTE_ALL_CHANNELS);
+
+    TEST_ASSERT_TRUE(table.allows(ROUTE_SRC_DIN, ROUTE_DST_USB, 0x90));
+    TEST_ASSERT_FALSE(table.allows(ROUTE_SRC_DIN, ROUTE_DST_DIN, 0x90));
+    TEST_ASSERT_FALSE(table.allows(ROUTE_SRC_USB, ROUTE_DST_DIN, 0x90));
+    TEST_ASSERT_FALSE(table.allows(ROUTE_SRC_SYNC, ROUTE_DST_USB, 0x90));
+}
+
+void setUp(void) {
+    clearTable();
+}
+
+void tearDown(void) {
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    // Channel message routing
+    RUN_TEST(test_empty_table_blocks_all);
+    RUN_TEST(test_channel_rows_map_to_status);
+    RUN_TEST(test_channel_filter);
+    RUN_TEST(test_filter_aftertouch_only);
+
+    // System message routing
+    RUN_TEST(test_system_classes);
+    RUN_TEST(test_filter_active_sensing);
+    RUN_TEST(test_undefined_status_blocked);
+
+    // Route isolation
+    RUN_TEST(test_routes_are_independent);
+
+    return UNITY_END();
+}
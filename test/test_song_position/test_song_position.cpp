@@ -0,0 +1,183 @@
+#include <unity.h>
+#include "SongPosition.h"
+#include "AnalogOutputs.h"
+
+// DISPLAY_CLK at 1 PPQN and a 4 PPQN output, as in config.h
+static const AnalogOutputConfig outputs[] = {
+    { 4, ANALOG_MODE_CLOCK, 24, 5000, false },
+    { 1, ANALOG_MODE_CLOCK, 6, 5000, false },
+};
+#define COUNT  2
+#define DISPLAY_CLK  0x01
+
+// SYNC_OUT divisors for the 1, 2, 4, 6 and 24 PPQN switch positions
+static const uint8_t divisors[] = { 24, 12, 6, 4, 1 };
+
+// Sync's position state, stepped the way Sync steps it
+static uint16_t position;
+static uint8_t tick;
+static uint8_t counter;
+static uint8_t phase[COUNT];
+
+static void locate(uint16_t beats) {
+    position = beats & SONG_POSITION_MASK;
+    tick = 0;
+    counter = songQuarterCounter(position, tick);
+    analogRebase(outputs, COUNT, phase, songClocks(position, tick));
+}
+
+// The arbiter's reset: only a Start rewinds, anything else resumes on the position
+static void reset(bool start) {
+    if (start) {
+        position = 0;
+        tick = 0;
+    }
+    counter = songQuarterCounter(position, tick);
+    analogRebase(outputs, COUNT, phase, songClocks(position, tick));
+}
+
+// One clock: true if SYNC_OUT pulses on it; the analog edges go to *rising
+static bool clock(uint8_t divisor, uint8_t* rising) {
+    bool syncOut = counter % divisor == 0;
+    *rising = analogTick(outputs, COUNT, phase);
+    if (++counter >= 24) counter = 0;
+    songAdvance(position, tick);
+    return syncOut;
+}
+
+// Clocks until the first SYNC_OUT edge (0 = on the next clock)
+static uint8_t firstSyncOut(uint8_t divisor) {
+    uint8_t rising;
+    for (uint8_t n = 0; n < 24; n++) {
+        if (clock(divisor, &rising)) return n;
+    }
+    return 0xFF;
+}
+
+// Clocks until the first edge of an analog output
+static uint8_t firstAnalog(uint8_t output) {
+    uint8_t rising;
+    for (uint8_t n = 0; n < 24; n++) {
+        clock(1, &rising);
+        if (rising & output) return n;
+    }
+    return 0xFF;
+}
+
+// Clocks from a song position to the next multiple of a divisor
+static uint8_t toGrid(uint16_t beats, uint8_t divisor) {
+    uint32_t clocks = songClocks(beats, 0);
+    return (divisor - clocks % divisor) % divisor;
+}
+
+void test_quarter_counter() {
+    TEST_ASSERT_EQUAL_UINT8(0, songQuarterCounter(0, 0));
+    TEST_ASSERT_EQUAL_UINT8(6, songQuarterCounter(1, 0));
+    TEST_ASSERT_EQUAL_UINT8(23, songQuarterCounter(3, 5));
+    TEST_ASSERT_EQUAL_UINT8(12, songQuarterCounter(6, 0));   // Bar 1, beat 2, second 16th
+    TEST_ASSERT_EQUAL_UINT8(18, songQuarterCounter(SONG_POSITION_MASK, 0));
+}
+
+void test_song_clocks() {
+    TEST_ASSERT_EQUAL_UINT32(0, songClocks(0, 0));
+    TEST_ASSERT_EQUAL_UINT32(33, songClocks(5, 3));
+    TEST_ASSERT_EQUAL_UINT32(98302UL, songClocks(SONG_POSITION_MASK, 4));
+}
+
+// The position wraps with the 14-bit SPP
+void test_advance_wraps() {
+    uint16_t p = SONG_POSITION_MASK;
+    uint8_t t = SONG_CLOCKS_PER_BEAT - 1;
+    songAdvance(p, t);
+    TEST_ASSERT_EQUAL_UINT16(0, p);
+    TEST_ASSERT_EQUAL_UINT8(0, t);
+}
+
+// Bar 2, beat 2, second 16th: 1 PPQN waits for beat 3, 4 PPQN pulses at once
+void test_spp_mid_beat_then_continue() {
+    locate(5);
+    reset(false);
+    TEST_ASSERT_EQUAL_UINT8(18, firstSyncOut(24));
+    locate(5);
+    reset(false);
+    TEST_ASSERT_EQUAL_UINT8(0, firstSyncOut(6));
+    locate(5);
+    reset(false);
+    TEST_ASSERT_EQUAL_UINT8(18, firstAnalog(DISPLAY_CLK));
+}
+
+// Every 16th and every divisor: the first edges after Continue are on the song grid
+void test_first_edges_on_grid() {
+    static const uint16_t spps[] = { 0, 1, 2, 3, 4, 7, 9, 14, 255, 1000, SONG_POSITION_MASK };
+    for (uint8_t s = 0; s < sizeof(spps) / sizeof(spps[0]); s++) {
+        for (uint8_t d = 0; d < sizeof(divisors); d++) {
+            locate(spps[s]);
+            reset(false);
+            TEST_ASSERT_EQUAL_UINT8(toGrid(spps[s], divisors[d]), firstSyncOut(divisors[d]));
+        }
+        locate(spps[s]);
+        reset(false);
+        TEST_ASSERT_EQUAL_UINT8(toGrid(spps[s], 24), firstAnalog(DISPLAY_CLK));
+        locate(spps[s]);
+        reset(false);
+        TEST_ASSERT_EQUAL_UINT8(toGrid(spps[s], 6), firstAnalog(0x02));
+    }
+}
+
+// Start ignores an earlier SPP: edges count from the song start
+void test_start_rewinds() {
+    locate(7);
+    reset(true);
+    TEST_ASSERT_EQUAL_UINT8(0, firstSyncOut(24));
+    TEST_ASSERT_EQUAL_UINT16(0, position);
+}
+
+// Stopped mid-beat and continued: the edges keep the spacing they had
+void test_stop_mid_beat_then_continue() {
+    uint8_t rising;
+    reset(true);
+    for (uint8_t n = 0; n < 31; n++) clock(12, &rising);
+    // Stop keeps position and tick; Continue resumes from them
+    reset(false);
+    TEST_ASSERT_EQUAL_UINT8(5, firstSyncOut(12));
+    reset(true);
+    for (uint8_t n = 0; n < 31; n++) clock(1, &rising);
+    reset(false);
+    TEST_ASSERT_EQUAL_UINT8(17, firstAnalog(DISPLAY_CLK));
+}
+
+// A source lost for a moment and retaking with clocks alone stays on the song grid
+void test_lost_then_retake() {
+    uint8_t rising;
+    for (uint8_t output = 0; output < 2; output++) {
+        locate(9);
+        reset(false);
+        for (uint8_t n = 0; n < 7; n++) clock(24, &rising);
+        reset(false);   // Lost
+        reset(false);   // First clock back takes over
+        TEST_ASSERT_EQUAL_UINT16(10, position);
+        // Song clock 61: the next quarter is 11 clocks on
+        TEST_ASSERT_EQUAL_UINT8(11, output ? firstAnalog(DISPLAY_CLK) : firstSyncOut(24));
+    }
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_quarter_counter);
+    RUN_TEST(test_song_clocks);
+    RUN_TEST(test_advance_wraps);
+    RUN_TEST(test_spp_mid_beat_then_continue);
+    RUN_TEST(test_first_edges_on_grid);
+    RUN_TEST(test_start_rewinds);
+    RUN_TEST(test_stop_mid_beat_then_continue);
+    RUN_TEST(test_lost_then_retake);
+
+    return UNITY_END();
+}
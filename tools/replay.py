@@ -0,0 +1,163 @@
+#!/usr/bin/env python3
+"""
+Replay captures through the host build and diff the outputs against goldens.
+
+Each capture (host/captures/*.bpc) is run through the firmware compiled for the
+PC (`pio run -e replay`); its output log is compared with <capture>.golden:
+  - byte streams (DIN OUT bytes, USB packets, pin edges) must match exactly
+  - matched events may move in time by at most --tolerance-us
+  - clock jitter (std. dev. of the clock / rising-edge interval) may grow by at
+    most --jitter-us
+A per-stream latency and jitter report is printed either way.
+
+    pio run -e replay
+    python3 tools/replay.py                       # all captures
+    python3 tools/replay.py host/captures/gig.bpc --tolerance-us 500
+    python3 tools/replay.py --update              # accept current output as golden
+
+Record a capture on the device with trace_decode.py --capture.
+"""
+import argparse
+import difflib
+import glob
+import math
+import os
+import subprocess
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+DEFAULT_BINARY = os.path.join(ROOT, ".pio", "build", "replay", "program")
+
+
+def run_capture(binary, capture, loop_us):
+    result = subprocess.run([binary, "--loop-us", str(loop_us), capture],
+                            stdout=subprocess.PIPE, stderr=subprocess.PIPE, universal_newlines=True)
+    if result.returncode != 0:
+        raise RuntimeError("%s failed:\n%s" % (capture, result.stderr))
+    return result.stdout
+
+
+def parse_log(text):
+    """Split an output log into {stream: [(time_us, value)]}."""
+    streams = {}
+    for line in text.splitlines():
+        parts = line.split()
+        if len(parts) < 3:
+            continue
+        t, kind, rest = int(parts[0]), parts[1], parts[2:]
+        if kind == "pin":
+            key, value = "pin " + rest[0], rest[1]
+        else:
+            key, value = kind, " ".join(rest)
+        streams.setdefault(key, []).append((t, value))
+
+        # Timing-only views used for the jitter figures
+        if kind == "din" and value == "F8":
+            streams.setdefault("din clock", []).append((t, value))
+        elif kind == "usb" and rest[1] == "F8":
+            streams.setdefault("usb clock", []).append((t, value))
+        elif kind == "pin" and value == "1":
+            streams.setdefault(key + " rise", []).append((t, value))
+    return streams
+
+
+def jitter(events):
+    intervals = [b[0] - a[0] for a, b in zip(events, events[1:])]
+    if len(intervals) < 2:
+        return None
+    mean = sum(intervals) / len(intervals)
+    return math.sqrt(sum((i - mean) ** 2 for i in intervals) / len(intervals))
+
+
+def compare_stream(golden, new):
+    matcher = difflib.SequenceMatcher(None, [v for _, v in golden], [v for _, v in new], autojunk=False)
+    deltas = []
+    changed = 0
+    for tag, g0, g1, n0, n1 in matcher.get_opcodes():
+        if tag == "equal":
+            deltas += [new[n0 + i][0] - golden[g0 + i][0] for i in range(g1 - g0)]
+        else:
+            changed += max(g1 - g0, n1 - n0)
+    return changed, deltas
+
+
+def fmt(value, spec="%+.1f"):
+    return "-" if value is None else spec % value
+
+
+def report(name, golden, new, args, out):
+    failed = False
+    out.write("%s\n" % name)
+    out.write("  %-20s %7s %7s %9s %9s %20s  %s\n" %
+              ("stream", "events", "changed", "mean dt", "max |dt|", "jitter golden->new", "result"))
+
+    for key in sorted(set(golden) | set(new)):
+        g, n = golden.get(key, []), new.get(key, [])
+        changed, deltas = compare_stream(g, n)
+        mean = sum(deltas) / len(deltas) if deltas else None
+        worst = max(abs(d) for d in deltas) if deltas else None
+
+        timing_view = key.endswith(" clock") or key.endswith(" rise")
+        jg, jn = (jitter(g), jitter(n)) if timing_view else (None, None)
+
+        problems = []
+        if changed and not timing_view:
+            problems.append("content")
+        if worst is not None and worst > args.tolerance_us:
+            problems.append("latency")
+        if jg is not None and jn is not None and jn - jg > args.jitter_us:
+            problems.append("jitter")
+        failed |= bool(problems)
+
+        out.write("  %-20s %7d %7d %9s %9s %9s -> %-8s  %s\n" % (
+            key, len(n), changed, fmt(mean), fmt(worst, "%.0f"),
+            fmt(jg, "%.1f"), fmt(jn, "%.1f"), ", ".join(problems) or "ok"))
+    return failed
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("captures", nargs="*", help="capture files (default: host/captures/*.bpc)")
+    parser.add_argument("--binary", default=DEFAULT_BINARY, help="replay executable (default: %(default)s)")
+    parser.add_argument("--loop-us", type=int, default=20, help="simulated loop() pass duration")
+    parser.add_argument("--tolerance-us", type=float, default=200, help="max time shift of any output event")
+    parser.add_argument("--jitter-us", type=float, default=50, help="max growth of clock interval std. dev.")
+    parser.add_argument("--update", action="store_true", help="write the current output as the new goldens")
+    args = parser.parse_args()
+
+    captures = args.captures or sorted(glob.glob(os.path.join(ROOT, "host", "captures", "*.bpc")))
+    if not captures:
+        sys.exit("no captures found")
+    if not os.path.exists(args.binary):
+        sys.exit("%s not found - build it with: pio run -e replay" % args.binary)
+
+    failed = []
+    for capture in captures:
+        output = run_capture(args.binary, capture, args.loop_us)
+        golden_path = os.path.splitext(capture)[0] + ".golden"
+        name = os.path.basename(capture)
+
+        if args.update:
+            with open(golden_path, "w") as f:
+                f.write(output)
+            print("%s: golden updated" % name)
+            continue
+        if not os.path.exists(golden_path):
+            print("%s: no golden, run with --update on a known-good build\n" % name)
+            failed.append(name)
+            continue
+
+        with open(golden_path) as f:
+            golden = parse_log(f.read())
+        if report(name, golden, parse_log(output), args, sys.stdout):
+            failed.append(name)
+        print()
+
+    if failed:
+        sys.exit("FAILED: " + ", ".join(failed))
+    if not args.update:
+        print("all %d captures within tolerance" % len(captures))
+
+
+if __name__ == "__main__":
+    main()
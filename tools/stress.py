@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+"""
+Sweep traffic load through the host build and report where the router gives out.
+
+Each point runs the firmware compiled for the PC (`pio run -e stress`) for a few
+simulated seconds: a USB host clocks at 300 BPM on cable 1 while one message mix
+(notes, CC floods, 64-byte SysEx dumps) is sent at a fixed rate USB -> DIN,
+DIN -> USB or both ways. Per mix and direction a table shows, with rising rate:
+  - messages offered / delivered and the firmware's drop counters
+    (DIN RX overflows, USB IN drops, CCs coalesced on congested DIN OUT)
+  - high-water marks of the DIN TX / RX rings, the USB IN queue and the
+    backlog the host had to hold back because the OUT banks were full
+  - the USB clock -> DIN clock latency, its jitter and clocks lost
+The highest rate delivered without loss is reported as the sustained rate.
+For reference, DIN carries at most ~1040 three-byte messages/s (~1560 with
+running status) or ~48 64-byte SysEx dumps/s.
+
+    pio run -e stress
+    python3 tools/stress.py
+    python3 tools/stress.py --mix cc --dir usb2din --rates 500,1000,1500
+"""
+import argparse
+import os
+import subprocess
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+DEFAULT_BINARY = os.path.join(ROOT, ".pio", "build", "stress", "program")
+
+MIXES = ("notes", "cc", "sysex")
+DIRECTIONS = ("usb2din", "din2usb", "both")
+DEFAULT_RATES = {
+    "notes": (100, 250, 500, 750, 1000, 1250, 1500, 2000, 3000, 5000),
+    "cc": (100, 250, 500, 750, 1000, 1250, 1500, 2000, 3000, 5000),
+    "sysex": (5, 10, 20, 30, 40, 50, 60, 80),
+}
+
+COLUMNS = (
+    ("rate/s", None, 7),
+    ("deliv", "delivered", 7),
+    ("rx_ovf", "din_rx_overflow", 7),
+    ("usb_drop", "usb_drop_full", 8),
+    ("coalesc", "coalesced", 7),
+    ("dinTX", "din_tx_hw", 5),
+    ("dinRX", "din_rx_hw", 5),
+    ("usbTX", "usb_tx_hw", 5),
+    ("hostQ", "usb_out_backlog_hw", 6),
+    ("loop_us", "max_loop_us", 7),
+    ("clk_lat", "clock_latency_mean_us", 7),
+    ("clk_max", "clock_latency_max_us", 7),
+    ("jitter", "clock_jitter_us", 8),
+    ("clk_lost", None, 8),
+)
+
+
+def run_point(binary, mix, direction, rate, seconds):
+    result = subprocess.run([binary, "--mix", mix, "--dir", direction, "--rate", str(rate),
+                             "--seconds", str(seconds)],
+                            stdout=subprocess.PIPE, stderr=subprocess.PIPE, universal_newlines=True)
+    if result.returncode != 0:
+        raise RuntimeError("%s %s %s failed:\n%s" % (mix, direction, rate, result.stderr))
+    values = {}
+    for field in result.stdout.split():
+        key, _, value = field.partition("=")
+        values[key] = float(value)
+    return values
+
+
+def lossless(values):
+    return (values["delivered"] == values["offered"] and values["din_rx_overflow"] == 0 and
+            values["usb_drop_full"] == 0 and values["coalesced"] == 0 and
+            values["clock_out"] == values["clock_in"])
+
+
+def sweep(binary, mix, direction, rates, seconds):
+    print("\n%s %s" % (mix, direction))
+    print("  ".join(name.rjust(width) for name, _, width in COLUMNS))
+
+    sustained = 0
+    for rate in rates:
+        values = run_point(binary, mix, direction, rate, seconds)
+        cells = []
+        for name, key, width in COLUMNS:
+            if name == "rate/s":
+                text = str(rate)
+            elif name == "clk_lost":
+                text = "%d" % (values["clock_in"] - values["clock_out"])
+            else:
+                text = "%g" % values[key]
+            cells.append(text.rjust(width))
+        ok = lossless(values)
+        print("  ".join(cells) + ("" if ok else "  loss"))
+        if ok and sustained == rate_before(rates, rate):
+            sustained = rate
+    print("sustained: %s msgs/s" % (sustained if sustained else "< %s" % rates[0]))
+    return sustained
+
+
+def rate_before(rates, rate):
+    index = rates.index(rate)
+    return rates[index - 1] if index else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    parser.add_argument("--binary", default=DEFAULT_BINARY, help="host stress build")
+    parser.add_argument("--mix", choices=MIXES, action="append", help="message mix (default all)")
+    parser.add_argument("--dir", choices=DIRECTIONS, action="append", help="direction (default all)")
+    parser.add_argument("--rates", help="comma-separated messages/s (default per mix)")
+    parser.add_argument("--seconds", type=float, default=2, help="simulated seconds per point")
+    args = parser.parse_args()
+
+    if not os.path.exists(args.binary):
+        sys.exit("%s not found - run `pio run -e stress` first" % args.binary)
+
+    summary = []
+    for mix in args.mix or MIXES:
+        rates = [int(r) for r in args.rates.split(",")] if args.rates else list(DEFAULT_RATES[mix])
+        for direction in args.dir or DIRECTIONS:
+            summary.append((mix, direction, sweep(args.binary, mix, direction, rates, args.seconds)))
+
+    print("\nsustained messages/s before loss")
+    for mix, direction, sustained in summary:
+        print("  %-6s %-8s %s" % (mix, direction, sustained if sustained else "-"))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,176 @@
+#!/usr/bin/env python3
+"""
+Decode BytePulse trace SysEx (F0 7D 42 50 17 ... F7) into a timeline.
+
+Capture with any SysEx recorder after enabling the stream (F0 7D 42 50 16 01 F7), e.g.
+    amidi -p hw:1,0,0 -S "F0 7D 42 50 16 01 F7" -r trace.syx
+    python3 tools/trace_decode.py trace.syx
+
+Accepts raw .syx files or hex text dumps (as printed by `amidi -d`); '-' reads stdin.
+
+Replay captures: stream with raw input recording (16 02) and convert the DIN bytes,
+USB packets and SYNC_IN edges into a capture file for tools/replay.py:
+    amidi -p hw:1,0,0 -S "F0 7D 42 50 16 02 F7" -r gig.syx
+    python3 tools/trace_decode.py gig.syx --capture host/captures/gig.bpc --rate 2
+"""
+import argparse
+import re
+import sys
+
+HEADER = [0xF0, 0x7D, 0x42, 0x50, 0x17]
+US_PER_TICK = 4
+
+CLOCK_SOURCES = {0: "none", 1: "SYNC_IN", 2: "DIN", 3: "USB"}
+BUFFERS = {0: "DIN RX full", 1: "USB dropped (host not reading)"}
+
+EVENTS = {
+    0x01: ("epoch", None),
+    0x02: ("LOST", lambda a: "%d events" % a),
+    0x10: ("clock in", CLOCK_SOURCES.get),
+    0x11: ("clock out", lambda a: "from " + CLOCK_SOURCES.get(a, str(a))),
+    0x12: ("start", CLOCK_SOURCES.get),
+    0x13: ("stop", CLOCK_SOURCES.get),
+    0x14: ("source", CLOCK_SOURCES.get),
+    0x15: ("sync rate", lambda a: "%d PPQN" % a),
+    0x16: ("feedback loop", lambda a: "echo on %s" % (["none", "DIN", "USB", "DIN + USB"][a & 3])),
+    0x20: ("SYNC_IN edge", None),
+    0x21: ("SYNC_OUT", lambda a: "high" if a else "low"),
+    0x22: ("analog outs", lambda a: "active %s" % format(a, "03b")),
+    0x30: ("OVERFLOW", lambda a: BUFFERS.get(a, str(a))),
+    0x40: ("DIN in", lambda a: "%02X" % a),
+    0x41: ("USB in", lambda a: "%d packets" % a),
+}
+
+EV_EPOCH, EV_LOST, EV_SYNC_IN = 0x01, 0x02, 0x20
+EV_DIN_RX, EV_USB_RX, EV_USB_PACKET = 0x40, 0x41, 0x60
+CAPTURE_LEAD_IN_US = 10000   # Replay starts the first input after setup() has run
+
+
+def read_bytes(path):
+    data = sys.stdin.buffer.read() if path == "-" else open(path, "rb").read()
+    # Hex text if it only contains hex digits and whitespace
+    text = data.decode("ascii", "ignore")
+    if data and re.fullmatch(r"[0-9A-Fa-f\s]+", text):
+        return bytes(int(tok, 16) for tok in text.split())
+    return data
+
+
+def messages(data):
+    start = None
+    for i, b in enumerate(data):
+        if b == 0xF0:
+            start = i
+        elif b == 0xF7 and start is not None:
+            yield data[start:i + 1]
+            start = None
+
+
+def events(data):
+    for msg in messages(data):
+        if list(msg[:len(HEADER)]) != HEADER:
+            continue
+        body = msg[len(HEADER):-1]
+        for i in range(0, len(body) - 4, 5):
+            ev, a0, a1, s0, s1 = body[i:i + 5]
+            arg = a0 | ((a1 & 0x01) << 7)
+            stamp = s0 | (s1 << 7) | ((a1 >> 1) << 14)
+            yield ev, arg, stamp
+
+
+def usb_packet(ev, arg):
+    """The four bytes of a USB packet event (arg holds byte1..byte3)."""
+    return (((ev >> 4) & 0x01) << 4 | (ev & 0x0F), arg & 0xFF, (arg >> 8) & 0xFF, arg >> 16)
+
+
+def extended(stream):
+    """Yield (ticks, event, arg) with the stamps extended by the epoch markers."""
+    epoch = 0
+    ticks = 0
+    for ev, arg, stamp in stream:
+        if ev == EV_EPOCH:
+            # Epoch is the 8-bit Timer1 overflow count; gaps over ~67 s are ambiguous
+            epoch += (arg - epoch) & 0xFF
+            continue
+        if ev & EV_USB_PACKET == EV_USB_PACKET:
+            # No time of its own: the stamp field is byte2 | byte3 << 8
+            yield ticks, ev, arg | (stamp << 8)
+            continue
+        ticks = epoch * 65536 + stamp
+        yield ticks, ev, arg
+
+
+def timeline(stream, out):
+    last_ticks = None
+    origin = None
+
+    out.write("%12s %10s  %s\n" % ("time ms", "delta ms", "event"))
+    for ticks, ev, arg in extended(stream):
+        if origin is None:
+            origin = ticks
+        delta = "" if last_ticks is None else "%10.3f" % ((ticks - last_ticks) * US_PER_TICK / 1000.0)
+        last_ticks = ticks
+
+        if ev & EV_USB_PACKET == EV_USB_PACKET:
+            name, fmt = "USB packet", lambda a, ev=ev: "%02X %02X %02X %02X" % usb_packet(ev, a)
+        else:
+            name, fmt = EVENTS.get(ev, ("event 0x%02X" % ev, str))
+        detail = fmt(arg) if fmt else ""
+        out.write("%12.3f %10s  %s%s\n" % ((ticks - origin) * US_PER_TICK / 1000.0, delta, name,
+                                          " " + str(detail) if detail not in ("", None) else ""))
+
+
+def capture(stream, out, rate):
+    """Write the recorded input as a replay capture (format in host/replay/replay_main.cpp)."""
+    lines = []
+    origin = None
+    usb_us, usb_left = None, 0
+    lost = 0
+    sync_in = False
+
+    for ticks, ev, arg in extended(stream):
+        if origin is None:
+            origin = ticks
+        us = (ticks - origin) * US_PER_TICK + CAPTURE_LEAD_IN_US
+        if ev == EV_LOST:
+            lost += arg
+        elif ev == EV_DIN_RX:
+            lines.append("%d din %02X" % (us, arg))
+        elif ev == EV_USB_RX:
+            usb_us, usb_left = us, arg
+        elif ev & EV_USB_PACKET == EV_USB_PACKET and usb_left:
+            # Packets of one pass arrived together, at the pass's time
+            usb_left -= 1
+            lines.append("%d usb %02X %02X %02X %02X" % ((usb_us,) + usb_packet(ev, arg)))
+        elif ev == EV_SYNC_IN:
+            sync_in = True
+            lines.append("%d sync_in" % us)
+
+    if lost:
+        sys.stderr.write("warning: %d events were lost on the device, the capture has gaps\n" % lost)
+
+    out.write("# Recorded with tools/trace_decode.py --capture\n")
+    out.write("rate %d\n" % rate)
+    out.write("sync_in_connected %d\n" % sync_in)
+    out.write("usb_host 1\n\n")
+    for line in lines:
+        out.write(line + "\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("capture_file", metavar="capture", help="SysEx capture (.syx or hex text), '-' for stdin")
+    parser.add_argument("--capture", metavar="BPC", help="write the raw input as a replay capture instead")
+    parser.add_argument("--rate", type=int, default=2, choices=[1, 2, 4, 6, 24],
+                        help="rate switch position during the recording (default: %(default)s)")
+    args = parser.parse_args()
+
+    stream = events(read_bytes(args.capture_file))
+    if args.capture:
+        with open(args.capture, "w") as out:
+            capture(stream, out, args.rate)
+    else:
+        timeline(stream, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()